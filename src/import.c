@@ -0,0 +1,352 @@
+/*! \file import.c
+ */
+
+#include "import.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/*! \def PAGE_MAP_EMPTY
+ *  \brief Chiave di una posizione libera della tabella delle pagine
+ *  \details Un numero di pagina ottenuto scartando almeno un bit di offset
+ *  non puo' assumere questo valore.
+ */
+#define PAGE_MAP_EMPTY          ((uint64_t) -1)
+
+/*! \struct page_map
+ *  \brief Tabella hash (indirizzamento aperto) da pagina originale a pagina
+ *  compatta
+ */
+struct page_map {
+    /*! pagine originali */
+    uint64_t *keys;
+    /*! pagine compatte, assegnate in ordine di primo accesso */
+    uint64_t *values;
+    /*! numero di posizioni, potenza di due */
+    uint64_t size;
+    /*! numero di pagine inserite */
+    uint64_t used;
+};
+
+/*! \var const char *format_names[]
+ *  \brief Nomi dei formati, nell'ordine di import_format
+ */
+static const char *format_names[] = { "din", "lackey", NULL };
+
+
+/*! \fn void page_map_init(struct page_map *m, uint64_t size)
+ *  \brief Alloca una tabella vuota di "size" posizioni
+ */
+static void
+page_map_init(struct page_map *m, uint64_t size)
+{
+    uint64_t i;
+
+    m->keys = XMALLOC(uint64_t, size);
+    m->values = XMALLOC(uint64_t, size);
+    m->size = size;
+    m->used = 0;
+    for (i = 0; i < size; i++)
+        m->keys[i] = PAGE_MAP_EMPTY;
+}
+
+
+/*! \fn uint64_t page_map_lookup(struct page_map *m, uint64_t page)
+ *  \brief Restituisce la pagina compatta di "page", assegnandone una nuova al
+ *  primo accesso
+ *  \details La tabella viene raddoppiata quando e' piena per meta'.
+ */
+static uint64_t
+page_map_lookup(struct page_map *m, uint64_t page)
+{
+    uint64_t i;
+
+    for (i = (page * 0x9e3779b97f4a7c15ULL) & (m->size - 1);
+         m->keys[i] != PAGE_MAP_EMPTY; i = (i + 1) & (m->size - 1))
+        if (m->keys[i] == page)
+            return m->values[i];
+
+    if (2 * (m->used + 1) > m->size) {
+        struct page_map old = *m;
+
+        page_map_init(m, old.size * 2);
+        for (i = 0; i < old.size; i++) {
+            uint64_t j;
+
+            if (old.keys[i] == PAGE_MAP_EMPTY)
+                continue;
+            for (j = (old.keys[i] * 0x9e3779b97f4a7c15ULL) & (m->size - 1);
+                 m->keys[j] != PAGE_MAP_EMPTY; j = (j + 1) & (m->size - 1))
+                ;
+            m->keys[j] = old.keys[i];
+            m->values[j] = old.values[i];
+        }
+        m->used = old.used;
+        XFREE(old.keys);
+        XFREE(old.values);
+        return page_map_lookup(m, page);
+    }
+    m->keys[i] = page;
+    return m->values[i] = m->used++;
+}
+
+
+/*! \fn int parse_hex(const char **p, const char *end, uint64_t *v)
+ *  \brief Legge un numero esadecimale, con o senza prefisso "0x"
+ *  \return              1 se e' stata letta almeno una cifra
+ */
+static inline int
+parse_hex(const char **p, const char *end, uint64_t *v)
+{
+    const char *q = *p;
+    uint64_t n = 0;
+    unsigned d;
+
+    if (end - q > 2 && q[0] == '0' && (q[1] == 'x' || q[1] == 'X'))
+        q += 2;
+    for (*p = q; q < end; q++) {
+        if ((d = (unsigned) (*q - '0')) < 10)
+            ;
+        else if ((d = (unsigned) ((*q | 0x20) - 'a')) < 6)
+            d += 10;
+        else
+            break;
+        n = n << 4 | d;
+    }
+    *v = n;
+    if (q == *p)
+        return 0;
+    *p = q;
+    return 1;
+}
+
+
+/*! \fn int parse_line(int format, const char *p, const char *end, uint64_t *address, int *rw)
+ *  \brief Interpreta una riga della traccia
+ *  \details Dinero: le etichette 0 (lettura), 1 (scrittura) e 2 (istruzione)
+ *  sono accessi; 3 (escape) e 4 (flush della cache) vengono ignorate.\n
+ *  Lackey: "I" (istruzione) ed "L" sono letture, "S" ed "M" (lettura e
+ *  scrittura dello stesso indirizzo) scritture; le altre righe (messaggi
+ *  "==pid==" di Valgrind) vengono ignorate.
+ *  \return              1 se la riga descrive un accesso
+ */
+static inline int
+parse_line(int format, const char *p, const char *end, uint64_t *address,
+           int *rw)
+{
+    while (p < end && (*p == ' ' || *p == '\t'))
+        p++;
+    if (end - p < 3)
+        return 0;
+
+    if (format == IMPORT_DIN) {
+        if (*p < '0' || *p > '2' || (p[1] != ' ' && p[1] != '\t'))
+            return 0;
+        *rw = *p == '1';
+    } else {
+        switch (*p) {
+            case 'I':
+            case 'L':
+                *rw = 0;
+                break;
+            case 'S':
+            case 'M':
+                *rw = 1;
+                break;
+            default:
+                return 0;
+        }
+        if (p[1] != ' ' && p[1] != '\t')
+            return 0;
+    }
+    for (p += 2; p < end && (*p == ' ' || *p == '\t'); p++)
+        ;
+    return parse_hex(&p, end, address);
+}
+
+
+/*! \addtogroup IMPORT
+ * @{
+ *  \fn int import_format_lookup(const char *name)
+ *  \brief Restituisce il formato di nome "name"
+ *  \return              Valore di import_format, -1 se sconosciuto
+ */
+int import_format_lookup(const char *name)
+{
+    int i;
+
+    for (i = 0; format_names[i]; i++)
+        if (!strcmp(name, format_names[i]))
+            return i;
+    return -1;
+}
+
+
+/*! \fn int import_file(struct trace_encoder *e, uint32_t pid, int format, const char *path, unsigned offset_bits, struct import_stats *st)
+ *  \brief Importa un file di traccia come accessi del processo "pid"
+ *  \details Il file viene letto a blocchi di IMPORT_BUFFER_SIZE byte ed
+ *  interpretato riga per riga senza copie ne' conversioni di libreria.
+ *  Ogni indirizzo viene scomposto in pagina ed offset secondo "offset_bits":
+ *  le pagine vengono rinumerate in ordine di primo accesso, cosi' che gli
+ *  spazi d'indirizzamento a 64 bit dei programmi tracciati (codice, heap e
+ *  stack distanti tra loro) occupino le prime pagine del processo simulato
+ *  senza sovrapporsi.
+ *  \param e             Traccia compressa di destinazione
+ *  \param pid           Processo simulato al quale attribuire gli accessi
+ *  \param format        Formato del file (import_format)
+ *  \param path          Percorso del file, "-" per lo standard input
+ *  \param offset_bits   Bit di offset dell'indirizzo (mmu.offset_bits)
+ *  \param st            Statistiche dell'importazione
+ *  \return              0 in caso di successo, -1 (dopo aver stampato il
+ *                       motivo su stderr) altrimenti
+ */
+int import_file(struct trace_encoder *e, uint32_t pid, int format,
+                const char *path, unsigned offset_bits, struct import_stats *st)
+{
+    struct page_map map;
+    uint64_t address, mask = (1ULL << offset_bits) - 1;
+    char *buf, *p, *nl, *end;
+    size_t left = 0;
+    ssize_t n;
+    int fd, rw, ret = 0;
+
+    memset(st, 0, sizeof(*st));
+    if (!strcmp(path, "-"))
+        fd = STDIN_FILENO;
+    else if ((fd = open(path, O_RDONLY)) == -1) {
+        fprintf(stderr, "Impossibile aprire la traccia %s: %s\n", path,
+                strerror(errno));
+        return -1;
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    buf = XMALLOC(char, IMPORT_BUFFER_SIZE);
+    page_map_init(&map, 1024);
+    for (;;) {
+        n = read(fd, buf + left, IMPORT_BUFFER_SIZE - left);
+        if (n == -1) {
+            if (errno == EINTR)
+                continue;
+            fprintf(stderr, "Errore di lettura da %s: %s\n", path,
+                    strerror(errno));
+            ret = -1;
+            break;
+        }
+        st->bytes += n;
+        end = buf + left + n;
+        /*
+         *  Al termine del file l'ultima riga potrebbe non essere terminata:
+         *  viene aggiunto il carattere di fine riga mancante.
+         */
+        if (n == 0) {
+            if (left == 0)
+                break;
+            *end++ = '\n';
+        }
+
+        for (p = buf; (nl = memchr(p, '\n', end - p)) != NULL; p = nl + 1) {
+            st->lines++;
+            if (!parse_line(format, p, nl, &address, &rw))
+                continue;
+            address = page_map_lookup(&map, address >> offset_bits) <<
+                      offset_bits | (address & mask);
+            trace_encoder_put(e, pid, address, rw);
+            st->accesses++;
+            st->writes += rw;
+        }
+
+        /*
+         *  Sposto la riga incompleta all'inizio del buffer: una riga piu'
+         *  lunga del buffer non puo' essere un accesso e viene scartata.
+         */
+        left = end - p;
+        if (left == IMPORT_BUFFER_SIZE)
+            left = 0;
+        memmove(buf, p, left);
+        if (n == 0)
+            break;
+    }
+
+    st->pages = map.used;
+    XFREE(map.keys);
+    XFREE(map.values);
+    XFREE(buf);
+    if (fd != STDIN_FILENO)
+        close(fd);
+    return ret;
+}
+
+
+/*! \fn int import_traces(char **specs, int n, const char *path, unsigned page_bits, unsigned offset_bits)
+ *  \brief Importa una serie di file in un'unica traccia compressa
+ *  \details Ogni file, specificato come "formato:percorso", diventa un
+ *  processo della traccia, nell'ordine in cui compare.
+ *  \param specs         File da importare
+ *  \param n             Numero di file
+ *  \param path          Percorso della traccia da creare
+ *  \param page_bits     Bit del numero di pagina (mmu.page_bits): un file
+ *                       con piu' pagine distinte non viene importato
+ *  \param offset_bits   Bit di offset dell'indirizzo (mmu.offset_bits)
+ *  \return              0 in caso di successo, -1 (dopo aver stampato il
+ *                       motivo su stderr) altrimenti
+ */
+int import_traces(char **specs, int n, const char *path, unsigned page_bits,
+                  unsigned offset_bits)
+{
+    struct trace_encoder e;
+    struct import_stats st;
+    char *sep;
+    unsigned bits;
+    int i, format, ret = 0;
+
+    for (i = 0; i < n; i++) {
+        if (!(sep = strchr(specs[i], ':'))) {
+            fprintf(stderr, "Importazione \"%s\": specificare formato:file.\n",
+                    specs[i]);
+            return -1;
+        }
+        *sep = '\0';
+        format = import_format_lookup(specs[i]);
+        *sep = ':';
+        if (format == -1) {
+            fprintf(stderr, "Formato di traccia sconosciuto in \"%s\" "
+                    "(din, lackey).\n", specs[i]);
+            return -1;
+        }
+    }
+
+    if (trace_encoder_open(&e, path, n) == -1)
+        return -1;
+    for (i = 0; i < n && ret == 0; i++) {
+        sep = strchr(specs[i], ':');
+        *sep = '\0';
+        format = import_format_lookup(specs[i]);
+        *sep = ':';
+        ret = import_file(&e, i, format, sep + 1, offset_bits, &st);
+        
+        /*
+         *  Le pagine oltre lo spazio d'indirizzamento del processo verrebbero
+         *  ricondotte alle prime in fase di riproduzione.
+         */
+        if (ret == 0 && st.pages > 1ULL << page_bits) {
+            for (bits = page_bits; st.pages > 1ULL << bits; bits++)
+                ;
+            fprintf(stderr, "Processo %d: le %" PRIu64 " pagine di %s non "
+                    "rientrano nello spazio d'indirizzamento (%llu pagine): "
+                    "specificare --address-bits=%u.\n", i, st.pages,
+                    sep + 1, 1ULL << page_bits, bits + offset_bits);
+            ret = -1;
+        }
+        if (ret == 0)
+            fprintf(stdout, "--> Processo %d: %" PRIu64 " accessi (%" PRIu64
+                    " scritture) su %" PRIu64 " pagine da %s\n", i,
+                    st.accesses, st.writes, st.pages, sep + 1);
+    }
+    if (trace_encoder_close(&e, NULL) == -1)
+        ret = -1;
+    return ret;
+}
+
+/*! @} */
@@ -0,0 +1,49 @@
+/*! \file import.h
+ *  \defgroup IMPORT Importazione di tracce in formati standard
+ */
+
+#ifndef __IMPORT_H__
+#define __IMPORT_H__
+
+#include "trace.h"
+
+/*! \def IMPORT_BUFFER_SIZE
+ *  \brief Dimensione del buffer di lettura dei file testuali
+ */
+#define IMPORT_BUFFER_SIZE      (1 << 20)
+
+/*! \enum import_format
+ *  \brief Formati di traccia riconosciuti
+ */
+enum import_format {
+    /*! Dinero III/IV "din": "etichetta indirizzo" per riga */
+    IMPORT_DIN,
+    /*! Valgrind lackey (--trace-mem=yes): "I|L|S|M indirizzo,dimensione" */
+    IMPORT_LACKEY
+};
+
+/*! \struct import_stats
+ *  \brief Statistiche dell'importazione di un file
+ */
+struct import_stats {
+    /*! righe lette */
+    uint64_t lines;
+    /*! accessi importati */
+    uint64_t accesses;
+    /*! accessi in scrittura */
+    uint64_t writes;
+    /*! pagine distinte */
+    uint64_t pages;
+    /*! byte letti */
+    uint64_t bytes;
+};
+
+/*
+ *  Prototipi di funzioni pubbliche
+ */
+int import_format_lookup(const char *);
+int import_file(struct trace_encoder *, uint32_t, int, const char *, unsigned,
+                struct import_stats *);
+int import_traces(char **, int, const char *, unsigned, unsigned);
+
+#endif              /* __IMPORT_H__ */
@@ -11,19 +11,93 @@
 
 
 #include "io_device.h"
+#include "pool.h"
+#include <string.h>
+#include <time.h>
 
-/*! \struct io_requests
- *  \brief Lista FIFO di richieste di I/O
- *  \details I thread di tipo processo possono
- *  accodare la propria richiesta usando la funzione io_device_read()
- *  \var struct io_requests io_request_head
- *  \brief Puntatore al primo elemento della FIFO.
+/*! \var struct io_dev_data io_dev
+ *  \brief Configurazione e statistiche del dispositivo di I/O
  */
-static STAILQ_HEAD(io_requests, io_entry) io_request_head;
+struct io_dev_data io_dev;
+
+/*! \var unsigned io_channels
+ *  \brief Numero di canali del dispositivo di I/O (parametro --io-channels)
+ */
+unsigned io_channels = 1;
+
+/*! \var int virtual_time
+ *  \brief Tempo simulato (parametro --virtual-time)
+ *  \details Se vale uno (1), la latenza delle richieste non viene attesa con
+ *  nanosleep ma contabilizzata su un orologio simulato, che avanza di evento
+ *  in evento quando tutti i processi sono in attesa di I/O o terminati.
+ */
+int virtual_time;
+
+/*! \var int fault_io
+ *  \brief Servizio dei fault tramite il dispositivo (parametro --fault-io)
+ *  \details Se vale uno (1), ogni page fault accoda il caricamento della
+ *  pagina, atteso dal processo, ed ogni pagina "sporca" rimossa la sua copia
+ *  su disco.
+ */
+int fault_io;
+
+/*! \var int io_scheduler
+ *  \brief Politica di scheduling delle richieste (parametro --io-scheduler)
+ */
+static int io_scheduler = IO_SCHED_FIFO;
+/*! \var unsigned io_deadline
+ *  \brief Scadenza delle richieste con IO_SCHED_DEADLINE, in ms
+ */
+static unsigned io_deadline = IO_DEFAULT_DEADLINE;
+/*! \var int io_priorities
+ *  \brief Priorita' dei processi con IO_SCHED_PRIORITY
+ *  \details L'ultima vale anche per i processi successivi; se non
+ *  specificate, la priorita' di un processo e' il suo identificativo.
+ */
+static int *io_priorities;
+static int io_npriorities;
+
+/*! \struct io_queue
+ *  \brief Coda con priorita' delle richieste di I/O
+ *  \details Heap binario ordinato per la chiave "which" delle richieste e,
+ *  a parita', per ordine d'arrivo: ogni richiesta registra la propria
+ *  posizione, cosi' da poter essere rimossa in tempo logaritmico anche dalla
+ *  coda delle scadenze.
+ */
+struct io_queue {
+    /*! richieste, la prima e' quella da servire */
+    io_entry_t **v;
+    /*! numero di richieste */
+    unsigned n;
+    /*! dimensione del vettore "v" */
+    unsigned size;
+    /*! chiave di ordinamento (indice di io_entry.key) */
+    int which;
+};
+
+/*! \var struct io_queue io_request_queue
+ *  \brief Richieste di I/O in attesa, nell'ordine della politica di
+ *  scheduling
+ *  \details I thread di tipo processo possono accodare la propria richiesta
+ *  usando la funzione io_device_read().
+ *  \var struct io_queue io_deadline_queue
+ *  \brief Richieste in attesa ordinate per scadenza (solo IO_SCHED_DEADLINE)
+ *  \var struct io_queue io_event_queue
+ *  \brief Richieste in servizio ordinate per istante di completamento (solo
+ *  con il tempo simulato)
+ */
+static struct io_queue io_request_queue, io_deadline_queue, io_event_queue;
+/*! \var int io_active
+ *  \brief Processi in esecuzione, ne' in attesa di I/O ne' terminati
+ *  \details Con il tempo simulato l'orologio avanza solo quando vale zero:
+ *  un processo in esecuzione potrebbe ancora accodare una richiesta
+ *  all'istante corrente. Viene acceduta con il mutex wait_lock acquisito.
+ */
+static int io_active;
 /*! \var uint16_t ioreq_count
  *  \brief Numero di richieste di I/O in coda.
  */
-static uint16_t ioreq_count;
+static uint32_t ioreq_count;
 /*! \var pthread_mutex_t fifo_lock
  *  \brief Mutex posto a protezione della FIFO
  */
@@ -50,32 +124,353 @@ static pthread_mutex_t request_lock = PTHREAD_MUTEX_INITIALIZER;
  *  d'accessi alla memoria.
  */
 static int io_device_should_exit;
+/*! \var struct pool io_pool
+ *  \brief Pool delle richieste di I/O
+ *  \details Ogni processo attende il completamento della propria richiesta
+ *  prima di effettuarne un'altra: il pool viene dimensionato sul numero di
+ *  processi ed acceduto con il mutex wait_lock acquisito.
+ */
+static struct pool io_pool;
+/*! \var unsigned io_running
+ *  \brief Thread del dispositivo ancora in esecuzione
+ *  \details L'ultimo thread a terminare dealloca il pool delle richieste,
+ *  cosi' che le relative statistiche siano disponibili per il resoconto.
+ */
+static unsigned io_running;
+/*! \var struct timespec io_start
+ *  \brief Istante di avvio del dispositivo
+ */
+static struct timespec io_start;
 
 extern proc_t **proc_table;
 extern int max_proc;
 
 
+/*! \fn void io_thread_exit()
+ *  \brief Registra la terminazione di un thread del dispositivo
+ *  \details Terminato l'ultimo thread nessuna richiesta puo' piu' essere
+ *  accodata, quindi il pool delle richieste viene deallocato e le sue
+ *  statistiche accumulate. Va richiamata senza il mutex wait_lock acquisito.
+ */
+static void
+io_thread_exit()
+{
+    pthread_mutex_lock(&wait_lock);
+    if (--io_running == 0)
+        pool_destroy(&io_pool);
+    pthread_mutex_unlock(&wait_lock);
+}
+
+
+/*! \fn uint64_t now_us()
+ *  \brief Restituisce l'istante corrente (CLOCK_MONOTONIC) in us
+ */
+static inline uint64_t
+now_us()
+{
+    struct timespec ts;
+    
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+/*! \fn uint64_t io_now()
+ *  \brief Restituisce l'istante corrente del dispositivo (us)
+ *  \details Con il tempo simulato e' il valore dell'orologio simulato,
+ *  altrimenti il tempo reale trascorso dall'avvio del dispositivo.
+ */
+static inline uint64_t
+io_now()
+{
+    if (virtual_time)
+        return io_dev.vclock;
+    return now_us() - ((uint64_t) io_start.tv_sec * 1000000 +
+                       io_start.tv_nsec / 1000);
+}
+
+
+/*! \fn int queue_before(struct io_queue *q, io_entry_t *a, io_entry_t *b)
+ *  \brief Vale uno se la richiesta "a" precede "b" nella coda
+ */
+static inline int
+queue_before(struct io_queue *q, io_entry_t *a, io_entry_t *b)
+{
+    return a->key[q->which] < b->key[q->which] ||
+           (a->key[q->which] == b->key[q->which] && a->seq < b->seq);
+}
+
+
+/*! \fn void queue_set(struct io_queue *q, unsigned i, io_entry_t *req)
+ *  \brief Colloca la richiesta nella posizione "i"
+ */
+static inline void
+queue_set(struct io_queue *q, unsigned i, io_entry_t *req)
+{
+    q->v[i] = req;
+    req->pos[q->which] = i;
+}
+
+
+/*! \fn void queue_sift(struct io_queue *q, unsigned i)
+ *  \brief Ripristina l'ordinamento dello heap a partire dalla posizione "i"
+ */
+static void
+queue_sift(struct io_queue *q, unsigned i)
+{
+    io_entry_t *req = q->v[i];
+    unsigned child;
+    
+    while (i > 0 && queue_before(q, req, q->v[(i - 1) / 2])) {
+        queue_set(q, i, q->v[(i - 1) / 2]);
+        i = (i - 1) / 2;
+    }
+    while ((child = 2 * i + 1) < q->n) {
+        if (child + 1 < q->n && queue_before(q, q->v[child + 1], q->v[child]))
+            child++;
+        if (!queue_before(q, q->v[child], req))
+            break;
+        queue_set(q, i, q->v[child]);
+        i = child;
+    }
+    queue_set(q, i, req);
+}
+
+
+/*! \fn void queue_push(struct io_queue *q, io_entry_t *req)
+ *  \brief Inserisce una richiesta nella coda
+ */
+static void
+queue_push(struct io_queue *q, io_entry_t *req)
+{
+    io_entry_t **v;
+    
+    /*
+     *  Con --fault-io un processo puo' avere piu' richieste in coda (le copie
+     *  su disco non vengono attese): il vettore viene raddoppiato se pieno.
+     */
+    if (q->n == q->size) {
+        v = XMALLOC(io_entry_t *, 2 * q->size);
+        memcpy(v, q->v, q->n * sizeof(io_entry_t *));
+        XFREE(q->v);
+        q->v = v;
+        q->size *= 2;
+    }
+    queue_set(q, q->n++, req);
+    queue_sift(q, q->n - 1);
+}
+
+
+/*! \fn void queue_remove(struct io_queue *q, io_entry_t *req)
+ *  \brief Rimuove una richiesta dalla coda
+ */
+static void
+queue_remove(struct io_queue *q, io_entry_t *req)
+{
+    unsigned i = req->pos[q->which];
+    
+    if (i != --q->n) {
+        queue_set(q, i, q->v[q->n]);
+        queue_sift(q, i);
+    }
+}
+
+
+/*! \fn io_entry_t *next_request()
+ *  \brief Estrae la prossima richiesta da servire secondo io_scheduler
+ *  \details Con IO_SCHED_DEADLINE viene servita la richiesta con la
+ *  scadenza piu' vicina se questa e' gia' trascorsa, altrimenti quella con
+ *  il tempo di servizio minore.
+ */
+static io_entry_t *
+next_request()
+{
+    io_entry_t *req = io_request_queue.v[0];
+    
+    if (io_scheduler == IO_SCHED_DEADLINE) {
+        if (io_deadline_queue.v[0]->key[1] <= io_now())
+            req = io_deadline_queue.v[0];
+        queue_remove(&io_deadline_queue, req);
+    }
+    queue_remove(&io_request_queue, req);
+    return req;
+}
+
+
+/*! \fn void record_wait(proc_t *proc, uint64_t wait)
+ *  \brief Registra l'attesa (in us) di una richiesta del processo
+ */
+static void
+record_wait(proc_t *proc, uint64_t wait)
+{
+    uint64_t ms = wait / 1000;
+    
+    proc->stats.io_wait += wait;
+    if (wait > proc->stats.io_wait_max)
+        proc->stats.io_wait_max = wait;
+    proc->stats.io_wait_hist[ms < IO_WAIT_BUCKETS ? ms : IO_WAIT_BUCKETS - 1]++;
+}
+
+
+/*! \fn void complete_request(struct io_channel *ch, io_entry_t *req)
+ *  \brief Aggiorna le statistiche di una richiesta servita e la dealloca
+ *  \details Va richiamata con il mutex wait_lock acquisito; se la richiesta
+ *  non e' una copia su disco, il processo che l'ha effettuata deve poi
+ *  essere risvegliato.
+ *  \return             1 se il processo deve essere risvegliato
+ */
+static int
+complete_request(struct io_channel *ch, io_entry_t *req)
+{
+    proc_t *proc = proc_table[req->procnum];
+    int type = req->type;
+    
+    io_dev.req_count++;
+    ch->requests++;
+    ch->busy_time += req->service;
+    switch (type) {
+        case IO_PAGE_IN:
+            io_dev.page_ins++;
+            proc->stats.page_ins++;
+            proc->stats.fault_wait += io_now() - req->arrival;
+            break;
+        case IO_WRITE_BACK:
+            io_dev.write_backs++;
+            break;
+        case IO_PREFETCH:
+            io_dev.prefetches++;
+            break;
+        default:
+            proc->stats.io_requests++;
+            proc->stats.time_elapsed += req->service;
+            record_wait(proc, io_now() - req->arrival);
+    }
+    POOL_PUT(&io_pool, req);
+    return type == IO_READ || type == IO_PAGE_IN;
+}
+
+
+/*! \fn void wake_process(uint16_t procnum)
+ *  \brief Registra il completamento di una richiesta e risveglia il processo
+ *  \details Il contatore io_completed viene aggiornato sotto io_lock, cosi'
+ *  che il processo non possa perdere il risveglio: se la richiesta viene
+ *  completata prima che il processo si sospenda, questi non si sospende.
+ *  Va richiamata senza il mutex wait_lock acquisito.
+ */
+static void
+wake_process(uint16_t procnum)
+{
+    proc_t *proc = proc_table[procnum];
+    
+    pthread_mutex_lock(&proc->io_lock);
+    proc->io_completed++;
+    pthread_cond_signal(&proc->io_cond);
+    pthread_mutex_unlock(&proc->io_lock);
+}
+
+
+/*! \fn void *thread_io_clock(void *parg)
+ *  \brief Thread del dispositivo I/O con tempo simulato
+ *  \details Simulazione ad eventi discreti: quando tutti i processi sono in
+ *  attesa di I/O o terminati, nessuna richiesta puo' piu' essere accodata
+ *  all'istante corrente. Il thread assegna allora le richieste in coda ai
+ *  canali liberi, secondo la politica di scheduling, ed avanza l'orologio al
+ *  primo completamento, risvegliando il processo che attendeva la
+ *  richiesta. Gli accessi alla memoria non consumano tempo simulato.
+ *  \param parg         inutilizzato
+ *  \return             inutilizzato
+ */
+static void *
+thread_io_clock(void *parg)
+{
+    struct io_channel *ch;
+    io_entry_t *req;
+    unsigned i;
+    int procnum;
+    
+    printf("--> Thread DEVICE I/O avviato [tempo simulato, %u canali, "
+           "Tmin=%d, Tmax=%d]\n", io_dev.nchannels, io_dev.Tmin, io_dev.Tmax);
+    
+    pthread_mutex_lock(&wait_lock);
+    for (;;) {
+        while (io_active > 0 || (ioreq_count == 0 && io_event_queue.n == 0)) {
+            if (io_device_should_exit && ioreq_count == 0 &&
+                io_event_queue.n == 0)
+                goto out;
+            pthread_cond_wait(&wait_cond, &wait_lock);
+        }
+        
+        /*
+         *  Assegno le richieste in coda ai canali liberi: il servizio inizia
+         *  all'istante corrente.
+         */
+        pthread_mutex_lock(&fifo_lock);
+        for (i = 0; i < io_dev.nchannels && ioreq_count; i++) {
+            ch = &io_dev.channels[i];
+            if (ch->busy)
+                continue;
+            ch->depth_sum += ioreq_count;
+            req = next_request();
+            ioreq_count--;
+            ch->busy = 1;
+            req->channel = ch;
+            req->key[2] = io_dev.vclock + (uint64_t) req->service * 1000;
+            queue_push(&io_event_queue, req);
+        }
+        pthread_mutex_unlock(&fifo_lock);
+        
+        /*
+         *  Avanzo l'orologio al primo completamento e risveglio il processo.
+         */
+        req = io_event_queue.v[0];
+        queue_remove(&io_event_queue, req);
+        io_dev.vclock = req->key[2];
+        req->channel->busy = 0;
+        procnum = req->procnum;
+        fprintf(LOG_FILE(procnum), 
+                "Richiesta d'accesso servita in %u ms\n", req->service);
+        if (complete_request(req->channel, req)) {
+            io_active++;
+            pthread_mutex_unlock(&wait_lock);
+            wake_process(procnum);
+            pthread_mutex_lock(&wait_lock);
+        }
+    }
+out:
+    for (i = 0; i < io_dev.nchannels; i++)
+        io_dev.channels[i].elapsed = io_dev.vclock / 1e3;
+    pthread_mutex_unlock(&wait_lock);
+    io_thread_exit();
+    printf("<-- Thread DEVICE I/O terminato [tempo simulato %.3f s]\n",
+           io_dev.vclock / 1e6);
+    pthread_exit(NULL);
+}
+
+
 /*! \fn void *thread_io_device(void *parg)
- *  \brief Thread dispositivo I/O
- *  \details La funzione costituisce il corpo del thread che rappresenta il 
- *  dispositivo di I/O. Il suddetto thread sospende la propria esecuzione 
- *  fintanto che non siano presenti delle richieste d'accesso al dispositivo.
- *  Il thread termina la propria esecuzione quando sono stati compiuti il
+ *  \brief Thread canale del dispositivo I/O
+ *  \details La funzione costituisce il corpo dei thread che rappresentano i
+ *  canali del dispositivo di I/O. Ogni canale sospende la propria esecuzione
+ *  fintanto che non siano presenti delle richieste d'accesso al dispositivo;
+ *  la latenza di una richiesta viene simulata senza mantenere alcun mutex,
+ *  cosi' che gli altri canali possano servire le richieste successive.
+ *  I thread terminano la propria esecuzione quando sono stati compiuti il
  *  numero massimo d'accessi alla memoria (ad opera dell'MMU).
- *  \param parg         inutilizzato
+ *  \param parg         Canale servito dal thread (struct io_channel)
  *  \return             inutilizzato
  */
 static void *
 thread_io_device(void *parg)
 {
+    struct io_channel *ch = parg;
     io_entry_t *req;
-    struct timespec timeout;
-    int num;
+    struct timespec timeout, now;
+    int num, procnum, wake;
     
-    printf("--> Thread DEVICE I/O avviato [Tmin=%d, Tmax=%d]\n",
-           io_dev.Tmin, io_dev.Tmax);
+    printf("--> Thread DEVICE I/O avviato [canale %u, Tmin=%d, Tmax=%d]\n",
+           ch->id, io_dev.Tmin, io_dev.Tmax);
     
-    while (!io_device_should_exit) {
+    for (;;) {
         pthread_mutex_lock(&wait_lock);
         while ((ioreq_count == 0) && !io_device_should_exit) {
             pthread_cond_wait(&wait_cond, &wait_lock);
@@ -87,26 +482,25 @@ thread_io_device(void *parg)
         }
         
         /*
-         *  Estraggo la prima richiesta e la rimuovo dalla coda, aggiornando
-         *  la variabile "ioreq_count" che tiene traccia di quante richieste
-         *  sono ancora in attesa.
+         *  Estraggo la prossima richiesta secondo la politica di scheduling,
+         *  aggiornando la variabile "ioreq_count" che tiene traccia di quante
+         *  richieste sono ancora in attesa.
          */
-        req = STAILQ_FIRST(&io_request_head);
-        assert(req);
-        
         pthread_mutex_lock(&fifo_lock);
-        STAILQ_REMOVE(&io_request_head, req, io_entry, entries);
+        ch->depth_sum += ioreq_count;
+        req = next_request();
+        assert(req);
         ioreq_count--;
         pthread_mutex_unlock(&fifo_lock);
+        pthread_mutex_unlock(&wait_lock);
         
         /*
-         *  Genero un numero casuale compreso nell'intervallo chiuso 
-         *  [Tmin,Tmax] utile a simulare il reperimento dell'informazione dal
-         *  dispositivo.
+         *  Il tempo di servizio, compreso nell'intervallo chiuso [Tmin,Tmax],
+         *  e' stato estratto all'accodamento della richiesta.
          */
-        num = bounded_rand(io_dev.Tmin, io_dev.Tmax);
-        timeout.tv_sec = 0;
-        timeout.tv_nsec = num * 1000000;
+        num = req->service;
+        timeout.tv_sec = num / 1000;
+        timeout.tv_nsec = (num % 1000) * 1000000;
         nanosleep(&timeout, NULL);
         fprintf(LOG_FILE(req->procnum), 
                 "Richiesta d'accesso servita in %d ms\n", num);
@@ -115,33 +509,110 @@ thread_io_device(void *parg)
          *  Aggiorno le statistiche e "risveglio" il processo che ha fatto la
          *  richiesta.
          */
-        io_dev.req_count++;
-        proc_table[req->procnum]->stats.io_requests++;
-        proc_table[req->procnum]->stats.time_elapsed += num;
+        pthread_mutex_lock(&wait_lock);
+        procnum = req->procnum;
+        wake = complete_request(ch, req);
         pthread_mutex_unlock(&wait_lock);
-        pthread_cond_signal(&proc_table[req->procnum]->io_cond);
-        XFREE(req);
+        if (wake)
+            wake_process(procnum);
     }
-    printf("<-- Thread DEVICE I/O terminato\n");
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    ch->elapsed = (now.tv_sec - io_start.tv_sec) * 1e3 +
+                  (now.tv_nsec - io_start.tv_nsec) / 1e6;
+    io_thread_exit();
+    printf("<-- Thread DEVICE I/O terminato [canale %u]\n", ch->id);
     pthread_exit(NULL);
 }
 
 
+/*! \fn int submit_request(uint16_t procnum, int type)
+ *  \brief Accoda una richiesta al dispositivo di I/O
+ *  \details Il tempo di servizio viene estratto all'accodamento, nell'intervallo
+ *  chiuso [Tmin,Tmax]. Qualora l'MMU abbia gia terminato la propria
+ *  esecuzione, la richiesta non viene accettata.
+ *  \param procnum      ID del processo
+ *  \param type         Tipo di richiesta (IO_READ, IO_PAGE_IN, IO_WRITE_BACK,
+ *                      IO_PREFETCH)
+ *  \return             1 se la richiesta e' stata accodata, 0 altrimenti
+ */
+static int
+submit_request(uint16_t procnum, int type)
+{
+    static const char *msg[] = { "Richiesta d'accesso a dispositivo I/O",
+                                 "Caricamento della pagina",
+                                 "Copia su disco della pagina",
+                                 "Caricamento anticipato della pagina" };
+    static uint64_t seq;
+    io_entry_t *req;
+    int ret;
+    
+    pthread_mutex_lock(&request_lock);
+    
+    if (!io_device_should_exit) {
+        pthread_mutex_lock(&wait_lock);
+        req = POOL_GET(&io_pool, io_entry_t);
+        req->pid = proc_table[procnum]->pid;
+        req->procnum = procnum;
+        req->type = type;
+        req->service = bounded_rand(&io_dev.rng, io_dev.Tmin, io_dev.Tmax);
+        req->seq = seq++;
+        req->arrival = io_now();
+        req->key[1] = req->arrival + (uint64_t) io_deadline * 1000;
+        switch (io_scheduler) {
+            case IO_SCHED_SJF:
+            case IO_SCHED_DEADLINE:
+                req->key[0] = req->service;
+                break;
+            case IO_SCHED_PRIORITY:
+                req->key[0] = (uint32_t) (io_npriorities ?
+                              io_priorities[procnum < io_npriorities ?
+                              procnum : io_npriorities - 1] : procnum) ^
+                              0x80000000U;
+                break;
+            default:
+                req->key[0] = req->seq;
+        }
+        pthread_mutex_lock(&fifo_lock);
+        queue_push(&io_request_queue, req);
+        if (io_scheduler == IO_SCHED_DEADLINE)
+            queue_push(&io_deadline_queue, req);
+        ioreq_count++;
+        if (ioreq_count > io_dev.max_depth)
+            io_dev.max_depth = ioreq_count;
+        pthread_mutex_unlock(&fifo_lock);
+        
+        fprintf(LOG_FILE(procnum), "\n%s accodata\n", msg[type]);
+        
+        pthread_mutex_unlock(&wait_lock);
+        pthread_cond_signal(&wait_cond);
+        ret = 1;
+    } else
+        ret = 0;
+    
+    pthread_mutex_unlock(&request_lock);
+    
+    return ret;
+}
+
+
 /*! \addtogroup IO
  * @{
  *  \fn pthread_t *io_device_init(int min, int max)
  *  \brief Inizializzazione I/O
  *  \details La funzione inizializza la struttura dati utile a rappresentare il
  *  dispositivo di I/O, nonche la lista delle richieste.\n
- *  In ultimo, si occupera' di creare il thread.
+ *  In ultimo, si occupera' di creare un thread per ognuno degli
+ *  "io_channels" canali.
  *  \param min          Tempo minimo d'attesa
  *  \param max          Tempo massimo d'attesa
- *  \return             Restituisce il thread_id appena creato
+ *  \return             Restituisce i thread_id appena creati (uno per canale)
+ *                      o NULL in caso d'errore
  *  \sa thread_io_device
  */
 pthread_t *io_device_init(int min, int max)
 {
-    pthread_t *tid = XMALLOC(pthread_t, 1);
+    pthread_t *tid;
+    unsigned i;
     int ret;
     
     if (io_dev.Tmax > io_dev.Tmin)
@@ -152,9 +623,39 @@ pthread_t *io_device_init(int min, int max)
     }
     io_device_should_exit = 0;
     ioreq_count = 0;
-    io_dev.req_count = 0;
-    STAILQ_INIT(&io_request_head);
-    ret = pthread_create(tid, NULL, &thread_io_device, NULL);
+    io_dev.req_count = io_dev.max_depth = 0;
+    io_dev.page_ins = io_dev.write_backs = io_dev.prefetches = 0;
+    io_dev.nchannels = io_channels ? io_channels : 1;
+    rng_init(&io_dev.rng, RNG_STREAM_IO);
+    pool_init(&io_pool, sizeof(io_entry_t), max_proc);
+    io_request_queue.v = XMALLOC(io_entry_t *, max_proc);
+    io_deadline_queue.v = XMALLOC(io_entry_t *, max_proc);
+    io_event_queue.v = XMALLOC(io_entry_t *, max_proc);
+    io_request_queue.n = io_deadline_queue.n = io_event_queue.n = 0;
+    io_request_queue.size = io_deadline_queue.size = max_proc;
+    io_event_queue.size = max_proc;
+    io_request_queue.which = 0;
+    io_deadline_queue.which = 1;
+    io_event_queue.which = 2;
+    io_dev.vclock = 0;
+    io_active = max_proc;
+    
+    io_dev.channels = XMALLOC(struct io_channel, io_dev.nchannels);
+    memset(io_dev.channels, 0, io_dev.nchannels * sizeof(struct io_channel));
+    tid = XMALLOC(pthread_t, io_dev.nchannels);
+    clock_gettime(CLOCK_MONOTONIC, &io_start);
+    if (virtual_time) {
+        io_dev.nthreads = io_running = 1;
+        ret = pthread_create(tid, NULL, &thread_io_clock, NULL);
+        return (ret == 0) ? tid : NULL;
+    }
+    io_dev.nthreads = io_running = io_dev.nchannels;
+    for (ret = 0, i = 0; i < io_dev.nchannels && ret == 0; i++) {
+        io_dev.channels[i].id = i;
+        ret = pthread_create(&io_dev.channels[i].tid, NULL, &thread_io_device,
+                             &io_dev.channels[i]);
+        tid[i] = io_dev.channels[i].tid;
+    }
     
     return (ret == 0) ? tid : NULL;
 }
@@ -166,6 +667,7 @@ pthread_t *io_device_init(int min, int max)
  *  dispositivo di I/O da parte di uno dei processi. Qualora l'MMU abbia 
  *  gia terminato la propria esecuzione, la funzione non accetta 
  *  ulteriori richieste.
+ *  \sa submit_request
  *  \param procnum      ID del processo
  *  \return             Restituisce l'esito dell'operazione:
  *                      1  la richiesta e' stata accodata
@@ -173,36 +675,69 @@ pthread_t *io_device_init(int min, int max)
  */
 int io_device_read(uint16_t procnum)
 {
-    io_entry_t *req;
-    int ret;
-    
-    pthread_mutex_lock(&request_lock);
-    
-    if (!io_device_should_exit) {
-        pthread_mutex_lock(&wait_lock);
-        req = XMALLOC(io_entry_t, 1);
-        req->pid = proc_table[procnum]->pid;
-        req->procnum = procnum;
-        pthread_mutex_lock(&fifo_lock);
-        if (STAILQ_EMPTY(&io_request_head))
-            STAILQ_INSERT_HEAD(&io_request_head, req, entries);
-        else
-            STAILQ_INSERT_TAIL(&io_request_head, req, entries);
-        ioreq_count++;
-        pthread_mutex_unlock(&fifo_lock);
-        
-        fprintf(LOG_FILE(procnum), 
-                "\nRichiesta d'accesso a dispositivo I/O accodata\n");
-        
-        pthread_mutex_unlock(&wait_lock);
-        pthread_cond_signal(&wait_cond);
-        ret = 1;
-    } else
-        ret = 0;
-    
-    pthread_mutex_unlock(&request_lock);
+    return submit_request(procnum, IO_READ);
+}
+
+
+/*! \fn void io_device_wait(uint16_t procnum)
+ *  \brief Attende il completamento dell'ultima richiesta del processo
+ *  \details Il completamento viene registrato dal dispositivo in
+ *  io_completed, sotto io_lock: la condizione viene quindi verificata prima
+ *  di ogni attesa e una richiesta gia' completata (o un risveglio spurio)
+ *  non puo' sospendere il processo. Con il tempo simulato il processo si
+ *  dichiara sospeso (io_device_block) con io_lock acquisito.
+ *  \param procnum      ID del processo, che deve aver accodato una richiesta
+ *                      IO_READ o IO_PAGE_IN
+ */
+void io_device_wait(uint16_t procnum)
+{
+    proc_t *proc = proc_table[procnum];
     
-    return ret;
+    pthread_mutex_lock(&proc->io_lock);
+    proc->io_issued++;
+    io_device_block(procnum);
+    while (proc->io_completed < proc->io_issued)
+        pthread_cond_wait(&proc->io_cond, &proc->io_lock);
+    pthread_mutex_unlock(&proc->io_lock);
+}
+
+
+/*! \fn void io_device_page_in(uint16_t procnum)
+ *  \brief Servizio di un page fault tramite il dispositivo (--fault-io)
+ *  \details Accoda il caricamento della pagina, per il quale il processo
+ *  resta sospeso: nel frattempo gli altri processi proseguono.
+ *  \param procnum      ID del processo che ha generato il fault
+ */
+void io_device_page_in(uint16_t procnum)
+{
+    if (submit_request(procnum, IO_PAGE_IN))
+        io_device_wait(procnum);
+}
+
+
+/*! \fn void io_device_write_back(uint16_t procnum)
+ *  \brief Accoda la copia su disco di una pagina "sporca" (--fault-io)
+ *  \details Richiamata dalla MMU alla rimozione della pagina: la richiesta
+ *  e' attribuita al proprietario del frame, del quale assume la priorita',
+ *  e nessun processo ne attende il completamento.
+ *  \param procnum      ID del processo proprietario della pagina
+ */
+void io_device_write_back(uint16_t procnum)
+{
+    submit_request(procnum, IO_WRITE_BACK);
+}
+
+
+/*! \fn void io_device_prefetch(uint16_t procnum)
+ *  \brief Accoda il caricamento anticipato di una pagina (--fault-io)
+ *  \details Richiamata dalla MMU quando la paginazione anticipata carica una
+ *  pagina adiacente: il caricamento occupa il dispositivo, ma il processo
+ *  non ne attende il completamento.
+ *  \param procnum      ID del processo proprietario della pagina
+ */
+void io_device_prefetch(uint16_t procnum)
+{
+    submit_request(procnum, IO_PREFETCH);
 }
 
 
@@ -217,7 +752,154 @@ void tell_io_device_to_exit()
     pthread_mutex_lock(&request_lock);
     io_device_should_exit = 1;
     pthread_mutex_unlock(&request_lock);
-    pthread_cond_signal(&wait_cond);
+    pthread_mutex_lock(&wait_lock);
+    pthread_cond_broadcast(&wait_cond);
+    pthread_mutex_unlock(&wait_lock);
+}
+
+
+/*! \fn void io_device_block(uint16_t procnum)
+ *  \brief Il processo si sospende in attesa della propria richiesta di I/O
+ *  \details Va richiamata con il mutex io_lock del processo acquisito,
+ *  prima di attendere io_cond: con il tempo simulato il completamento della
+ *  richiesta non puo' quindi precedere l'attesa del processo.
+ */
+void io_device_block(uint16_t procnum)
+{
+    if (!virtual_time)
+        return;
+    pthread_mutex_lock(&wait_lock);
+    if (--io_active == 0)
+        pthread_cond_signal(&wait_cond);
+    pthread_mutex_unlock(&wait_lock);
+}
+
+
+/*! \fn void io_device_proc_exit()
+ *  \brief Comunica al dispositivo il termine di un processo
+ */
+void io_device_proc_exit()
+{
+    if (!virtual_time)
+        return;
+    pthread_mutex_lock(&wait_lock);
+    if (--io_active == 0)
+        pthread_cond_signal(&wait_cond);
+    pthread_mutex_unlock(&wait_lock);
+}
+
+
+/*! \fn void io_device_destroy()
+ *  \brief Dealloca le strutture del dispositivo di I/O
+ *  \details Va richiamata dopo il termine di tutti i canali e la stampa
+ *  delle statistiche (il pool delle richieste e' gia' stato deallocato
+ *  dall'ultimo thread terminato); non ha effetto se il dispositivo non e' stato avviato.
+ */
+void io_device_destroy()
+{
+    if (!io_dev.channels)
+        return;
+    XFREE(io_request_queue.v);
+    XFREE(io_deadline_queue.v);
+    XFREE(io_event_queue.v);
+    XFREE(io_priorities);
+    XFREE(io_dev.channels);
+}
+
+
+/*! \fn int io_scheduler_parse(const char *spec)
+ *  \brief Imposta la politica di scheduling delle richieste di I/O
+ *  \details Sono ammesse "fifo", "sjf", "priority[:P0[:P1...]]" (priorita'
+ *  dei processi, minore e' piu' urgente) e "deadline[:MS]".
+ *  \param spec          Politica e parametri (parametro --io-scheduler)
+ *  \return              0 in caso di successo, -1 (dopo aver stampato il
+ *                       motivo su stderr) altrimenti
+ */
+int io_scheduler_parse(const char *spec)
+{
+    const char *param = strchr(spec, ':');
+    size_t len = param ? (size_t) (param - spec) : strlen(spec);
+    char *end;
+    long v;
+    
+    if (len == 4 && !strncmp(spec, "fifo", len) && !param)
+        io_scheduler = IO_SCHED_FIFO;
+    else if (len == 3 && !strncmp(spec, "sjf", len) && !param)
+        io_scheduler = IO_SCHED_SJF;
+    else if (len == 8 && !strncmp(spec, "deadline", len)) {
+        io_scheduler = IO_SCHED_DEADLINE;
+        if (param) {
+            v = strtol(param + 1, &end, 10);
+            if (end == param + 1 || *end != '\0' || v <= 0) {
+                fprintf(stderr, "Scadenza delle richieste di I/O non valida: "
+                        "%s\n", param + 1);
+                return -1;
+            }
+            io_deadline = v;
+        }
+    } else if (len == 8 && !strncmp(spec, "priority", len)) {
+        io_scheduler = IO_SCHED_PRIORITY;
+        XFREE(io_priorities);
+        io_priorities = XMALLOC(int, strlen(spec) / 2 + 1);
+        for (io_npriorities = 0; param; param = end) {
+            v = strtol(param + 1, &end, 10);
+            if (end == param + 1 || (*end != ':' && *end != '\0')) {
+                fprintf(stderr, "Priorita' di I/O non valida: %s\n", param + 1);
+                return -1;
+            }
+            io_priorities[io_npriorities++] = v;
+            if (*end == '\0')
+                break;
+        }
+    } else {
+        fprintf(stderr, "Politica di scheduling dell'I/O sconosciuta: %s "
+                "(fifo, sjf, priority[:P0:P1...], deadline[:MS])\n", spec);
+        return -1;
+    }
+    return 0;
+}
+
+
+/*! \fn const char *io_scheduler_name()
+ *  \brief Restituisce il nome della politica di scheduling in uso
+ */
+const char *io_scheduler_name()
+{
+    static const char *names[] = { "fifo", "sjf", "priority", "deadline" };
+    
+    return names[io_scheduler];
+}
+
+
+/*! \fn uint64_t io_wait_percentile(proc_t *proc, double p)
+ *  \brief Restituisce il percentile "p" (0-100) delle attese di I/O del
+ *  processo, in us
+ *  \details Il valore viene interpolato linearmente all'interno della classe
+ *  dell'istogramma che contiene il percentile e limitato all'attesa massima
+ *  osservata; oltre l'ultima classe viene restituita l'attesa massima.
+ */
+uint64_t io_wait_percentile(proc_t *proc, double p)
+{
+    uint64_t total, rank, seen, wait;
+    unsigned i;
+    
+    for (total = i = 0; i < IO_WAIT_BUCKETS; i++)
+        total += proc->stats.io_wait_hist[i];
+    if (!total)
+        return 0;
+    rank = (uint64_t) (p / 100 * total + 0.5);
+    if (rank == 0)
+        rank = 1;
+    for (seen = i = 0; i < IO_WAIT_BUCKETS - 1; i++) {
+        if (seen + proc->stats.io_wait_hist[i] >= rank) {
+            wait = i * 1000ULL + (rank - seen) * 1000 /
+                   proc->stats.io_wait_hist[i];
+            return wait < proc->stats.io_wait_max ?
+                   wait : proc->stats.io_wait_max;
+        }
+        seen += proc->stats.io_wait_hist[i];
+    }
+    return proc->stats.io_wait_max;
 }
 
 /*! @} */
@@ -22,6 +22,50 @@
 #include "proc.h"
 #include "random.h"
 
+/*! \def IO_MAX_CHANNELS
+ *  \brief Numero massimo di canali del dispositivo di I/O
+ */
+#define IO_MAX_CHANNELS                 64
+
+/*! \def IO_SCHED_FIFO
+ *  \brief Richieste servite nell'ordine d'arrivo
+ *  \def IO_SCHED_SJF
+ *  \brief Prima la richiesta con il tempo di servizio minore
+ *  \def IO_SCHED_PRIORITY
+ *  \brief Prima la richiesta del processo con priorita' maggiore (valore
+ *  minore)
+ *  \def IO_SCHED_DEADLINE
+ *  \brief Come IO_SCHED_SJF, ma le richieste la cui scadenza e' trascorsa
+ *  vengono servite per prime, nell'ordine delle scadenze
+ */
+#define IO_SCHED_FIFO                   0
+#define IO_SCHED_SJF                    1
+#define IO_SCHED_PRIORITY               2
+#define IO_SCHED_DEADLINE               3
+
+/*! \def IO_READ
+ *  \brief Richiesta di I/O di un processo
+ *  \def IO_PAGE_IN
+ *  \brief Caricamento di una pagina a seguito di un fault (parametro
+ *  --fault-io): il processo attende il completamento
+ *  \def IO_WRITE_BACK
+ *  \brief Copia su disco di una pagina "sporca" rimossa dalla memoria,
+ *  accodata dalla MMU per il proprietario del frame: nessun processo ne
+ *  attende il completamento
+ *  \def IO_PREFETCH
+ *  \brief Caricamento di una pagina adiacente (paginazione anticipata),
+ *  accodato dalla MMU: nessun processo ne attende il completamento
+ */
+#define IO_READ                         0
+#define IO_PAGE_IN                      1
+#define IO_WRITE_BACK                   2
+#define IO_PREFETCH                     3
+
+/*! \def IO_DEFAULT_DEADLINE
+ *  \brief Scadenza predefinita delle richieste (IO_SCHED_DEADLINE), in ms
+ */
+#define IO_DEFAULT_DEADLINE             100
+
 
 /*! \struct io_entry
  *  \brief Struttura per la rappresentazione di una richiesta d'I/O
@@ -31,8 +75,21 @@ struct io_entry {
     uint16_t pid;
     /*! identificativo del processo all'interno della "proc table" */
     uint16_t procnum;
-    /*! puntatore al successivo elemento della FIFO */
-	STAILQ_ENTRY(io_entry) entries;
+    /*! tipo di richiesta (IO_READ, IO_PAGE_IN, IO_WRITE_BACK, IO_PREFETCH) */
+    int type;
+    /*! tempo di servizio, estratto all'accodamento (ms) */
+    uint32_t service;
+    /*! numero d'ordine d'arrivo */
+    uint64_t seq;
+    /*! istante d'arrivo (us) */
+    uint64_t arrival;
+    /*! chiavi di ordinamento nelle code: politica di scheduling, scadenza
+     e, con il tempo simulato, istante di completamento */
+    uint64_t key[3];
+    /*! posizione nelle code */
+    unsigned pos[3];
+    /*! canale che serve la richiesta (tempo simulato) */
+    struct io_channel *channel;
 };
 
 /*! \var typedef struct io_entry io_entry_t
@@ -41,27 +98,81 @@ struct io_entry {
 typedef struct io_entry io_entry_t;
 
 
+/*! \struct io_channel
+ *  \brief Canale di servizio del dispositivo di I/O
+ *  \details Ogni canale e' servito da un thread che estrae le richieste dalla
+ *  coda comune: i canali servono quindi in parallelo richieste diverse.
+ */
+struct io_channel {
+    /*! thread del canale */
+    pthread_t tid;
+    /*! numero del canale */
+    unsigned id;
+    /*! richieste servite */
+    uint64_t requests;
+    /*! tempo di servizio complessivo, in ms */
+    uint64_t busy_time;
+    /*! somma delle richieste in coda all'estrazione di ogni richiesta */
+    uint64_t depth_sum;
+    /*! durata di vita del canale, in ms */
+    double elapsed;
+    /*! vale uno mentre serve una richiesta (tempo simulato) */
+    int busy;
+};
+
+
 /*! \struct io_dev_data
  *  \brief Struttura per la configurazione del dispositivo di I/O.
  *  Il campo "req_count" viene incrementato quando una nuova richiesta
  *  di I/O viene inserita nella coda. 
  *  Il tempo entro il quale viene servita la richiesta e' limitato 
- *  inferiormente da Tmin e superiormente da Tmax.
+ *  inferiormente da Tmin e superiormente da Tmax; le richieste vengono
+ *  servite contemporaneamente da "nchannels" canali.
  */
 struct io_dev_data {
     /*! Tempo minimo di attesa per espletare una richiesta di I/O */
     uint16_t Tmin;
     /*! Tempo massimo di attesa per espletare una richiesta di I/O */
     uint16_t Tmax;
-    /*! Numero di richieste in coda */
-    uint16_t req_count;
-} io_dev;
+    /*! Numero di richieste servite */
+    uint64_t req_count;
+    /*! Numero di canali */
+    unsigned nchannels;
+    /*! Canali di servizio */
+    struct io_channel *channels;
+    /*! Numero di thread del dispositivo */
+    unsigned nthreads;
+    /*! Orologio simulato (us), se attivo il tempo simulato */
+    uint64_t vclock;
+    /*! Numero massimo di richieste in coda */
+    uint64_t max_depth;
+    /*! Caricamenti di pagine serviti (IO_PAGE_IN) */
+    uint64_t page_ins;
+    /*! Copie su disco servite (IO_WRITE_BACK) */
+    uint64_t write_backs;
+    /*! Caricamenti anticipati serviti (IO_PREFETCH) */
+    uint64_t prefetches;
+    /*! Generatore di numeri casuali del dispositivo */
+    struct rng rng;
+};
+
+extern struct io_dev_data io_dev;
 
 /*
  *  Prototipi di funzione
  */
 pthread_t *io_device_init(int, int);
 int io_device_read(uint16_t);
+void io_device_wait(uint16_t);
+void io_device_page_in(uint16_t);
+void io_device_write_back(uint16_t);
+void io_device_prefetch(uint16_t);
 void tell_io_device_to_exit();
+void io_device_destroy();
+void io_device_block(uint16_t);
+void io_device_proc_exit();
+int io_scheduler_parse(const char *);
+const char *io_scheduler_name();
+uint64_t io_wait_percentile(proc_t *, double);
 
 #endif				/* __IO_DEVICE_H__ */
@@ -11,10 +11,22 @@
 
 
 #include "mmu.h"
+#include "trace.h"
+#include <sched.h>
+#include <string.h>
 
-#define EMPTY               0
-#define DATA_AVAILABLE      1
-#define RESULT_AVAILABLE    2
+/*! \def MMU_BATCH
+ *  \brief Numero massimo di richieste servite consecutivamente per processo
+ *  \details Il thread MMU scorre le code dei processi in modo circolare: da
+ *  ognuna estrae al piu' MMU_BATCH richieste prima di passare alla successiva,
+ *  cosi' che nessun processo possa monopolizzare la MMU.
+ */
+#define MMU_BATCH           16
+
+/*! \var struct mmu_data mmu
+ *  \brief Configurazione e statistiche della MMU
+ */
+struct mmu_data mmu;
 
 /*! \var int anticipatory_paging
  *  \brief Indica se la paginazione anticipata risulta attiva.
@@ -23,258 +35,356 @@
  */
 int anticipatory_paging;
 
-/*! \struct mmu_shared_data
- *  \brief Struttura per contenere la richiesta attuale alla MMU
- *  \details Struttura condivisa tra il thread MMU e la funzione memory_access:
- *  in questa struttura vengono inseriti i dati di una richiesta d'accesso
- *  da parte di un processo.
- *  \var struct mmu_shared_data current
- *  \brief Istanza della struttura mmu_shared_data
+/*! \var uint64_t mmu_issued
+ *  \brief Numero di accessi alla memoria ammessi
+ *  \details Viene incrementato atomicamente da memory_access prima di
+ *  inserire la richiesta nella coda del processo: quando raggiunge il numero
+ *  totale di accessi, le richieste successive vengono rifiutate.
+ */
+static uint64_t mmu_issued;
+
+/*! \var struct trace_writer *trace_recorder
+ *  \brief Traccia sulla quale registrare gli accessi ammessi
+ *  \details Se impostata (parametro "--record"), memory_access registra ogni
+ *  accesso nella posizione data dal suo numero d'ammissione.
  */
-struct mmu_shared_data {
-    /*! identificativo del processo all'interno della proc table */
-    int procnum;
-    /*! indirizzo virtuale generato dal processo */
-    uint32_t virtual_address;
-    /*! indirizzo fisico tradotto dalla MMU */
-    uint32_t translated_address;
-    /*! tipo di operazione: vale zero se e' lettura, uno se scrittura */
-    int rw;
-    /*! variabile di stato per la sincronizzazione di MMU e memory_access */
-    int status;
-    /*! lock per modificare la struttura */
-    pthread_mutex_t lock;
-    /*! condizione d'attesa per la sincronizzazione di MMU e memory_access */
-    pthread_cond_t condition;
-} current = 
-       { -1, 0, 0, 0, 0, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER };
+struct trace_writer *trace_recorder;
 
+/*! \var int admission_closed
+ *  \brief Vale uno (1) quando e' stata rifiutata almeno una richiesta
+ *  \details Da questo momento la MMU, terminate le richieste in coda, attende
+ *  soltanto che gli accessi gia' ammessi siano completati.
+ */
+static int admission_closed;
+
+/*! \var uint64_t mmu_completed
+ *  \brief Numero di richieste servite dagli shard della MMU
+ *  \details Ogni shard lo incrementa una volta per lotto di richieste.
+ */
+static uint64_t mmu_completed;
+
+/*! \var frame_t *frame_table
+ *  \brief Tabella dei frame fisici
+ *  \details Vettore contiguo di mmu.max_page_count elementi, indicizzato dal
+ *  frame-id: il frame associato ad una pagina presente si ottiene in tempo
+ *  costante a partire da FRAME_ID. Le liste sottostanti mantengono soltanto
+ *  l'ordine dei frame liberi ed utilizzati.
+ */
+static frame_t *frame_table;
 
-/*! \var int mmu_should_exit
- *  \brief Variabile di controllo per l'MMU
- *  \details Questa variabile determina la durata del thread MMU: fintanto che
- *  il valore e pari a zero, il thread continua la propria esecuzione, 
- *  viceversa termina. Questa variabile viene posta ad uno dalla funzione
- *  memory_access.
+/*! \var const char *replacement_policy
+ *  \brief Nome della politica di rimpiazzo (NULL per quella predefinita)
+ *  \details Viene impostato dal parametro --policy prima di mmu_init.
  */
-static int mmu_should_exit;
+const char *replacement_policy;
 
-/*! \var pthread_mutex_t mem_read_lock
- *  \brief Mutex per la mutua esclusione della chiamata a memory_access 
+/*! \var unsigned mmu_threads
+ *  \brief Numero di thread MMU richiesto (parametro --mmu-threads)
+ *  \details Il valore effettivo, registrato in mmu.shards, non supera ne' il
+ *  numero di processi ne' quello dei frame.
  */
-static pthread_mutex_t mem_read_lock = PTHREAD_MUTEX_INITIALIZER;
+unsigned mmu_threads = 1;
 
-/*! \var STAILQ_HEAD free_frames_head
- *  \brief Lista dei frame inutilizzati (puntatore al primo elemento).
+/*! \struct mmu_shard
+ *  \brief Partizione della MMU servita da un thread
+ *  \details Ogni shard possiede una porzione dei frame fisici e serve le
+ *  richieste dei processi il cui identificativo, modulo il numero di shard,
+ *  coincide con il proprio: le tabelle delle pagine ed i TLB di un processo
+ *  vengono quindi modificati da un solo thread MMU. Anche i frame utilizzati
+ *  contengono soltanto pagine dei processi dello shard, pertanto lista dei
+ *  frame utilizzati e politica di rimpiazzo sono private.\n
+ *  Soltanto la lista dei frame liberi e' condivisa: uno shard che ha esaurito
+ *  i propri frame liberi li sottrae agli altri prima di ricorrere alla
+ *  politica di rimpiazzo.
  */
-static STAILQ_HEAD(free_frames, frame) free_frames_head;
+struct mmu_shard {
+    /*! indice dello shard */
+    unsigned id;
+    /*! thread che serve lo shard */
+    pthread_t tid;
+    /*! politica di rimpiazzo dei frame dello shard */
+    struct policy *policy;
+    /*! frame inutilizzati, protetti da free_lock */
+    TAILQ_HEAD(free_frames, frame) free_frames;
+    /*! numero di frame inutilizzati */
+    uint32_t free_count;
+    /*! numero di frame posseduti, utilizzati o liberi */
+    uint32_t owned;
+    /*! mutex a protezione dei frame liberi e del numero di frame posseduti */
+    pthread_mutex_t free_lock;
+    /*! frame utilizzati, accessibili al solo thread dello shard */
+    TAILQ_HEAD(used_frames, frame) used_frames;
+    /*! vale uno (1) quando il thread e' sospeso in attesa di richieste */
+    int idle;
+    /*! mutex per la condizione d'attesa del thread */
+    pthread_mutex_t idle_lock;
+    /*! condizione d'attesa del thread quando le code sono vuote */
+    pthread_cond_t idle_cond;
+    /*! statistiche dello shard, sommate in "mmu" al termine */
+    struct {
+        uint64_t page_hits;
+        uint64_t page_faults;
+        uint64_t evictions;
+        uint64_t pt_walks;
+        uint64_t pt_walk_levels;
+        uint64_t steals;
+    } stats;
+};
 
-/*! \var STAILQ_HEAD used_frames_head
- *  \brief Lista dei frame utilizzati (puntatore al primo elemento).
+/*! \var struct mmu_shard *shards
+ *  \brief Vettore degli shard della MMU, di mmu.shards elementi
  */
-static STAILQ_HEAD(used_frames, frame) used_frames_head;
+static struct mmu_shard *shards;
 
-/*! \var STAILQ_HEAD used_frames_head
- *  \brief Lista delle pagine residenti in memoria (puntatore al primo 
- *  elemento).
+/*! \def SHARD_OF(procnum)
+ *  \brief Restituisce lo shard che serve il processo "procnum"
  */
-static TAILQ_HEAD(active_pages, active_page) active_page_head;
+#define SHARD_OF(procnum)   (&shards[(procnum) % mmu.shards])
+
+/*! \var int mmu_log
+ *  \brief Vale zero (0) per non registrare gli accessi nei log dei processi
+ *  \details Viene azzerata dalla riproduzione diretta (mmu_direct_init).
+ */
+int mmu_log = 1;
+
+/*! \def MMU_LOG(proc, ...)
+ *  \brief Scrive un messaggio nel file di log del processo "proc"
+ */
+#define MMU_LOG(proc, ...)  do { \
+if (mmu_log) \
+    fprintf((proc)->log_file, __VA_ARGS__); \
+} while (0)
 
-extern proc_t **proc_table;
 extern int max_proc;
 extern int debug;
+extern int fault_io;
 
 
 /*! \addtogroup MMU
  * @{
- *  \fn int second_chance(int procnum, uint16_t page, int update_stats, frame_t **frame)
- *  \brief Algoritmo di rimpiazzo della pagina
- *  \details La funzione second_chance viene invocata direttamente dal thread
- *  "mmu": scopo di questa funzione e trovare una pagina da rimuovere dalla
- *  memoria ed associare il frame appena liberato con la pagina che ha generato
- *  il fault.
+ *  \fn int mmu_try_victim(frame_t *f)
+ *  \brief Verifica che la pagina di un frame possa essere scelta come vittima
+ *  \details Invocata dalle politiche che si basano sul bit Reference quando
+ *  individuano una pagina non referenziata: la traduzione viene invalidata
+ *  nel TLB del proprietario ed il bit ricontrollato, poiche' un TLB hit
+ *  concorrente potrebbe averla appena referenziata.
+ *  \param f             Frame candidato
+ *  \return              1 se la pagina non e' stata referenziata
+ */
+int mmu_try_victim(frame_t *f)
+{
+    tlb_invalidate(&proc_table[f->owner.pid]->tlb, f->owner.page_id);
+    return !IS_PAGE_REFERENCED(FRAME_PAGE(f));
+}
+
+
+/*! \fn void mmu_write_back(frame_t *f)
+ *  \brief Copia su disco la pagina "sporca" di un frame
+ *  \details La voce del TLB riporta la pagina come "sporca": va invalidata
+ *  perche' la prossima scrittura imposti nuovamente il bit D tramite la MMU.
+ *  \param f             Frame la cui pagina deve essere copiata
+ */
+void mmu_write_back(frame_t *f)
+{
+    MMU_LOG(proc_table[f->owner.pid],
+            "Write-back della pagina %" PRIu64 "\n", f->owner.page_id);
+    tlb_invalidate(&proc_table[f->owner.pid]->tlb, f->owner.page_id);
+    PAGE_CLEAR_DIRTY(FRAME_PAGE(f));
+    __atomic_add_fetch(&mmu.write_backs, 1, __ATOMIC_RELAXED);
+    if (fault_io)
+        io_device_write_back(f->owner.pid);
+}
+
+
+/*! \fn void evict_page(struct mmu_shard *s, proc_t *current_proc, frame_t *f)
+ *  \brief Rimuove dalla memoria la pagina associata ad un frame
+ *  \details Elimina l'associazione tra la pagina ed il frame: questo implica
+ *  porre uguale a zero anche i bit R e D, nonche' invalidarne la traduzione
+ *  nel TLB del proprietario. Una pagina ancora "sporca" viene copiata su
+ *  disco.
+ *  \param s             Shard che serve il processo
+ *  \param current_proc  Processo che ha generato il fault (per il log)
+ *  \param f             Frame da liberare
+ */
+static void
+evict_page(struct mmu_shard *s, proc_t *current_proc, frame_t *f)
+{
+    int dirty = IS_PAGE_DIRTY(FRAME_PAGE(f));
+    
+    MMU_LOG(current_proc,
+            "<-- La pagina %" PRIu64 " del processo %d e stata rimossa "
+            "dalla memoria %s(frame %u)\n", f->owner.page_id, f->owner.pid,
+            dirty ? "e paginata su disco " : "", f->id);
+    if (dirty) {
+        __atomic_add_fetch(&mmu.write_backs, 1, __ATOMIC_RELAXED);
+        if (fault_io)
+            io_device_write_back(f->owner.pid);
+    }
+    
+    tlb_invalidate(&proc_table[f->owner.pid]->tlb, f->owner.page_id);
+    PAGE_CLEAR_PRESENT(FRAME_PAGE(f));
+    PAGE_CLEAR_REFERENCED(FRAME_PAGE(f));
+    PAGE_CLEAR_DIRTY(FRAME_PAGE(f));
+    PAGE_CLEAR_FRAMEID(FRAME_PAGE(f));
+    POLICY_EVICT(s->policy, f);
+    s->stats.evictions++;
+}
+
+
+/*! \fn frame_t *take_free_frame(struct mmu_shard *s)
+ *  \brief Estrae un frame dalla lista dei frame liberi di uno shard
+ *  \return              Il frame estratto, NULL se la lista e' vuota
+ */
+static frame_t *
+take_free_frame(struct mmu_shard *s)
+{
+    frame_t *f;
+
+    if (!__atomic_load_n(&s->free_count, __ATOMIC_RELAXED))
+        return NULL;
+    pthread_mutex_lock(&s->free_lock);
+    if ((f = TAILQ_FIRST(&s->free_frames))) {
+        TAILQ_REMOVE(&s->free_frames, f, entries);
+        s->free_count--;
+    }
+    pthread_mutex_unlock(&s->free_lock);
+    return f;
+}
+
+
+/*! \fn frame_t *steal_free_frame(struct mmu_shard *s)
+ *  \brief Sottrae un frame libero ad un altro shard
+ *  \details Gli shard vengono esaminati a partire dal successivo. Uno shard
+ *  cede un frame soltanto se gliene resta almeno un altro: quando i frame
+ *  liberi sono esauriti ovunque, ogni shard possiede quindi almeno un frame
+ *  utilizzato da proporre alla propria politica di rimpiazzo.
+ *  \param s             Shard che ha esaurito i frame liberi
+ *  \return              Il frame sottratto, NULL se nessuno shard ne dispone
+ */
+static frame_t *
+steal_free_frame(struct mmu_shard *s)
+{
+    struct mmu_shard *v;
+    frame_t *f = NULL;
+    unsigned i;
+
+    for (i = 1; i < mmu.shards && !f; i++) {
+        v = &shards[(s->id + i) % mmu.shards];
+        if (!__atomic_load_n(&v->free_count, __ATOMIC_RELAXED))
+            continue;
+        pthread_mutex_lock(&v->free_lock);
+        if (v->owned > 1 && (f = TAILQ_FIRST(&v->free_frames))) {
+            TAILQ_REMOVE(&v->free_frames, f, entries);
+            v->free_count--;
+            v->owned--;
+        }
+        pthread_mutex_unlock(&v->free_lock);
+    }
+    if (f) {
+        pthread_mutex_lock(&s->free_lock);
+        s->owned++;
+        pthread_mutex_unlock(&s->free_lock);
+        s->stats.steals++;
+    }
+    return f;
+}
+
+
+/*! \fn int resolve_page(struct mmu_shard *s, int procnum, uint64_t page, int update_stats, frame_t **frame)
+ *  \brief Risoluzione di un riferimento ad una pagina
+ *  \details La funzione resolve_page viene invocata direttamente dal thread
+ *  "mmu": se la pagina non e' presente in memoria, le associa un frame
+ *  libero dello shard, un frame libero sottratto ad un altro shard oppure,
+ *  in mancanza, il frame scelto dalla politica di rimpiazzo dello shard.
+ *  Ogni evento viene notificato alla politica in uso.\n
+ *  La voce della pagina viene cercata percorrendo la tabella a piu' livelli:
+ *  il numero di livelli visitati e' registrato nelle statistiche. I nodi
+ *  mancanti vengono allocati soltanto in caso di fault.
+ *  \param s             Shard che serve il processo
  *  \param procnum       Identificativo del processo chiamante
- *  \param page          Pagina virtuale che ha generato il fault
+ *  \param page          Pagina virtuale referenziata
  *  \param update_stats  Se vale uno (1) vengono aggiornate le statistiche
  *  \param frame         Se diverso da NULL, viene registrato il frame identificato
  *  \return              restituisce 1 se e stato un page hit, 0 per un fault
  *  \sa thread_mmu
  */
 static int
-second_chance(int procnum, uint16_t page, int update_stats, frame_t **frame)
+resolve_page(struct mmu_shard *s, int procnum, uint64_t page, int update_stats,
+             frame_t **frame)
 {
-    active_page_t *ap;
     proc_t *current_proc;
-    unsigned int frame_id;
+    page_t *pte;
+    unsigned depth;
     int result;
     frame_t *f;
     
     current_proc = proc_table[procnum];
-    f = NULL;
+    pte = pt_walk(&current_proc->page_table, page, 0, &depth);
+    s->stats.pt_walks++;
+    s->stats.pt_walk_levels += depth;
     
     /* 
      *  Verifico se la pagina richiesta e' presente, ovvero se risulta gia'
      *  associata ad un frame fisico.
      */
-    if (IS_PAGE_PRESENT(current_proc->page_table[page])) {
+    if (pte && IS_PAGE_PRESENT(*pte)) {
         /*
          *  La pagina e' presente: incremento la statistica degli HIT,
-         *  ottengo l'ID del frame associato e lo cerco all'interno della
-         *  lista dei frame utilizzati: una volta trovato, imposto ad uno
-         *  il bit Reference.
+         *  ottengo l'ID del frame associato, con il quale accedo 
+         *  direttamente alla tabella dei frame, ed imposto ad uno il bit
+         *  Reference.
          */
-        frame_id = FRAME_ID(current_proc->page_table[page]);
-        if (update_stats)
-            mmu.page_hits++;
+        f = &frame_table[FRAME_ID(*pte)];
+        PAGE_SET_REFERENCED(*pte);
         result = 1;
-        
-        STAILQ_FOREACH(f, &used_frames_head, entries) {
-            if (frame_id == f->id) {
-                PAGE_SET_REFERENCED(current_proc->page_table[page]);
-                break;
-            }
+        if (update_stats) {
+            s->stats.page_hits++;
+            POLICY_HIT(s->policy, f);
         }
-#ifdef VM_DEBUG
-        assert(frame_id == f->id);
-#endif /* VM_DEBUG */
     } else {
         /*
          *  La pagina richiesta non e' presente in memoria. Aggiorno il
          *  contatore dei FAULT e verifico se:
-         *    1. sono disponibili dei frame non ancora utilizzati
-         *    2. viceversa, devo individuare quale frame liberare.
+         *    1. sono disponibili dei frame non ancora utilizzati, propri
+         *       oppure di un altro shard
+         *    2. viceversa, devo chiedere alla politica quale frame liberare.
          */
         result = 0;
         if (update_stats) {
-            mmu.page_faults++;
+            s->stats.page_faults++;
             current_proc->stats.page_faults++;
         } 
+        if (!pte)
+            pte = pt_walk(&current_proc->page_table, page, 1, NULL);
         
-        if (STAILQ_EMPTY(&free_frames_head)) {
-            /*
-             *  La lista dei frame liberi e' vuota: applico l'algoritmo
-             *  "enhanced second chance"
-             */
-            int proc_found, page_found;
-            
-            page_found = proc_found = -1;
-            
-            /*
-             *  Inizio a scorrere la lista delle pagine associate a frame,
-             *  alla ricerca di una pagina con i bit R e D posti a zero; se
-             *  trovo una pagina con il bit D uguale ad uno, ne effettuo
-             *  una copia su disco (write back) e pongo il bit a zero; se
-             *  trovo una pagina con il bit R uguale ad uno, lo pongo uguale
-             *  a zero e continuo la ricerca.
-             */
-            while (page_found == -1) {
-                TAILQ_FOREACH(ap, &active_page_head, entries) {
-                    if (IS_PAGE_DIRTY(proc_table[ap->procnum]->page_table[ap->page_id])) {
-                        fprintf(proc_table[ap->procnum]->log_file,
-                                "Write-back della pagina %d\n", ap->page_id);
-                        PAGE_CLEAR_DIRTY(proc_table[ap->procnum]->page_table[ap->page_id]);
-                        PAGE_CLEAR_REFERENCED(proc_table[ap->procnum]->page_table[ap->page_id]);
-                        continue;
-                    }
-                    if (!IS_PAGE_REFERENCED(proc_table[ap->procnum]->page_table[ap->page_id])
-                        && !IS_PAGE_DIRTY(proc_table[ap->procnum]->page_table[ap->page_id])) {
-                        proc_found = ap->procnum;
-                        page_found = ap->page_id;
-                        break;
-                    } else {
-                        if (IS_PAGE_REFERENCED
-                            (proc_table[ap->procnum]->page_table
-                             [ap->page_id])) {
-                            PAGE_CLEAR_REFERENCED(proc_table[ap->procnum]->page_table[ap->page_id]);
-                            continue;
-                        }
-                    }
-                }
-            }
-            
-#ifdef VM_DEBUG
-            assert(IS_PAGE_REFERENCED(proc_table[proc_found]->page_table[page_found]) == 0);
-            assert(IS_PAGE_DIRTY(proc_table[proc_found]->page_table[page_found]) == 0);
-#endif /* VM_DEBUG */
-            
-            /*
-             *  E' stata identificato il processo che possiede la pagina da
-             *  rimuovere dalla memoria: ne estraggo il frame ID.
-             */
-            frame_id = FRAME_ID(proc_table[proc_found]->page_table[page_found]);
-            
-            /*
-             *  Elimino l'associazione tra la pagina identificata ed il 
-             *  frame associato: questo implica porre uguale a zero anche i
-             *  bit R e D, nonche' rimuoverlo dalla lista active_pages.
-             */
-            fprintf(current_proc->log_file,
-                    "<-- La pagina %d del processo %d e stata rimossa "
-                    "dalla memoria %s(frame %d)\n", page_found, proc_found,
-                    (IS_PAGE_DIRTY(proc_table[proc_found]->page_table[page_found]) ?
-                     "e paginata su disco " : ""),
-                    FRAME_ID(proc_table[proc_found]->page_table[page_found]));
-            
-            PAGE_CLEAR_PRESENT(proc_table[proc_found]->page_table[page_found]);
-            PAGE_CLEAR_REFERENCED(proc_table[proc_found]->page_table[page_found]);
-            PAGE_CLEAR_DIRTY(proc_table[proc_found]->page_table[page_found]);
-            PAGE_CLEAR_FRAMEID(proc_table[proc_found]->page_table[page_found]);
-            
-            TAILQ_REMOVE(&active_page_head, ap, entries);
-            XFREE(ap);
-            
-            /* 
-             *  Tramite il frame ID ottenuto in precedenza, cerco il frame 
-             *  nella lista used_frames per associarvi la nuova pagina;
-             *  analogamente inserisco una nuova voce nella lista 
-             *  active_pages.
-             */
-            STAILQ_FOREACH(f, &used_frames_head, entries) {
-                if (frame_id == f->id) {
-                    PAGE_SET_REFERENCED(current_proc->page_table[page]);
-                    PAGE_SET_PRESENT(current_proc->page_table[page]);
-                    PAGE_SET_FRAMEID(current_proc->page_table[page], frame_id);
-                    ASSIGN_FRAME_TO_PROC(f, current_proc, page);
-                    STAILQ_REMOVE(&used_frames_head, f, frame, entries);
-                    STAILQ_INSERT_TAIL(&used_frames_head, f, entries);
-                    
-                    ap = XMALLOC(active_page_t, 1);
-                    ap->procnum = current.procnum;
-                    ap->page_id = page;
-                    TAILQ_INSERT_TAIL(&active_page_head, ap, entries);
-                    
-                    fprintf(current_proc->log_file,
-                            "--> La pagina virtuale %d e' stata "
-                            "associata al frame %u\n", page, f->id);
-                    break;
-                }
-            }
-        } else {
-            /*
-             *  La pagina richiesta non e' presente (page fault) ma la lista
-             *  dei frame liberi non e' vuota: prendo il primo frame
-             *  disponibile e lo associo alla pagina.
-             */
-            f = STAILQ_FIRST(&free_frames_head);
-            STAILQ_REMOVE_HEAD(&free_frames_head, entries);
+        s->policy->capacity = __atomic_load_n(&s->owned, __ATOMIC_RELAXED);
+        if ((f = take_free_frame(s)) || (f = steal_free_frame(s))) {
             assert(f->valid == 0);
             f->valid = 1;
-            ASSIGN_FRAME_TO_PROC(f, current_proc, page);
-            STAILQ_INSERT_TAIL(&used_frames_head, f, entries);
-            
-            fprintf(current_proc->log_file,
-                    "--> La pagina virtuale %d e' stata associata al frame %u\n", 
-                    page, f->id);
-            
-            PAGE_SET_PRESENT(current_proc->page_table[page]);
-            PAGE_SET_REFERENCED(current_proc->page_table[page]);
-            PAGE_SET_FRAMEID(current_proc->page_table[page], f->id);
-            
-            ap = XMALLOC(active_page_t, 1);
-            ap->procnum = current.procnum;
-            ap->page_id = page;
-            TAILQ_INSERT_TAIL(&active_page_head, ap, entries);
+        } else {
+            f = POLICY_VICTIM(s->policy, procnum, page);
+#ifdef VM_DEBUG
+            assert(f && f->valid);
+#endif /* VM_DEBUG */
+            evict_page(s, current_proc, f);
+            TAILQ_REMOVE(&s->used_frames, f, entries);
         }
+        
+        /*
+         *  Associo il frame alla pagina, lo inserisco in coda alla lista
+         *  dei frame utilizzati e notifico il caricamento alla politica.
+         */
+        ASSIGN_FRAME_TO_PROC(f, current_proc, page, pte);
+        TAILQ_INSERT_TAIL(&s->used_frames, f, entries);
+        
+        MMU_LOG(current_proc,
+                "--> La pagina virtuale %" PRIu64 " e' stata associata al "
+                "frame %u\n", page, f->id);
+        
+        PAGE_SET_PRESENT(*pte);
+        PAGE_SET_REFERENCED(*pte);
+        PAGE_SET_FRAMEID(*pte, f->id);
+        POLICY_FAULT(s->policy, f, procnum, page);
     }
     
     if (frame)
@@ -283,128 +393,313 @@ second_chance(int procnum, uint16_t page, int update_stats, frame_t **frame)
 }
 
 
-/*! \fn void *thread_mmu(void *pArg)
- *  \brief Thread MMU
- *  \details La funzione, eseguita come thread, emula il modulo MMU per la
- *  traduzione degli indirizzi virtuali in fisici e l'implementazione
- *  dell'algoritmo enhanced sencond chance
- *  \param pArg        inutilizzato
- *  \return            valore di uscita del thread (inutilizzato)
+/*! \fn void translate(struct mmu_shard *s, int procnum, struct mmu_request *req, struct mmu_response *resp)
+ *  \brief Traduzione di un indirizzo virtuale
+ *  \details Estrae pagina ed offset dall'indirizzo virtuale richiesto dal
+ *  processo, invoca l'algoritmo di rimpiazzo ed applica, se attiva, la
+ *  paginazione anticipata sulle pagine adiacenti.
+ *  \param s           Shard che serve il processo
+ *  \param procnum     Identificativo del processo all'interno della proc table
+ *  \param req         Richiesta estratta dalla coda del processo
+ *  \param resp        Risposta da restituire al processo
  */
-static void *
-thread_mmu(void *pArg)
+static void
+translate(struct mmu_shard *s, int procnum, struct mmu_request *req,
+          struct mmu_response *resp)
 {
-    active_page_t *ap, *ap_temp;
     proc_t *current_proc;
     frame_t *f;
-    uint16_t page;
+    page_t *pte;
+    uint64_t page;
+    uint64_t ws[3];
     uint16_t offset;
-    uint16_t ws[3];
     int result;
+
+    /*
+     *  La richiesta contiene l'indirizzo virtuale dal quale estraggo
+     *  l'identificativo della pagina virtuale e l'offset; il PID del processo
+     *  e' utile per accedere alla sua tabella delle pagine.
+     */
+    current_proc = proc_table[procnum];
+    ws[0] = page = req->virtual_address >> mmu.offset_bits;
+#ifdef VM_DEBUG
+    if (page > current_proc->page_count) {
+        fprintf(stderr, "PROC = %d, PAGE_COUNT = %" PRIu64 ", PAGE = %" PRIu64
+                ", ADDRESS = %" PRIu64 "\n", procnum,
+                current_proc->page_count, page, req->virtual_address);
+        assert(0);
+    }
+#endif /* VM_DEBUG */
+    offset = req->virtual_address & mmu.offset_mask;
+
+    MMU_LOG(current_proc,
+            "\n%s indirizzo virtuale %" PRIu64 " [pagina %" PRIu64
+            " - offset %d]\n", req->rw ? "Scrittura" : "Lettura",
+            req->virtual_address, page, offset);
+
+    result = resolve_page(s, procnum, page, 1, &f);
+#ifdef VM_DEBUG
+    assert(f);
+#endif /* VM_DEBUG */
+    pte = f->owner.pte;
+
+    if (anticipatory_paging) {
+        ws[1] = (page > 0)?page-1:(uint64_t)-1;
+        ws[2] = (page < (current_proc->page_count-1))?page+1:(uint64_t)-1;
+        if (ws[1] != (uint64_t) -1 &&
+            !resolve_page(s, procnum, ws[1], 0, NULL) && fault_io)
+            io_device_prefetch(procnum);
+        if (ws[2] != (uint64_t) -1 &&
+            !resolve_page(s, procnum, ws[2], 0, NULL) && fault_io)
+            io_device_prefetch(procnum);
+    }
+
+    resp->translated_address = f->physical_addr + offset;
+    resp->hit = result;
+    MMU_LOG(current_proc,
+            "[PAGE %s] L'indirizzo virtuale %" PRIu64 " corrisponde al "
+            "fisico %" PRIu64 "\n", result?"HIT":"FAULT", req->virtual_address,
+            resp->translated_address);
+    if (req->rw)
+        PAGE_SET_DIRTY(*pte);
     
-    printf("--> Thread MMU avviato\n    [RAM=%d, PAGESIZE=%d, "
-           "PHYS-FRAMES=%d, TOTAL_READ=%d, PROC=%d]\n",
-           mmu.ram_size, mmu.page_size, mmu.max_page_count,
-           mmu.total_access, max_proc);
+    /*
+     *  Carico la traduzione nel TLB del processo: le successive richieste
+     *  alla stessa pagina non raggiungeranno la MMU.
+     */
+    if (TLB_ENABLED(&current_proc->tlb))
+        tlb_fill(&current_proc->tlb, page, f->id, pte, IS_PAGE_DIRTY(*pte));
+}
+
+
+/*! \fn int requests_pending(struct mmu_shard *s)
+ *  \brief Verifica se almeno un processo dello shard ha richieste in coda
+ *  \return            1 se esiste almeno una richiesta da servire
+ */
+static int
+requests_pending(struct mmu_shard *s)
+{
+    int i;
+
+    for (i = s->id; i < max_proc; i += mmu.shards) {
+        struct mmu_ring *r = &proc_table[i]->ring;
+        if (__atomic_load_n(&r->req_tail, __ATOMIC_SEQ_CST) != r->req_head)
+            return 1;
+    }
+    return 0;
+}
+
+
+/*! \fn uint64_t completed_requests()
+ *  \brief Restituisce il numero di accessi completati
+ *  \details Somma le richieste servite dagli shard della MMU e quelle
+ *  risolte dai TLB dei processi.
+ */
+static uint64_t
+completed_requests()
+{
+    uint64_t n = __atomic_load_n(&mmu_completed, __ATOMIC_SEQ_CST);
+    int i;
+
+    for (i = 0; i < max_proc; i++)
+        n += __atomic_load_n(&proc_table[i]->stats.tlb_hits, __ATOMIC_RELAXED);
+    return n;
+}
+
+
+/*! \fn void wait_for_requests(struct mmu_shard *s)
+ *  \brief Sospende il thread dello shard fintanto che le code sono vuote
+ *  \details Il thread dichiara la propria attesa (idle) e ricontrolla le
+ *  code: un processo che inserisce una richiesta dopo il controllo vedra'
+ *  necessariamente idle ad uno e provvedera' a risvegliare lo shard.
+ *  \sa mmu_notify
+ */
+static void
+wait_for_requests(struct mmu_shard *s)
+{
+    pthread_mutex_lock(&s->idle_lock);
+    __atomic_store_n(&s->idle, 1, __ATOMIC_SEQ_CST);
+    if (!requests_pending(s) &&
+        !__atomic_load_n(&admission_closed, __ATOMIC_SEQ_CST)) {
+        while (__atomic_load_n(&s->idle, __ATOMIC_SEQ_CST))
+            pthread_cond_wait(&s->idle_cond, &s->idle_lock);
+    }
+    __atomic_store_n(&s->idle, 0, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&s->idle_lock);
+}
+
+
+/*! \fn void mmu_notify(struct mmu_shard *s)
+ *  \brief Risveglia il thread dello shard se sospeso
+ *  \details Invocata da memory_access dopo aver pubblicato una richiesta.
+ *  \sa wait_for_requests
+ */
+static void
+mmu_notify(struct mmu_shard *s)
+{
+    RING_FENCE();
+    if (__atomic_load_n(&s->idle, __ATOMIC_SEQ_CST)) {
+        pthread_mutex_lock(&s->idle_lock);
+        __atomic_store_n(&s->idle, 0, __ATOMIC_SEQ_CST);
+        pthread_cond_signal(&s->idle_cond);
+        pthread_mutex_unlock(&s->idle_lock);
+    }
+}
+
+
+/*! \fn void *thread_shard(void *pArg)
+ *  \brief Thread di uno shard della MMU
+ *  \details La funzione, eseguita come thread, emula la MMU per i processi
+ *  dello shard, delegando la scelta delle pagine da rimuovere alla politica
+ *  di rimpiazzo dello shard.\n
+ *  Le code dei processi vengono scorse in modo circolare: da ognuna vengono
+ *  servite fino a MMU_BATCH richieste, pubblicando le risposte con un'unica
+ *  scrittura dell'indice e risvegliando il processo solo se sospeso.
+ *  \param pArg        shard da servire
+ *  \return            valore di uscita del thread (inutilizzato)
+ */
+static void *
+thread_shard(void *pArg)
+{
+    struct mmu_shard *s = pArg;
+    struct mmu_ring *r;
+    uint32_t head, tail, rtail;
+    int i, served;
+    
+    /*
+     *  La proc table viene creata dopo l'avvio della MMU: attendo che il
+     *  primo processo inserisca una richiesta prima di scorrere le code.
+     */
+    pthread_mutex_lock(&s->idle_lock);
+    while (__atomic_load_n(&s->idle, __ATOMIC_SEQ_CST))
+        pthread_cond_wait(&s->idle_cond, &s->idle_lock);
+    pthread_mutex_unlock(&s->idle_lock);
     
     /*
      *  Fintanto che non venga raggiunto il numero totale di accessi, il
-     *  thread resta in attesa di processere nuove richieste.
+     *  thread resta in attesa di processare nuove richieste.
      */
-    while (!mmu_should_exit) {
-        pthread_mutex_lock(&current.lock);
-        while (current.status != DATA_AVAILABLE)
-            pthread_cond_wait(&current.condition, &current.lock);
-        
-        if (mmu_should_exit) {
-            pthread_mutex_unlock(&current.lock);
-            break;
+    for (;;) {
+        for (served = 0, i = s->id; i < max_proc; i += mmu.shards) {
+            r = &proc_table[i]->ring;
+            head = r->req_head;
+            tail = RING_LOAD(r->req_tail);
+            if (head == tail)
+                continue;
+            if (tail - head > MMU_BATCH)
+                tail = head + MMU_BATCH;
+            
+            served += tail - head;
+            for (rtail = r->resp_tail; head != tail; head++, rtail++)
+                translate(s, i, &r->req[head & MMU_RING_MASK],
+                          &r->resp[rtail & MMU_RING_MASK]);
+            
+            RING_STORE(r->req_head, head);
+            RING_STORE(r->resp_tail, rtail);
+            ring_wake(r);
         }
         
+        if (served) {
+            __atomic_add_fetch(&mmu_completed, served, __ATOMIC_SEQ_CST);
+            continue;
+        }
+        if (completed_requests() >= mmu.total_access)
+            break;
         /*
-         *  La variabile "current" contiene i dati della richiesta da esaminare,
-         *  tra cui il PID del processo che ha effettuato la richiesta (utile
-         *  per accedere alla sua tabella delle pagine) e l'indirizzo virtuale
-         *  dal quale estraggo l'identificativo della pagina virtuale e l'offset.
+         *  Se le ammissioni sono chiuse, le richieste mancanti sono gia' in 
+         *  corso (TLB, inserimento in coda o altri shard): cedo la CPU senza
+         *  sospendermi.
          */
-        current_proc = proc_table[current.procnum];
-        ws[0] = page = current.virtual_address >> mmu.offset_bits;
-#ifdef VM_DEBUG
-        if (page > current_proc->page_count) {
-            fprintf(stderr, "PROC = %d, PAGE_COUNT = %d, PAGE = %d, "
-                    "ADDRESS = %d\n", current.procnum, 
-                    current_proc->page_count, page, current.virtual_address);
-            assert(0);
-        }
-#endif /* VM_DEBUG */
-        offset = current.virtual_address & mmu.offset_mask;
-    
-        fprintf(current_proc->log_file,
-                "\n%s indirizzo virtuale %u [pagina %d - offset %d]\n",
-                current.rw ? "Scrittura" : "Lettura",
-                current.virtual_address, page, offset);
-        
-        
-        result = second_chance(current.procnum, page, 1, &f);
-#ifdef VM_DEBUG
-        assert(f);
-#endif /* VM_DEBUG */
-        
-        if (anticipatory_paging) {
-            ws[1] = (page > 0)?page-1:(uint16_t)-1;
-            ws[2] = (page < (current_proc->page_count-1))?page+1:(uint16_t)-1;
-            if (ws[1] != (uint16_t) -1)
-                second_chance(current.procnum, ws[1], 0, NULL);
-            if (ws[2] != (uint16_t) -1)
-                second_chance(current.procnum, ws[2], 0, NULL); 
-        }
-        
-        current_proc->stats.mem_accesses++;
-        current.translated_address = f->physical_addr + offset;
-        current.status = RESULT_AVAILABLE;
-        fprintf(current_proc->log_file,
-                "[PAGE %s] L'indirizzo virtuale %u corrisponde al fisico %u\n",
-                result?"HIT":"FAULT", current.virtual_address,
-                current.translated_address);
-        if (current.rw)
-            PAGE_SET_DIRTY(current_proc->page_table[page]);
-        
-        pthread_mutex_unlock(&current.lock);
-        pthread_cond_signal(&current.condition);
+        if (__atomic_load_n(&admission_closed, __ATOMIC_SEQ_CST))
+            sched_yield();
+        else
+            wait_for_requests(s);
     }
+    
     /*
-     *  Dealloco la lista delle pagine utilizzate.
+     *  Tutti gli accessi sono stati completati: risveglio gli altri shard,
+     *  che potrebbero essere sospesi se i loro processi hanno terminato gli
+     *  accessi senza che alcuna richiesta venisse rifiutata (traccia).
      */
-    TAILQ_FOREACH_SAFE(ap, &active_page_head, entries, ap_temp) {
-        TAILQ_REMOVE(&active_page_head, ap, entries);
-        XFREE(ap);
+    __atomic_store_n(&admission_closed, 1, __ATOMIC_SEQ_CST);
+    for (i = 0; i < (int) mmu.shards; i++)
+        mmu_notify(&shards[i]);
+    return NULL;
+}
+
+
+/*! \fn void collect_stats()
+ *  \brief Raccoglie le statistiche degli shard nella variabile "mmu"
+ *  \details Registra anche la lunghezza complessiva delle scansioni e
+ *  dealloca le politiche di rimpiazzo e la tabella dei frame.
+ */
+static void
+collect_stats()
+{
+    struct mmu_shard *s;
+    
+    for (s = shards; s < shards + mmu.shards; s++) {
+        mmu.page_hits += s->stats.page_hits;
+        mmu.page_faults += s->stats.page_faults;
+        mmu.evictions += s->stats.evictions;
+        mmu.pt_walks += s->stats.pt_walks;
+        mmu.pt_walk_levels += s->stats.pt_walk_levels;
+        mmu.steals += s->stats.steals;
+        mmu.scanned += s->policy->scanned;
+        policy_destroy(s->policy);
     }
+    XFREE(frame_table);
+}
+
+
+/*! \fn void *thread_mmu(void *pArg)
+ *  \brief Thread MMU
+ *  \details Avvia i thread degli shard successivi al primo, serve
+ *  direttamente il primo shard e, al termine, raccoglie le statistiche di
+ *  tutti gli shard nella variabile "mmu".
+ *  \param pArg        inutilizzato
+ *  \return            valore di uscita del thread (inutilizzato)
+ */
+static void *
+thread_mmu(void *pArg)
+{
+    unsigned i;
+    
+    printf("--> Thread MMU avviato\n    [RAM=%" PRIu64 ", PAGESIZE=%u, "
+           "PHYS-FRAMES=%u, TOTAL_READ=%" PRIu64 ", PROC=%d, POLICY=%s, "
+           "SHARDS=%u]\n", mmu.ram_size, mmu.page_size, mmu.max_page_count,
+           mmu.total_access, max_proc, shards[0].policy->ops->name,
+           mmu.shards);
+    
+    for (i = 1; i < mmu.shards; i++)
+        pthread_create(&shards[i].tid, NULL, &thread_shard, &shards[i]);
+    thread_shard(&shards[0]);
+    
+    for (i = 1; i < mmu.shards; i++)
+        pthread_join(shards[i].tid, NULL);
+    collect_stats();
     printf("<-- Thread MMU terminato\n");
     pthread_exit(NULL);
 }
 
 
-/*! \fn pthread_t *mmu_init(int max_read, int ram_size, int page_size)
- *  \brief Inizializzazione MMU
- *  \details La funzione inizializza il modulo MMU, valorizzando la variabile
- *  "mmu" con i parametri che descrivono l'ambiente. I valori total_access, 
- *  page_size e ram_size sono modificabili mediante l'uso degli opportuni
- *  parametri da riga di comando. Una volta suddivisa la memoria in frame,
- *  verra' creato il thread MMU.
- *  \param max_read      Numero massimo di accessi alla memoria
- *  \param ram_size      Dimensione complessiva della memoria principale
- *  \param page_size     Dimensione della singola pagina/frame
- *  \return              Puntatore al thread ID della MMU
- *  \sa thread_mmu
+/*! \fn void mmu_setup(uint64_t max_read, uint64_t ram_size, int page_size)
+ *  \brief Valorizza la variabile "mmu" e suddivide la memoria in frame
+ *  \sa mmu_init
  */
-pthread_t *mmu_init(int max_read, int ram_size, int page_size)
+static void
+mmu_setup(uint64_t max_read, uint64_t ram_size, int page_size)
 {
-    pthread_t *tid = XMALLOC(pthread_t, 1);
-    int i, ret;
+    struct mmu_shard *s;
+    uint32_t i, first, last;
     
-    mmu_should_exit = 0;
+    mmu_issued = mmu_completed = 0;
+    admission_closed = 0;
     mmu.total_access = max_read;
     mmu.page_hits = mmu.page_faults = 0;
+    mmu.evictions = mmu.write_backs = mmu.scanned = 0;
+    mmu.pt_walks = mmu.pt_walk_levels = 0;
+    mmu.steals = 0;
     mmu.page_size = page_size;
     mmu.ram_size = ram_size;
     mmu.max_page_count = (mmu.ram_size / mmu.page_size);
@@ -417,108 +712,344 @@ pthread_t *mmu_init(int max_read, int ram_size, int page_size)
         anticipatory_paging = 0;
     
     /*
-     *  Inizializza la lista dei frame usati e liberi e delle pagine residenti
-     *  in memoria (ovvero associate ad un frame.
+     *  Ogni shard deve servire almeno un processo e possedere almeno un
+     *  frame.
      */
-    STAILQ_INIT(&free_frames_head);
-    STAILQ_INIT(&used_frames_head);
-    TAILQ_INIT(&active_page_head);
+    mmu.shards = mmu_threads ? mmu_threads : 1;
+    if (mmu.shards > (uint32_t) max_proc)
+        mmu.shards = max_proc;
+    if (mmu.shards > mmu.max_page_count)
+        mmu.shards = mmu.max_page_count;
     
     /*
-     *  Suddivide la memoria in frame e li inserisce nella lista dei
-     *  frame liberi. Crea infine il thread che emula l'MMU.
+     *  Suddivide la memoria in frame, allocati in un'unica tabella, e ne
+     *  assegna ad ogni shard una porzione contigua, inserendola nella lista
+     *  dei frame liberi. Le politiche degli shard sono indicizzate dal
+     *  frame-id sull'intera tabella, cosi' che un frame sottratto ad un altro
+     *  shard possa esservi inserito.
      */
-    for (i = 0; i < mmu.max_page_count; i++) {
-        frame_t *f = XMALLOC(frame_t, 1);
-        f->id = i;
-        f->physical_addr = i * mmu.page_size;
-        f->valid = 0;
-        if (STAILQ_EMPTY(&free_frames_head))
-            STAILQ_INSERT_HEAD(&free_frames_head, f, entries);
-        else
-            STAILQ_INSERT_TAIL(&free_frames_head, f, entries);
+    frame_table = XMALLOC(frame_t, mmu.max_page_count);
+    shards = XMALLOC(struct mmu_shard, mmu.shards);
+    memset(shards, 0, mmu.shards * sizeof(struct mmu_shard));
+    for (s = shards; s < shards + mmu.shards; s++) {
+        s->id = s - shards;
+        first = (uint64_t) mmu.max_page_count * s->id / mmu.shards;
+        last = (uint64_t) mmu.max_page_count * (s->id + 1) / mmu.shards;
+        TAILQ_INIT(&s->free_frames);
+        TAILQ_INIT(&s->used_frames);
+        for (i = first; i < last; i++) {
+            frame_t *f = &frame_table[i];
+            f->id = i;
+            f->physical_addr = (uint64_t) i * mmu.page_size;
+            f->valid = 0;
+            TAILQ_INSERT_TAIL(&s->free_frames, f, entries);
+        }
+        s->free_count = s->owned = last - first;
+        s->idle = 1;
+        pthread_mutex_init(&s->free_lock, NULL);
+        pthread_mutex_init(&s->idle_lock, NULL);
+        pthread_cond_init(&s->idle_cond, NULL);
+        s->policy = policy_create(replacement_policy, frame_table,
+                                  mmu.max_page_count, s->owned);
     }
+}
+
+
+/*! \fn pthread_t *mmu_init(uint64_t max_read, uint64_t ram_size, int page_size)
+ *  \brief Inizializzazione MMU
+ *  \details La funzione inizializza il modulo MMU, valorizzando la variabile
+ *  "mmu" con i parametri che descrivono l'ambiente. I valori total_access, 
+ *  page_size e ram_size sono modificabili mediante l'uso degli opportuni
+ *  parametri da riga di comando. Una volta suddivisa la memoria in frame,
+ *  verra' creato il thread MMU.
+ *  \param max_read      Numero massimo di accessi alla memoria
+ *  \param ram_size      Dimensione complessiva della memoria principale
+ *  \param page_size     Dimensione della singola pagina/frame
+ *  \return              Puntatore al thread ID della MMU
+ *  \sa thread_mmu
+ */
+pthread_t *mmu_init(uint64_t max_read, uint64_t ram_size, int page_size)
+{
+    pthread_t *tid = XMALLOC(pthread_t, 1);
+    int ret;
+    
+    mmu_setup(max_read, ram_size, page_size);
     ret = pthread_create(tid, NULL, &thread_mmu, NULL);
     
     return (ret == 0) ? tid : NULL;
 }
 
 
-/*! \fn uint32_t memory_access(int procnum, uint32_t address, int rw)
- *  \brief Funzione per la lettura/scrittura di una zona di memoria. 
- *  \details La funzione puo' essere invocata solo da un processo per volta: 
- *  questa inserisce i dati della richiesta in una struttura temporanea 
- *  condivisa con l'MMU, risveglia l'MMU perche' processi la richiesta 
- *  e resta in attesa del risultato.
- *  \param procnum       Identificativo processo nella page table
+/*! \fn void mmu_direct_init(uint64_t max_read, uint64_t ram_size, int page_size)
+ *  \brief Inizializzazione della MMU per la riproduzione diretta
+ *  \details Come mmu_init, ma senza creare alcun thread: gli accessi vengono
+ *  tradotti da mmu_direct_access nel thread chiamante, con un unico shard e
+ *  senza scrivere i log dei processi. Al termine va invocata
+ *  mmu_direct_finish.
+ *  \sa mmu_init
+ */
+void mmu_direct_init(uint64_t max_read, uint64_t ram_size, int page_size)
+{
+    mmu_threads = 1;
+    mmu_log = 0;
+    mmu_setup(max_read, ram_size, page_size);
+    printf("--> MMU in riproduzione diretta\n    [RAM=%" PRIu64 ", PAGESIZE=%u, "
+           "PHYS-FRAMES=%u, TOTAL_READ=%" PRIu64 ", PROC=%d, POLICY=%s]\n",
+           mmu.ram_size, mmu.page_size, mmu.max_page_count,
+           mmu.total_access, max_proc, shards[0].policy->ops->name);
+}
+
+
+/*! \fn void mmu_direct_finish()
+ *  \brief Termina la riproduzione diretta e ne raccoglie le statistiche
+ */
+void mmu_direct_finish()
+{
+    collect_stats();
+}
+
+
+/*! \fn void mmu_destroy()
+ *  \brief Dealloca gli shard della MMU
+ *  \details Gli shard sopravvivono al thread MMU, poiche' i processi ancora
+ *  attivi possono tentare di risvegliarli: la funzione va invocata dopo la
+ *  terminazione di tutti i processi.
+ */
+void mmu_destroy()
+{
+    unsigned i;
+
+    for (i = 0; i < mmu.shards; i++) {
+        pthread_mutex_destroy(&shards[i].free_lock);
+        pthread_mutex_destroy(&shards[i].idle_lock);
+        pthread_cond_destroy(&shards[i].idle_cond);
+    }
+    XFREE(shards);
+}
+
+
+/*! \fn int tlb_translate(proc_t *proc, uint64_t address, int rw, uint64_t *result)
+ *  \brief Traduzione di un indirizzo tramite il TLB del processo
+ *  \details Eseguita dal processo chiamante, senza coinvolgere la MMU. Come
+ *  l'hardware, il TLB imposta il bit Reference della pagina; la voce viene
+ *  poi ricontrollata, cosi' che un'invalidazione concorrente da parte della
+ *  MMU trasformi l'accesso in un miss.
+ *  \param proc          Processo chiamante
  *  \param address       Indirizzo virtuale
  *  \param rw            Se vale '0' effettua una lettura, '1' scrittura
- *  \return              Risultato dell'operazione. Restituisce -1 quando MMU
- *                       ha raggiunto il numero massimo di operazioni ed il
- *                       processo deve terminare la propria esecuzione.
+ *  \param result        Indirizzo fisico, in caso di hit
+ *  \return              1 se la traduzione e' stata risolta dal TLB
  */
-uint32_t memory_access(int procnum, uint32_t address, int rw)
+static int
+tlb_translate(proc_t *proc, uint64_t address, int rw, uint64_t *result)
 {
-    static int signaled = 0;
-    uint32_t result = (uint32_t) -1;
+    struct tlb_entry *e;
+    uint32_t frame_id, seq;
+    page_t *pte;
     
-    /*
-     *  Blocco il mutex "mem_read_lock" per garantire la mutua esclusione
-     *  tra due processi concorrenti che tentano l'accesso alla MMU.
-     */
-    pthread_mutex_lock(&mem_read_lock);
+    e = tlb_lookup(&proc->tlb, address >> mmu.offset_bits, rw, &frame_id,
+                   &pte, &seq);
+    if (!e)
+        return 0;
+    
+    PAGE_SET_REFERENCED(*pte);
+    if (!tlb_still_valid(e, seq))
+        return 0;
+    
+    *result = (uint64_t) frame_id * mmu.page_size + (address & mmu.offset_mask);
+    __atomic_store_n(&proc->stats.tlb_hits, proc->stats.tlb_hits + 1,
+                     __ATOMIC_RELAXED);
+    MMU_LOG(proc,
+            "\n[TLB HIT] L'indirizzo virtuale %" PRIu64 " corrisponde al "
+            "fisico %" PRIu64 "\n",
+            address, *result);
+    if (debug && mmu_log)
+        process_info(proc->pid);
+    return 1;
+}
 
-    if (NUM_OF_REQUESTS() < mmu.total_access) {     
-        /*
-         *  Inserisco i dettagli della richiesta in una struttura condivisa
-         *  tra questa funzione ed il thread, protetta dal mutex current.lock.
-         */
-        pthread_mutex_lock(&current.lock);
-        current.procnum = procnum;
-        current.virtual_address = address;
-        current.translated_address = 0;
-        current.rw = rw;
-        current.status = DATA_AVAILABLE;
-        pthread_mutex_unlock(&current.lock);
-        
-        /*
-         * Comunico al thread MMU che e' disponibile una richiesta
-         */
-        pthread_cond_signal(&current.condition);
 
+/*! \fn void submit_requests(int procnum, struct mmu_access **queued, int count)
+ *  \brief Pubblica le richieste inserite nella coda ed attende le risposte
+ *  \details Comunica al thread MMU che sono disponibili "count" richieste,
+ *  attende che vengano tutte espletate e ne copia i risultati negli accessi
+ *  corrispondenti.
+ *  \param procnum       Identificativo processo nella page table
+ *  \param queued        Accessi ai quali corrispondono le richieste
+ *  \param count         Numero di richieste inserite dopo "req_tail"
+ */
+static void
+submit_requests(int procnum, struct mmu_access **queued, int count)
+{
+    struct mmu_ring *r = &proc_table[procnum]->ring;
+    struct mmu_response *resp;
+    int i;
+    
+    RING_STORE(r->req_tail, r->req_tail + count);
+    mmu_notify(SHARD_OF(procnum));
+    ring_wait_response(r, count);
+    for (i = 0; i < count; i++) {
+        resp = &r->resp[(r->resp_head + i) & MMU_RING_MASK];
+        queued[i]->physical_address = resp->translated_address;
+        queued[i]->hit = resp->hit;
+    }
+    RING_STORE(r->resp_head, r->resp_head + count);
+}
+
+
+/*! \fn int memory_access_batch(int procnum, struct mmu_access *v, int n)
+ *  \brief Funzione per la lettura/scrittura di un vettore di indirizzi
+ *  \details Gli accessi vengono ammessi con un'unica operazione atomica; 
+ *  quelli non risolti dal TLB del processo vengono inseriti nella coda con
+ *  un'unica pubblicazione dell'indice (al piu' MMU_RING_SIZE alla volta),
+ *  risvegliando la MMU una sola volta, ed il processo attende tutte le
+ *  risposte insieme. Le traduzioni risolte dal TLB non attendono quelle
+ *  inoltrate alla MMU. Ogni processo possiede una propria coppia di code,
+ *  pertanto piu' processi possono invocare la funzione in modo concorrente
+ *  senza contendersi alcun lock.
+ *  \param procnum       Identificativo processo nella page table
+ *  \param v             Accessi da effettuare: per ognuno vengono
+ *                       restituiti l'indirizzo fisico e l'esito
+ *  \param n             Numero di accessi
+ *  \return              Numero di accessi effettuati, i primi del vettore:
+ *                       se inferiore ad "n", MMU ha raggiunto il numero
+ *                       massimo di operazioni ed il processo deve terminare
+ *                       la propria esecuzione.
+ */
+int memory_access_batch(int procnum, struct mmu_access *v, int n)
+{
+    static int signaled = 0;
+    proc_t *proc = proc_table[procnum];
+    struct mmu_ring *r = &proc->ring;
+    struct mmu_access *queued[MMU_RING_SIZE];
+    uint64_t seq;
+    uint32_t tail;
+    int i, admitted, pending;
+    
+    seq = __atomic_fetch_add(&mmu_issued, n, __ATOMIC_RELAXED);
+    admitted = seq >= mmu.total_access ? 0 :
+               mmu.total_access - seq < (uint64_t) n ?
+               (int) (mmu.total_access - seq) : n;
+    
+    for (i = pending = 0; i < admitted; i++) {
+        proc->stats.mem_accesses++;
+        if (trace_recorder)
+            TRACE_WRITE_RECORD(trace_recorder, seq + i, procnum,
+                               v[i].virtual_address, v[i].rw);
+        if (TLB_ENABLED(&proc->tlb)) {
+            if (tlb_translate(proc, v[i].virtual_address, v[i].rw,
+                              &v[i].physical_address)) {
+                v[i].hit = 1;
+                continue;
+            }
+            proc->stats.tlb_misses++;
+        }
+        
         /*
-         *  Attendo che la richiesta venga espletata dalla MMU: al termine
-         *  il risultato verra' restituito al processo chiamante, il mutex
-         *  rilasciato e l'MMU sara' pronta per una successiva richiesta.
+         *  Inserisco i dettagli della richiesta nella coda del processo:
+         *  l'indice viene pubblicato quando la coda e' piena o al termine
+         *  del vettore.
          */
-        pthread_mutex_lock(&current.lock);
-        while (current.status != RESULT_AVAILABLE)
-            pthread_cond_wait(&current.condition, &current.lock);
-        result = current.translated_address;
-        current.status = EMPTY;
-        pthread_mutex_unlock(&current.lock);
-        
-        if (debug)
-            process_info(procnum);
-    } else {
+        tail = r->req_tail + pending;
+        r->req[tail & MMU_RING_MASK].virtual_address = v[i].virtual_address;
+        r->req[tail & MMU_RING_MASK].rw = v[i].rw;
+        queued[pending++] = &v[i];
+        if (pending == MMU_RING_SIZE) {
+            submit_requests(procnum, queued, pending);
+            pending = 0;
+        }
+    }
+    if (pending)
+        submit_requests(procnum, queued, pending);
+    
+    /*
+     *  Servizio dei fault tramite il dispositivo di I/O: il processo resta
+     *  sospeso per il caricamento di ogni pagina mancante. Le copie su disco
+     *  ed i caricamenti anticipati sono gia' stati accodati dalla MMU.
+     */
+    if (fault_io)
+        for (i = 0; i < admitted; i++)
+            if (!v[i].hit)
+                io_device_page_in(procnum);
+    if (admitted && debug)
+        process_info(procnum);
+    
+    if (seq + n >= mmu.total_access) {
         /*
          *  E' stato raggiunto il numero massimo di accessi alla memoria:
-         *  comunico al thread MMU e del dispositivo I/O di uscire; 
-         *  restituisco un codice d'errore (-1) al processo chiamante,
-         *  perche' questo termini la propria esecuzione.
+         *  comunico al dispositivo I/O di uscire (la MMU termina da se' una 
+         *  volta servite tutte le richieste ammesse); restituisco il numero
+         *  di accessi effettuati al processo chiamante, perche' questo 
+         *  termini la propria esecuzione. Le ammissioni vengono chiuse gia'
+         *  con l'ultimo accesso ammesso: se gli accessi ancora in corso
+         *  venissero tutti risolti dai TLB, nessuna richiesta risveglierebbe
+         *  altrimenti gli shard sospesi.
          */
-        if (!signaled) {
+        if (!__atomic_exchange_n(&signaled, 1, __ATOMIC_RELAXED)) {
+            unsigned j;
+            
             tell_io_device_to_exit();
-            mmu_should_exit = 1;
-            current.status = DATA_AVAILABLE;
-            pthread_cond_signal(&current.condition);
-            signaled = 1;
+            __atomic_store_n(&admission_closed, 1, __ATOMIC_SEQ_CST);
+            for (j = 0; j < mmu.shards; j++)
+                mmu_notify(&shards[j]);
         }
     }
     
-    pthread_mutex_unlock(&mem_read_lock);
+    return admitted;
+}
+
+
+/*! \fn uint64_t memory_access(int procnum, uint64_t address, int rw)
+ *  \brief Funzione per la lettura/scrittura di una zona di memoria. 
+ *  \details Effettua un singolo accesso tramite memory_access_batch.
+ *  \param procnum       Identificativo processo nella page table
+ *  \param address       Indirizzo virtuale
+ *  \param rw            Se vale '0' effettua una lettura, '1' scrittura
+ *  \return              Risultato dell'operazione. Restituisce -1 quando MMU
+ *                       ha raggiunto il numero massimo di operazioni ed il
+ *                       processo deve terminare la propria esecuzione.
+ */
+uint64_t memory_access(int procnum, uint64_t address, int rw)
+{
+    struct mmu_access a;
+    
+    a.virtual_address = address;
+    a.rw = rw;
+    return memory_access_batch(procnum, &a, 1) ? a.physical_address :
+           (uint64_t) -1;
+}
+
+
+/*! \fn int mmu_direct_access(int procnum, uint64_t address, int rw)
+ *  \brief Accesso alla memoria in riproduzione diretta
+ *  \details Consulta il TLB del processo e, in caso di miss, traduce
+ *  l'indirizzo nel thread chiamante: non vi sono code, risvegli ne' attese.
+ *  Il chiamante non deve superare mmu.total_access accessi.
+ *  \param procnum       Identificativo processo nella page table
+ *  \param address       Indirizzo virtuale
+ *  \param rw            Se vale '0' effettua una lettura, '1' scrittura
+ *  \return              1 per un page hit o TLB hit, 0 per un page fault
+ *  \sa mmu_direct_init
+ */
+int mmu_direct_access(int procnum, uint64_t address, int rw)
+{
+    proc_t *proc = proc_table[procnum];
+    struct mmu_request req;
+    struct mmu_response resp;
     
-    return result;
+    proc->stats.mem_accesses++;
+    if (trace_recorder)
+        TRACE_WRITE_RECORD(trace_recorder, mmu_issued, procnum, address, rw);
+    mmu_issued++;
+    if (TLB_ENABLED(&proc->tlb)) {
+        if (tlb_translate(proc, address, rw, &resp.translated_address))
+            return 1;
+        proc->stats.tlb_misses++;
+    }
+    req.virtual_address = address;
+    req.rw = rw;
+    translate(&shards[0], procnum, &req, &resp);
+    return resp.hit;
 }
 
 /*! @} */
@@ -18,6 +18,7 @@
 #include "queue.h"
 #include "proc.h"
 #include "io_device.h"
+#include "policy.h"
 
 /*! \defgroup MMU Memory Management Unit
  *  \def IS_PAGE_PRESENT(p)
@@ -40,38 +41,54 @@
  *  \brief Imposta ad uno il bit reference della pagina.
  *  \def PAGE_SET_PRESENT(p)
  *  \brief Imposta ad uno il bit present della pagina.
- *  \def PAGE_SET_NUM(p, num)
- *  \brief Imposta l'identificatore della pagina.
  *  \def PAGE_SET_FRAMEID(p, fid)
  *  \brief Imposta il frame-id per la pagina "p".
- *  \def PAGE_NUM(p)
- *  \brief Restituisce l'identificatore della pagina.
  *  \def FRAME_ID(p)
  *  \brief Restituisce il frame-id della pgina.
- *  \def ASSIGN_FRAME_TO_PROC(f,p,n)
- *  \brief Assegna il frame "f" alla pagina "n" del processo "p".
+ *  \def ASSIGN_FRAME_TO_PROC(f,p,n,e)
+ *  \brief Assegna il frame "f" alla pagina "n" del processo "p", la cui voce
+ *  nella tabella delle pagine e' "e".
+ *  \def FRAME_PAGE(f)
+ *  \brief Restituisce la voce della tabella delle pagine associata al frame.
  *  \def NUM_OF_REQUESTS()
- *  \brief Restituisce il numero di richieste effettuate all'MMU.
+ *  \brief Restituisce il numero di richieste effettuate all'MMU (valido al
+ *  termine del thread MMU).
+ *  \def MMU_MAX_THREADS
+ *  \brief Numero massimo di thread (shard) della MMU.
+ *  \def MMU_ACCESS_TIME_NS
+ *  \brief Durata di un accesso alla memoria, in ns, per il calcolo del tempo
+ *  effettivo d'accesso (--fault-io).
  */
-#define IS_PAGE_PRESENT(p)              ((p).present)
-#define IS_PAGE_REFERENCED(p)           ((p).reference)
-#define IS_PAGE_DIRTY(p)                ((p).dirty)
-#define PAGE_CLEAR_DIRTY(p)             ((p).dirty = 0)
-#define PAGE_CLEAR_REFERENCED(p)        ((p).reference = 0)
-#define PAGE_CLEAR_PRESENT(p)           ((p).present = 0)
-#define PAGE_CLEAR_FRAMEID(p)           ((p).frame_id = (uint16_t) -1)
-#define PAGE_SET_DIRTY(p)               ((p).dirty = 1)
-#define PAGE_SET_REFERENCED(p)          ((p).reference = 1)
-#define PAGE_SET_PRESENT(p)             ((p).present = 1)
-#define PAGE_SET_NUM(p, num)            ((p).id = num)
+#ifdef PT_BITMAP
+#define PAGE_TEST(p, bit)               ((__atomic_load_n(PT_BIT_WORD(&(p), bit), __ATOMIC_RELAXED) & PT_BIT_MASK(&(p))) != 0)
+#define PAGE_SET(p, bit)                __atomic_fetch_or(PT_BIT_WORD(&(p), bit), PT_BIT_MASK(&(p)), __ATOMIC_SEQ_CST)
+#define PAGE_CLEAR(p, bit)              __atomic_fetch_and(PT_BIT_WORD(&(p), bit), ~PT_BIT_MASK(&(p)), __ATOMIC_SEQ_CST)
+#else
+#define PAGE_TEST(p, bit)               ((__atomic_load_n(&(p).flags, __ATOMIC_RELAXED) & (bit)) != 0)
+#define PAGE_SET(p, bit)                __atomic_fetch_or(&(p).flags, (bit), __ATOMIC_SEQ_CST)
+#define PAGE_CLEAR(p, bit)              __atomic_fetch_and(&(p).flags, ~(bit), __ATOMIC_SEQ_CST)
+#endif /* PT_BITMAP */
+#define IS_PAGE_PRESENT(p)              PAGE_TEST(p, PAGE_PRESENT)
+#define IS_PAGE_REFERENCED(p)           PAGE_TEST(p, PAGE_REFERENCED)
+#define IS_PAGE_DIRTY(p)                PAGE_TEST(p, PAGE_DIRTY)
+#define PAGE_CLEAR_DIRTY(p)             PAGE_CLEAR(p, PAGE_DIRTY)
+#define PAGE_CLEAR_REFERENCED(p)        PAGE_CLEAR(p, PAGE_REFERENCED)
+#define PAGE_CLEAR_PRESENT(p)           PAGE_CLEAR(p, PAGE_PRESENT)
+#define PAGE_CLEAR_FRAMEID(p)           ((p).frame_id = (uint32_t) -1)
+#define PAGE_SET_DIRTY(p)               PAGE_SET(p, PAGE_DIRTY)
+#define PAGE_SET_REFERENCED(p)          PAGE_SET(p, PAGE_REFERENCED)
+#define PAGE_SET_PRESENT(p)             PAGE_SET(p, PAGE_PRESENT)
 #define PAGE_SET_FRAMEID(p, fid)        ((p).frame_id = fid)
-#define PAGE_NUM(p)                     ((p).id)
 #define FRAME_ID(p)                     ((p).frame_id)
-#define ASSIGN_FRAME_TO_PROC(f,p,n)     do {\
-f->debug_info.pid = p->pid; \
-f->debug_info.page_id = n; \
+#define ASSIGN_FRAME_TO_PROC(f,p,n,e)   do {\
+f->owner.pid = p->pid; \
+f->owner.page_id = n; \
+f->owner.pte = e; \
 } while (0)
+#define FRAME_PAGE(f)                   (*(f)->owner.pte)
 #define NUM_OF_REQUESTS()               (mmu.page_hits+mmu.page_faults)
+#define MMU_MAX_THREADS                 64
+#define MMU_ACCESS_TIME_NS              100
 
 
 /*! \struct mmu_data
@@ -88,18 +105,34 @@ struct mmu_data {
     /*! Numero intero per estrarre l'offset da un indirizzo virtuale (AND) */
     uint32_t offset_mask;   
     /*! Numero totale di accessi alla memoria prima che il programma termini */
-    uint32_t total_access;
+    uint64_t total_access;
     /*! Numero totale di page fault avvenuti */
-    uint32_t page_faults;
+    uint64_t page_faults;
     /*! Numero totale di page hit avvenuti */
-    uint32_t page_hits;
+    uint64_t page_hits;
     /*! Dimensione della singola pagina/frame */
     uint32_t page_size;
     /*! Quantita' complessiva di memoria principale */
-    uint32_t ram_size;
+    uint64_t ram_size;
     /*! Numero massimo di pagine disponibili */
-    uint16_t max_page_count;
-} mmu;
+    uint32_t max_page_count;
+    /*! Numero di pagine rimosse dalla memoria dalla politica di rimpiazzo */
+    uint64_t evictions;
+    /*! Numero di pagine "sporche" copiate su disco */
+    uint64_t write_backs;
+    /*! Numero di frame esaminati dalla politica nella scelta delle vittime */
+    uint64_t scanned;
+    /*! Numero di visite della tabella delle pagine */
+    uint64_t pt_walks;
+    /*! Numero complessivo di livelli visitati */
+    uint64_t pt_walk_levels;
+    /*! Numero di shard (thread) della MMU */
+    uint32_t shards;
+    /*! Numero di frame liberi sottratti da uno shard ad un altro */
+    uint64_t steals;
+};
+
+extern struct mmu_data mmu;
 
 
 /*! \struct frame
@@ -113,49 +146,62 @@ struct mmu_data {
  */
 struct frame {
     /*! Identificativo univovo del frame */
-    uint16_t id;
+    uint32_t id;
     /*! Indirizzo fisico di memoria di partenza del frame, cui sommare l'offset */
-    uint32_t physical_addr;
+    uint64_t physical_addr;
     /*! Bit di stato: vale uno (1) se il frame e' utilizzato */
     unsigned int valid:1;
-    /*! Informazioni di debug aggiuntive, non necessarie al funzionamento */
+    /*! Pagina associata al frame, usata dalle politiche di rimpiazzo per
+     *  accedere ai bit Reference e Dirty */
     struct {
         /*! PID del processo che "possiede" il frame */
         uint16_t pid;
         /*! Identificativo della pagina associata al frame */
-        uint16_t page_id;
-    } debug_info;
-    /*! Puntatore al successivo elemenento della lista */
-    STAILQ_ENTRY(frame) entries;
+        uint64_t page_id;
+        /*! Voce della pagina nella tabella del processo */
+        page_t *pte;
+    } owner;
+    /*! Puntatori agli elementi adiacenti nella lista dei frame liberi o
+     *  utilizzati */
+    TAILQ_ENTRY(frame) entries;
 };
 
 
-/*! \struct active_page
- *  \brief Struttura per rappresentare una pagina associata ad un frame.
- */
-struct active_page {
-    /*! Identificativo del processo all'interno della proc table */
-    uint16_t procnum;
-    /*! Identificativo della pagina associata ad un frame */
-    uint16_t page_id;
-    /*! Puntatore al successivo elemento della lista */
-    TAILQ_ENTRY(active_page) entries;
-};
-
-/*! \typedef struct active_page active_page_t
- *  \brief Definizione del tipo di dato active_page_t da struct active_page
- */
-typedef struct active_page active_page_t;
-
 /*! \typedef struct frame frame_t
  *  \brief Definizione del tipo di dato frame_t da struct frame
  */
 typedef struct frame frame_t;
 
+/*! \struct mmu_access
+ *  \brief Singolo accesso di un vettore passato a memory_access_batch
+ */
+struct mmu_access {
+    /*! indirizzo virtuale (ingresso) */
+    uint64_t virtual_address;
+    /*! indirizzo fisico (uscita) */
+    uint64_t physical_address;
+    /*! vale zero se e' lettura, uno se scrittura (ingresso) */
+    int rw;
+    /*! vale uno (1) se la pagina era presente, zero (0) per un page fault
+     (uscita) */
+    int hit;
+};
+
 /*
  *  Prototipi di funzioni pubbliche
  */
-pthread_t *mmu_init(int, int, int);
-uint32_t memory_access(int, uint32_t, int);
+pthread_t *mmu_init(uint64_t, uint64_t, int);
+void mmu_direct_init(uint64_t, uint64_t, int);
+void mmu_direct_finish();
+void mmu_destroy();
+uint64_t memory_access(int, uint64_t, int);
+int memory_access_batch(int, struct mmu_access *, int);
+int mmu_direct_access(int, uint64_t, int);
+int mmu_try_victim(frame_t *);
+void mmu_write_back(frame_t *);
+
+extern proc_t **proc_table;
+extern const char *replacement_policy;
+extern unsigned mmu_threads;
 
 #endif              /* _MMU_H_ */
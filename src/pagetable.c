@@ -0,0 +1,395 @@
+/*! \file pagetable.c
+ */
+
+#include "pagetable.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*! \def PT_NODE_BITS
+ *  \brief Numero di bit per livello usato per scegliere il numero di livelli
+ *  predefinito
+ *  \details Con pagine da 4Kb, indirizzi a 48 bit producono quattro livelli
+ *  da 9 bit ciascuno.
+ */
+#define PT_NODE_BITS            10
+
+/*! \def PT_IS_LEAF(pt, level)
+ *  \brief Vale uno (1) se i nodi del livello sono foglie
+ */
+#define PT_IS_LEAF(pt, level)   ((level) == (pt)->levels - 1)
+
+/*! \def PT_LEAF_ENTRIES(leaf)
+ *  \brief Restituisce il vettore delle voci di una foglia
+ */
+#ifdef PT_BITMAP
+#define PT_LEAF_ENTRIES(leaf)   ((page_t *) ((char *) (leaf) + pt_layout.ids_offset))
+#else
+#define PT_LEAF_ENTRIES(leaf)   ((page_t *) (leaf))
+#endif /* PT_BITMAP */
+
+/*! \def PT_FLAG_MASK
+ *  \brief Bit di stato di una voce
+ */
+#define PT_FLAG_MASK            (PAGE_PRESENT | PAGE_REFERENCED | PAGE_DIRTY)
+
+#ifdef PT_BITMAP
+/*! \var struct pt_layout pt_layout
+ *  \brief Disposizione delle foglie, comune a tutte le tabelle
+ */
+struct pt_layout pt_layout;
+
+/*! \def PT_BITMAP_WORD(leaf, bit, w)
+ *  \brief Restituisce la parola "w" della bitmap "bit" di una foglia
+ */
+#define PT_BITMAP_WORD(leaf, bit, w) \
+    ((leaf)[__builtin_ctz(bit) * pt_layout.words + (w)])
+
+
+/*! \fn void leaf_layout(unsigned bits)
+ *  \brief Calcola la disposizione di una foglia con 2^bits voci
+ *  \return              Dimensione della foglia, in byte
+ */
+static size_t
+leaf_layout(unsigned bits)
+{
+    uint64_t n = 1ULL << bits;
+    size_t size = 1;
+
+    pt_layout.words = (n + 63) / 64;
+    pt_layout.ids_offset = 3 * pt_layout.words * sizeof(uint64_t);
+    while (size < pt_layout.ids_offset + n * sizeof(page_t))
+        size <<= 1;
+    pt_layout.mask = ~((uintptr_t) size - 1);
+    return size;
+}
+#endif /* PT_BITMAP */
+
+
+/*! \fn void *node_alloc(struct page_table *pt, unsigned level)
+ *  \brief Alloca ed inizializza un nodo del livello indicato
+ *  \details Le voci di una foglia vengono create non presenti e prive di
+ *  frame; quelle di un nodo intermedio non puntano ad alcun nodo.
+ */
+static void *
+node_alloc(struct page_table *pt, unsigned level)
+{
+    uint64_t i, n = 1ULL << pt->bits[level];
+    size_t size;
+    void *node;
+
+    if (PT_IS_LEAF(pt, level)) {
+        page_t *leaf;
+
+#ifdef PT_BITMAP
+        size = ~pt_layout.mask + 1;
+        if (posix_memalign(&node, size, size)) {
+            printf("Memory exhausted");
+            exit(EXIT_FAILURE);
+        }
+        memset(node, 0, pt_layout.ids_offset);
+        leaf = (page_t *) ((char *) node + pt_layout.ids_offset);
+#else
+        size = n * sizeof(page_t);
+        node = leaf = XMALLOC(page_t, n);
+#endif /* PT_BITMAP */
+        for (i = 0; i < n; i++) {
+            leaf[i].frame_id = (uint32_t) -1;
+#ifndef PT_BITMAP
+            leaf[i].flags = 0;
+#endif /* PT_BITMAP */
+        }
+    } else {
+        size = n * sizeof(void *);
+        node = xmalloc(size);
+        memset(node, 0, size);
+    }
+    __atomic_add_fetch(&pt->nodes, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&pt->bytes, size, __ATOMIC_RELAXED);
+    return node;
+}
+
+
+/*! \fn void node_free(struct page_table *pt, void *node, unsigned level)
+ *  \brief Dealloca ricorsivamente un nodo ed i suoi discendenti
+ */
+static void
+node_free(struct page_table *pt, void *node, unsigned level)
+{
+    uint64_t i, n = 1ULL << pt->bits[level];
+
+    if (!PT_IS_LEAF(pt, level))
+        for (i = 0; i < n; i++)
+            if (((void **) node)[i])
+                node_free(pt, ((void **) node)[i], level + 1);
+    __atomic_sub_fetch(&pt->nodes, 1, __ATOMIC_RELAXED);
+#ifdef PT_BITMAP
+    __atomic_sub_fetch(&pt->bytes, PT_IS_LEAF(pt, level) ? ~pt_layout.mask + 1 :
+                       n * sizeof(void *), __ATOMIC_RELAXED);
+#else
+    __atomic_sub_fetch(&pt->bytes, n * (PT_IS_LEAF(pt, level) ?
+                       sizeof(page_t) : sizeof(void *)), __ATOMIC_RELAXED);
+#endif /* PT_BITMAP */
+    XFREE(node);
+}
+
+
+/*! \fn void node_visit(struct page_table *pt, void *node, unsigned level, uint64_t base, pt_visit_fn fn, void *arg)
+ *  \brief Visita ricorsivamente le foglie allocate sotto un nodo
+ */
+static void
+node_visit(struct page_table *pt, void *node, unsigned level, uint64_t base,
+           pt_visit_fn fn, void *arg)
+{
+    uint64_t i, n = 1ULL << pt->bits[level];
+
+    for (i = 0; i < n; i++) {
+        if (PT_IS_LEAF(pt, level))
+            fn(base | i, &PT_LEAF_ENTRIES(node)[i], arg);
+        else if (((void **) node)[i])
+            node_visit(pt, ((void **) node)[i], level + 1,
+                       base | (i << pt->shift[level]), fn, arg);
+    }
+}
+
+
+/*! \fn void leaf_walk(struct page_table *pt, void *node, unsigned level, void (*fn)(struct page_table *, void *, void *), void *arg)
+ *  \brief Invoca "fn" su ogni foglia allocata sotto un nodo
+ */
+static void
+leaf_walk(struct page_table *pt, void *node, unsigned level,
+          void (*fn)(struct page_table *, void *, void *), void *arg)
+{
+    uint64_t i, n = 1ULL << pt->bits[level];
+
+    if (PT_IS_LEAF(pt, level)) {
+        fn(pt, node, arg);
+        return;
+    }
+    for (i = 0; i < n; i++)
+        if (((void **) node)[i])
+            leaf_walk(pt, ((void **) node)[i], level + 1, fn, arg);
+}
+
+
+/*! \struct leaf_count
+ *  \brief Parametri e risultato del conteggio delle voci di una tabella
+ */
+struct leaf_count {
+    /*! bit di stato che devono valere uno */
+    unsigned set;
+    /*! bit di stato che devono valere zero */
+    unsigned clear;
+    /*! numero di voci che soddisfano la condizione */
+    uint64_t count;
+};
+
+
+/*! \fn void leaf_count(struct page_table *pt, void *leaf, void *arg)
+ *  \brief Conta le voci di una foglia secondo i criteri di "arg"
+ *  \details Nel formato a bitmap la condizione viene valutata su 64 voci
+ *  alla volta: le parole delle tre bitmap vengono combinate e contate con
+ *  un'unica istruzione di popcount.
+ */
+static void
+leaf_count(struct page_table *pt, void *leaf, void *arg)
+{
+    struct leaf_count *lc = arg;
+#ifdef PT_BITMAP
+    uint64_t *words = leaf;
+    uint64_t w, m;
+    unsigned bit;
+
+    for (w = 0; w < pt_layout.words; w++) {
+        m = ~0ULL;
+        for (bit = PAGE_PRESENT; bit & PT_FLAG_MASK; bit <<= 1) {
+            if (lc->set & bit)
+                m &= PT_BITMAP_WORD(words, bit, w);
+            else if (lc->clear & bit)
+                m &= ~PT_BITMAP_WORD(words, bit, w);
+        }
+        if (pt->bits[pt->levels - 1] < 6)
+            m &= (1ULL << (1U << pt->bits[pt->levels - 1])) - 1;
+        lc->count += __builtin_popcountll(m);
+    }
+#else
+    page_t *e = leaf;
+    uint64_t i, n = 1ULL << pt->bits[pt->levels - 1];
+    unsigned flags;
+
+    for (i = 0; i < n; i++) {
+        flags = __atomic_load_n(&e[i].flags, __ATOMIC_RELAXED);
+        if ((flags & lc->set) == lc->set && !(flags & lc->clear))
+            lc->count++;
+    }
+#endif /* PT_BITMAP */
+}
+
+
+/*! \fn void leaf_clear_referenced(struct page_table *pt, void *leaf, void *arg)
+ *  \brief Azzera il bit Reference di tutte le voci di una foglia
+ */
+static void
+leaf_clear_referenced(struct page_table *pt, void *leaf, void *arg)
+{
+#ifdef PT_BITMAP
+    uint64_t *words = leaf;
+    uint32_t w;
+
+    for (w = 0; w < pt_layout.words; w++)
+        __atomic_store_n(&PT_BITMAP_WORD(words, PAGE_REFERENCED, w), 0,
+                         __ATOMIC_RELAXED);
+#else
+    page_t *e = leaf;
+    uint64_t i, n = 1ULL << pt->bits[pt->levels - 1];
+
+    for (i = 0; i < n; i++)
+        __atomic_fetch_and(&e[i].flags, ~PAGE_REFERENCED, __ATOMIC_RELAXED);
+#endif /* PT_BITMAP */
+}
+
+
+/*! \addtogroup PT
+ * @{
+ *  \fn unsigned pt_default_levels(unsigned page_bits)
+ *  \brief Numero di livelli predefinito per "page_bits" bit di pagina
+ *  \details Restituisce il minimo numero di livelli tale che nessun nodo
+ *  superi 2^PT_NODE_BITS voci, fino ad un massimo di PT_MAX_LEVELS.
+ */
+unsigned pt_default_levels(unsigned page_bits)
+{
+    unsigned levels = 1;
+
+    while (levels < PT_MAX_LEVELS && page_bits > levels * PT_NODE_BITS)
+        levels++;
+    return levels;
+}
+
+
+/*! \fn int pt_init(struct page_table *pt, unsigned page_bits, unsigned levels)
+ *  \brief Inizializza la tabella delle pagine di un processo
+ *  \details I bit del numero di pagina vengono ripartiti tra i livelli; gli
+ *  eventuali bit in eccesso vengono assegnati ai livelli piu' vicini alla
+ *  radice. Viene allocata la sola radice.
+ *  \param pt            Tabella da inizializzare
+ *  \param page_bits     Numero di bit del numero di pagina virtuale
+ *  \param levels        Numero di livelli (da 1 a PT_MAX_LEVELS)
+ *  \return              0 in caso di successo, -1 se il numero di livelli non
+ *                       e' compatibile con page_bits
+ */
+int pt_init(struct page_table *pt, unsigned page_bits, unsigned levels)
+{
+    unsigned l, shift;
+
+    if (levels < 1 || levels > PT_MAX_LEVELS ||
+        (levels > 1 && levels > page_bits))
+        return -1;
+    memset(pt, 0, sizeof(*pt));
+    pt->levels = levels;
+    for (l = 0; l < levels; l++) {
+        pt->bits[l] = page_bits / levels + (l < page_bits % levels);
+        if (pt->bits[l] > PT_MAX_NODE_BITS)
+            return -1;
+    }
+    for (shift = 0, l = levels; l-- > 0; shift += pt->bits[l])
+        pt->shift[l] = shift;
+#ifdef PT_BITMAP
+    leaf_layout(pt->bits[levels - 1]);
+#endif /* PT_BITMAP */
+    pt->root = node_alloc(pt, 0);
+    return 0;
+}
+
+
+/*! \fn void pt_destroy(struct page_table *pt)
+ *  \brief Dealloca tutti i nodi della tabella
+ */
+void pt_destroy(struct page_table *pt)
+{
+    if (pt->root)
+        node_free(pt, pt->root, 0);
+    pt->root = NULL;
+}
+
+
+/*! \fn page_t *pt_walk(struct page_table *pt, uint64_t page, int alloc, unsigned *depth)
+ *  \brief Percorre la tabella fino alla voce della pagina
+ *  \details Come il page walker hardware, la visita si arresta al primo nodo
+ *  mancante; se "alloc" vale uno, i nodi mancanti vengono invece allocati.
+ *  Un nodo allocato in concorrenza da un altro thread viene scartato a
+ *  favore di quello gia' inserito.
+ *  \param pt            Tabella delle pagine
+ *  \param page          Numero di pagina virtuale
+ *  \param alloc         Se vale uno (1) alloca i nodi mancanti
+ *  \param depth         Se diverso da NULL, numero di livelli visitati
+ *  \return              La voce della pagina, NULL se un nodo e' mancante
+ */
+page_t *pt_walk(struct page_table *pt, uint64_t page, int alloc,
+                unsigned *depth)
+{
+    void *node = pt->root, *child, *expected, **slot;
+    unsigned l;
+
+    for (l = 0; !PT_IS_LEAF(pt, l); l++) {
+        expected = NULL;
+        slot = &((void **) node)[PT_INDEX(pt, page, l)];
+        child = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+        if (!child) {
+            if (!alloc) {
+                if (depth)
+                    *depth = l + 1;
+                return NULL;
+            }
+            child = node_alloc(pt, l + 1);
+            if (!__atomic_compare_exchange_n(slot, &expected, child, 0,
+                                             __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {
+                node_free(pt, child, l + 1);
+                child = expected;
+            }
+        }
+        node = child;
+    }
+    if (depth)
+        *depth = pt->levels;
+    return &PT_LEAF_ENTRIES(node)[PT_INDEX(pt, page, l)];
+}
+
+
+/*! \fn void pt_foreach(struct page_table *pt, pt_visit_fn fn, void *arg)
+ *  \brief Invoca "fn" per ogni voce delle foglie allocate, in ordine di
+ *  pagina
+ */
+void pt_foreach(struct page_table *pt, pt_visit_fn fn, void *arg)
+{
+    if (pt->root)
+        node_visit(pt, pt->root, 0, 0, fn, arg);
+}
+
+
+/*! \fn uint64_t pt_count(struct page_table *pt, unsigned set, unsigned clear)
+ *  \brief Conta le voci con tutti i bit "set" ad uno e tutti i bit "clear"
+ *  a zero
+ *  \details Ad esempio pt_count(pt, PAGE_PRESENT, PAGE_REFERENCED |
+ *  PAGE_DIRTY) restituisce il numero di pagine residenti, non referenziate e
+ *  pulite, ovvero quelle rimovibili senza costi.
+ */
+uint64_t pt_count(struct page_table *pt, unsigned set, unsigned clear)
+{
+    struct leaf_count lc = { set, clear, 0 };
+
+    if (pt->root)
+        leaf_walk(pt, pt->root, 0, leaf_count, &lc);
+    return lc.count;
+}
+
+
+/*! \fn void pt_clear_referenced(struct page_table *pt)
+ *  \brief Azzera il bit Reference di tutte le pagine della tabella
+ *  \details Nel formato a bitmap vengono azzerate 64 pagine per parola.
+ */
+void pt_clear_referenced(struct page_table *pt)
+{
+    if (pt->root)
+        leaf_walk(pt, pt->root, 0, leaf_clear_referenced, NULL);
+}
+
+/*! @} */
@@ -0,0 +1,113 @@
+/*! \file pagetable.h
+ *  \defgroup PT Tabella delle pagine a piu' livelli
+ */
+
+#ifndef __PAGETABLE_H__
+#define __PAGETABLE_H__
+
+#include "vm_types.h"
+
+/*! \def PT_MAX_LEVELS
+ *  \brief Numero massimo di livelli della tabella delle pagine
+ */
+#define PT_MAX_LEVELS           4
+
+/*! \def PT_MAX_NODE_BITS
+ *  \brief Numero massimo di bit dell'indice di un singolo nodo
+ *  \details Un nodo foglia con 2^16 voci occupa 1Mb: oltre questa soglia e'
+ *  necessario aggiungere un livello.
+ */
+#define PT_MAX_NODE_BITS        16
+
+/*! \def PT_INDEX(pt, page, level)
+ *  \brief Restituisce l'indice della pagina all'interno di un nodo del livello
+ */
+#define PT_INDEX(pt, page, level) \
+    (((page) >> (pt)->shift[level]) & ((1ULL << (pt)->bits[level]) - 1))
+
+#ifdef PT_BITMAP
+/*! \struct pt_layout
+ *  \brief Disposizione delle foglie nel formato a bitmap
+ *  \details Ogni foglia e' un blocco allineato alla propria dimensione, una
+ *  potenza di due: contiene le bitmap PAGE_PRESENT, PAGE_REFERENCED e
+ *  PAGE_DIRTY (in quest'ordine, "words" parole ciascuna) seguite dal vettore
+ *  dei frame-id. La voce di una pagina e' l'elemento del vettore: la foglia
+ *  si ricava azzerando i bit meno significativi del suo indirizzo, cosi' che
+ *  il resto del simulatore continui ad identificare una pagina con un
+ *  puntatore page_t.\n
+ *  Tutte le tabelle condividono la stessa disposizione, impostata da
+ *  pt_init.
+ */
+struct pt_layout {
+    /*! maschera che ricava l'inizio della foglia dall'indirizzo di una voce */
+    uintptr_t mask;
+    /*! numero di parole a 64 bit di ogni bitmap */
+    uint32_t words;
+    /*! posizione del vettore dei frame-id all'interno della foglia */
+    size_t ids_offset;
+};
+
+extern struct pt_layout pt_layout;
+
+/*! \def PT_LEAF_BASE(pte)
+ *  \brief Restituisce la prima parola della foglia che contiene la voce
+ *  \def PT_LEAF_INDEX(pte)
+ *  \brief Restituisce la posizione della voce all'interno della foglia
+ *  \def PT_BIT_WORD(pte, bit)
+ *  \brief Restituisce la parola della bitmap "bit" che contiene la voce
+ *  \def PT_BIT_MASK(pte)
+ *  \brief Restituisce la maschera della voce all'interno della parola
+ */
+#define PT_LEAF_BASE(pte)   ((uint64_t *) ((uintptr_t) (pte) & pt_layout.mask))
+#define PT_LEAF_INDEX(pte)  ((uint32_t) ((page_t *) (pte) - \
+    (page_t *) ((char *) PT_LEAF_BASE(pte) + pt_layout.ids_offset)))
+#define PT_BIT_WORD(pte, bit) \
+    (PT_LEAF_BASE(pte) + __builtin_ctz(bit) * pt_layout.words + \
+     (PT_LEAF_INDEX(pte) >> 6))
+#define PT_BIT_MASK(pte)    (1ULL << (PT_LEAF_INDEX(pte) & 63))
+#endif /* PT_BITMAP */
+
+/*! \struct page_table
+ *  \brief Tabella delle pagine radix di un processo
+ *  \details Il numero di pagina virtuale viene suddiviso in "levels" indici,
+ *  a partire dai bit piu' significativi: i nodi intermedi contengono puntatori
+ *  ai nodi del livello successivo, le foglie le voci page_t. Soltanto la
+ *  radice viene allocata alla creazione: gli altri nodi vengono allocati al
+ *  primo accesso ad una pagina del loro intervallo, cosi' che la memoria
+ *  occupata sia proporzionale alle pagine effettivamente usate.\n
+ *  I nodi vengono inseriti con un'operazione atomica e non vengono mai
+ *  rimossi prima di pt_destroy: un processo puo' percorrere la tabella
+ *  mentre la MMU la estende.
+ */
+struct page_table {
+    /*! nodo radice */
+    void *root;
+    /*! numero di livelli */
+    unsigned levels;
+    /*! numero di bit dell'indice di ogni livello (0 = radice) */
+    unsigned bits[PT_MAX_LEVELS];
+    /*! posizione dell'indice di ogni livello nel numero di pagina */
+    unsigned shift[PT_MAX_LEVELS];
+    /*! numero di nodi allocati */
+    uint32_t nodes;
+    /*! memoria occupata dai nodi, in byte */
+    uint64_t bytes;
+};
+
+/*! \typedef void (*pt_visit_fn)(uint64_t, page_t *, void *)
+ *  \brief Funzione invocata da pt_foreach per ogni voce delle foglie allocate
+ */
+typedef void (*pt_visit_fn)(uint64_t, page_t *, void *);
+
+/*
+ *  Prototipi di funzioni pubbliche
+ */
+unsigned pt_default_levels(unsigned);
+int pt_init(struct page_table *, unsigned, unsigned);
+void pt_destroy(struct page_table *);
+page_t *pt_walk(struct page_table *, uint64_t, int, unsigned *);
+void pt_foreach(struct page_table *, pt_visit_fn, void *);
+uint64_t pt_count(struct page_table *, unsigned, unsigned);
+void pt_clear_referenced(struct page_table *);
+
+#endif              /* __PAGETABLE_H__ */
@@ -0,0 +1,174 @@
+/*! \file policy.c
+ */
+
+#include "policy.h"
+#include "mmu.h"
+#include <string.h>
+
+/*! \var const struct policy_ops *policies[]
+ *  \brief Elenco delle politiche di rimpiazzo disponibili
+ *  \details Il primo elemento e' la politica predefinita.
+ */
+static const struct policy_ops *policies[] = {
+    &policy_sc,
+    &policy_esc,
+    &policy_fifo,
+    &policy_lru,
+    &policy_clock,
+    &policy_lfu,
+    &policy_arc,
+    &policy_wsclock,
+    NULL
+};
+
+
+/*! \addtogroup POLICY
+ * @{
+ *  \fn const struct policy_ops *policy_find(const char *spec)
+ *  \brief Ricerca una politica per nome
+ *  \param spec          Nome della politica, eventualmente seguito da ':' e
+ *                       da un parametro (per esempio "wsclock:500")
+ *  \return              Operazioni della politica, NULL se sconosciuta
+ */
+const struct policy_ops *policy_find(const char *spec)
+{
+    size_t len = strcspn(spec, ":");
+    int i;
+
+    for (i = 0; policies[i]; i++)
+        if (strlen(policies[i]->name) == len &&
+            !strncmp(policies[i]->name, spec, len))
+            return policies[i];
+    return NULL;
+}
+
+
+/*! \fn struct policy *policy_create(const char *spec, frame_t *frames, unsigned nframes, unsigned capacity)
+ *  \brief Crea un'istanza della politica richiesta
+ *  \param spec          Nome della politica (NULL per quella predefinita)
+ *  \param frames        Tabella dei frame gestiti dalla politica
+ *  \param nframes       Numero di frame nella tabella
+ *  \param capacity      Numero di frame assegnati alla politica
+ *  \return              Istanza della politica, NULL se sconosciuta
+ */
+struct policy *policy_create(const char *spec, frame_t *frames, unsigned nframes,
+                             unsigned capacity)
+{
+    const struct policy_ops *ops = spec ? policy_find(spec) : policies[0];
+    const char *param = spec ? strchr(spec, ':') : NULL;
+    struct policy *p;
+
+    if (!ops)
+        return NULL;
+    p = XMALLOC(struct policy, 1);
+    p->ops = ops;
+    p->state = NULL;
+    p->frames = frames;
+    p->nframes = nframes;
+    p->capacity = capacity;
+    p->scanned = 0;
+    ops->create(p, param ? param + 1 : NULL);
+    return p;
+}
+
+
+/*! \fn void policy_destroy(struct policy *p)
+ *  \brief Dealloca un'istanza di una politica
+ */
+void policy_destroy(struct policy *p)
+{
+    if (!p)
+        return;
+    p->ops->destroy(p);
+    XFREE(p);
+}
+
+
+/*! \fn void policy_usage(FILE *out)
+ *  \brief Stampa l'elenco delle politiche disponibili
+ */
+void policy_usage(FILE *out)
+{
+    int i;
+
+    for (i = 0; policies[i]; i++)
+        fprintf(out, "                              %-8s %s\n",
+                policies[i]->name, policies[i]->description);
+}
+
+
+/*! \fn void clock_init(struct clock_ring *r, unsigned nframes)
+ *  \brief Inizializza un anello vuoto per "nframes" frame
+ */
+void clock_init(struct clock_ring *r, unsigned nframes)
+{
+    TAILQ_INIT(&r->list);
+    r->nodes = XMALLOC(struct clock_node, nframes);
+    memset(r->nodes, 0, nframes * sizeof(struct clock_node));
+    r->hand = NULL;
+    r->count = 0;
+}
+
+
+/*! \fn void clock_destroy(struct clock_ring *r)
+ *  \brief Dealloca i nodi dell'anello
+ */
+void clock_destroy(struct clock_ring *r)
+{
+    XFREE(r->nodes);
+}
+
+
+/*! \fn void clock_insert(struct clock_ring *r, unsigned id)
+ *  \brief Inserisce un frame nell'anello
+ *  \details Il nodo viene posto immediatamente prima della lancetta, cosi'
+ *  da essere esaminato per ultimo dal prossimo giro.
+ */
+void clock_insert(struct clock_ring *r, unsigned id)
+{
+    struct clock_node *n = &r->nodes[id];
+
+    if (r->hand)
+        TAILQ_INSERT_BEFORE(r->hand, n, entries);
+    else {
+        TAILQ_INSERT_TAIL(&r->list, n, entries);
+        r->hand = n;
+    }
+    r->count++;
+}
+
+
+/*! \fn void clock_remove(struct clock_ring *r, unsigned id)
+ *  \brief Rimuove un frame dall'anello
+ *  \details Se la lancetta punta al nodo rimosso, avanza al successivo.
+ */
+void clock_remove(struct clock_ring *r, unsigned id)
+{
+    struct clock_node *n = &r->nodes[id];
+
+    if (r->hand == n)
+        clock_advance(r);
+    TAILQ_REMOVE(&r->list, n, entries);
+    if (--r->count == 0)
+        r->hand = NULL;
+}
+
+
+/*! \fn struct clock_node *clock_advance(struct clock_ring *r)
+ *  \brief Restituisce il nodo sotto la lancetta e la fa avanzare
+ *  \details La lista e' circolare: dopo l'ultimo nodo la lancetta torna al
+ *  primo.
+ */
+struct clock_node *clock_advance(struct clock_ring *r)
+{
+    struct clock_node *n = r->hand;
+
+    if (n) {
+        r->hand = TAILQ_NEXT(n, entries);
+        if (!r->hand)
+            r->hand = TAILQ_FIRST(&r->list);
+    }
+    return n;
+}
+
+/*! @} */
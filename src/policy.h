@@ -0,0 +1,134 @@
+/*! \file policy.h
+ *  \defgroup POLICY Politiche di rimpiazzo
+ */
+
+#ifndef __POLICY_H__
+#define __POLICY_H__
+
+#include "vm_types.h"
+#include "queue.h"
+
+struct frame;
+struct policy;
+
+/*! \struct policy_ops
+ *  \brief Tabella delle operazioni di una politica di rimpiazzo
+ *  \details La MMU notifica alla politica ogni evento rilevante per un frame:
+ *  \li on_hit: la pagina contenuta nel frame e' stata referenziata
+ *  \li on_fault: il frame e' stato appena associato alla pagina che ha
+ *  generato il fault (procnum, page)
+ *  \li pick_victim: non ci sono frame liberi, la politica deve scegliere il
+ *  frame da liberare per la pagina (procnum, page)
+ *  \li on_evict: la pagina contenuta nel frame e' stata rimossa dalla memoria
+ *
+ *  I bit Reference e Dirty restano nella tabella delle pagine e vengono
+ *  gestiti dalla MMU: le politiche che ne fanno uso vi accedono con la macro
+ *  FRAME_PAGE. Gli accessi risolti dal TLB dei processi non raggiungono la
+ *  MMU: le politiche che non consultano il bit Reference (LRU, LFU, ARC) non
+ *  ne vengono informate.
+ */
+struct policy_ops {
+    /*! nome della politica, usato dal parametro --policy */
+    const char *name;
+    /*! breve descrizione per l'help */
+    const char *description;
+    /*! alloca lo stato della politica */
+    void (*create)(struct policy *, const char *);
+    /*! dealloca lo stato della politica */
+    void (*destroy)(struct policy *);
+    /*! notifica di un page hit */
+    void (*on_hit)(struct policy *, struct frame *);
+    /*! notifica del caricamento di una pagina in un frame */
+    void (*on_fault)(struct policy *, struct frame *, int, uint64_t);
+    /*! scelta del frame da liberare */
+    struct frame *(*pick_victim)(struct policy *, int, uint64_t);
+    /*! notifica della rimozione di una pagina da un frame */
+    void (*on_evict)(struct policy *, struct frame *);
+};
+
+/*! \struct policy
+ *  \brief Istanza di una politica di rimpiazzo
+ */
+struct policy {
+    /*! operazioni della politica */
+    const struct policy_ops *ops;
+    /*! stato privato della politica */
+    void *state;
+    /*! tabella dei frame gestiti */
+    struct frame *frames;
+    /*! numero di frame della tabella */
+    unsigned nframes;
+    /*! numero di frame effettivamente assegnati alla politica: coincide con
+     *  nframes, a meno che la tabella non sia condivisa tra piu' istanze */
+    unsigned capacity;
+    /*! numero di frame esaminati nella scelta delle vittime */
+    uint64_t scanned;
+};
+
+/*! \def POLICY_HIT(p, f)
+ *  \brief Notifica un page hit alla politica "p"
+ *  \def POLICY_FAULT(p, f, procnum, page)
+ *  \brief Notifica alla politica "p" il caricamento di una pagina
+ *  \def POLICY_VICTIM(p, procnum, page)
+ *  \brief Chiede alla politica "p" il frame da liberare
+ *  \def POLICY_EVICT(p, f)
+ *  \brief Notifica alla politica "p" la rimozione di una pagina
+ *  \def POLICY_SCAN(p)
+ *  \brief Conta un frame esaminato dalla politica "p" nella scelta della
+ *  vittima
+ */
+#define POLICY_HIT(p, f)                    ((p)->ops->on_hit((p), (f)))
+#define POLICY_FAULT(p, f, procnum, page)   ((p)->ops->on_fault((p), (f), (procnum), (page)))
+#define POLICY_VICTIM(p, procnum, page)     ((p)->ops->pick_victim((p), (procnum), (page)))
+#define POLICY_EVICT(p, f)                  ((p)->ops->on_evict((p), (f)))
+#define POLICY_SCAN(p)                      ((p)->scanned++)
+
+/*! \struct clock_node
+ *  \brief Elemento di un anello "clock", uno per ogni frame
+ *  \details Le politiche basate su lancetta (sc, clock, esc, wsclock) mantengono
+ *  i frame residenti in una lista circolare: i nodi sono allocati in un
+ *  vettore indicizzato dal frame-id.
+ */
+struct clock_node {
+    /*! collegamenti della lista circolare */
+    TAILQ_ENTRY(clock_node) entries;
+    /*! istante dell'ultimo utilizzo noto (wsclock) */
+    uint32_t last_use;
+};
+
+/*! \struct clock_ring
+ *  \brief Anello di frame con lancetta persistente
+ */
+struct clock_ring {
+    /*! lista dei nodi residenti */
+    TAILQ_HEAD(clock_list, clock_node) list;
+    /*! vettore dei nodi, indicizzato dal frame-id */
+    struct clock_node *nodes;
+    /*! posizione corrente della lancetta */
+    struct clock_node *hand;
+    /*! numero di nodi nell'anello */
+    unsigned count;
+};
+
+/*! \def CLOCK_FRAME(p, r, n)
+ *  \brief Restituisce il frame associato al nodo "n" dell'anello "r"
+ */
+#define CLOCK_FRAME(p, r, n)    (&(p)->frames[(n) - (r)->nodes])
+
+/*
+ *  Prototipi di funzioni pubbliche
+ */
+const struct policy_ops *policy_find(const char *);
+struct policy *policy_create(const char *, struct frame *, unsigned, unsigned);
+void policy_destroy(struct policy *);
+void policy_usage(FILE *);
+void clock_init(struct clock_ring *, unsigned);
+void clock_destroy(struct clock_ring *);
+void clock_insert(struct clock_ring *, unsigned);
+void clock_remove(struct clock_ring *, unsigned);
+struct clock_node *clock_advance(struct clock_ring *);
+
+extern const struct policy_ops policy_sc, policy_fifo, policy_lru,
+    policy_clock, policy_lfu, policy_arc, policy_wsclock, policy_esc;
+
+#endif              /* __POLICY_H__ */
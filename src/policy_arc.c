@@ -0,0 +1,307 @@
+/*! \file policy_arc.c
+ *  Politica di rimpiazzo Adaptive Replacement Cache (Megiddo, Modha).
+ */
+
+#include "policy.h"
+#include "mmu.h"
+#include "pool.h"
+#include <string.h>
+
+/*! \def ARC_T1
+ *  \brief Pagine residenti referenziate una sola volta
+ *  \def ARC_T2
+ *  \brief Pagine residenti referenziate almeno due volte
+ *  \def ARC_B1
+ *  \brief Pagine rimosse da T1 (fantasmi)
+ *  \def ARC_B2
+ *  \brief Pagine rimosse da T2 (fantasmi)
+ */
+#define ARC_T1              0
+#define ARC_T2              1
+#define ARC_B1              2
+#define ARC_B2              3
+
+/*! \def GHOST_HASH(st, pid, page)
+ *  \brief Restituisce la catena della tabella hash dei fantasmi
+ */
+#define GHOST_HASH(st, pid, page) \
+    (&(st)->hash[(((uint32_t) (pid) * 2654435761U) ^ (page)) & (st)->hash_mask])
+
+/*! \struct arc_node
+ *  \brief Frame residente, inserito in T1 oppure in T2
+ */
+struct arc_node {
+    /*! collegamenti della lista */
+    TAILQ_ENTRY(arc_node) entries;
+    /*! lista di appartenenza (ARC_T1, ARC_T2) */
+    int list;
+};
+
+/*! \struct arc_ghost
+ *  \brief Pagina non piu' residente, ricordata in B1 oppure in B2
+ */
+struct arc_ghost {
+    /*! collegamenti della lista */
+    TAILQ_ENTRY(arc_ghost) entries;
+    /*! successivo nella catena della tabella hash */
+    struct arc_ghost *next;
+    /*! processo proprietario */
+    int pid;
+    /*! pagina virtuale */
+    uint64_t page;
+    /*! lista di appartenenza (ARC_B1, ARC_B2) */
+    int list;
+};
+
+/*! \struct arc_state
+ *  \brief Stato della politica ARC
+ *  \details Le liste sono ordinate dall'elemento usato meno di recente (in
+ *  testa) a quello usato piu' di recente (in coda).
+ */
+struct arc_state {
+    /*! pagine residenti viste una volta (T1) e piu' volte (T2) */
+    TAILQ_HEAD(arc_nodes, arc_node) t[2];
+    /*! fantasmi rimossi da T1 (B1) e da T2 (B2) */
+    TAILQ_HEAD(arc_ghosts, arc_ghost) b[2];
+    /*! numero di elementi di T1, T2, B1, B2 */
+    unsigned size[4];
+    /*! dimensione obiettivo di T1 */
+    unsigned target;
+    /*! vettore dei nodi, indicizzato dal frame-id */
+    struct arc_node *nodes;
+    /*! tabella hash dei fantasmi */
+    struct arc_ghost **hash;
+    /*! maschera per l'indice della tabella hash */
+    uint32_t hash_mask;
+    /*! fantasma della pagina in caricamento, gia' considerato da adapt */
+    struct arc_ghost *pending;
+    /*! vale uno (1) se pending e' stato determinato per la pagina in
+     *  caricamento */
+    int adapted;
+    /*! pool dei fantasmi: le liste B1 e B2 ne contengono al piu' uno per
+     *  frame ciascuna */
+    struct pool ghosts;
+};
+
+
+/*! \fn struct arc_ghost *ghost_find(struct arc_state *st, int pid, uint64_t page)
+ *  \brief Ricerca una pagina tra i fantasmi
+ */
+static struct arc_ghost *
+ghost_find(struct arc_state *st, int pid, uint64_t page)
+{
+    struct arc_ghost *g;
+
+    for (g = *GHOST_HASH(st, pid, page); g; g = g->next)
+        if (g->pid == pid && g->page == page)
+            return g;
+    return NULL;
+}
+
+
+/*! \fn void ghost_remove(struct arc_state *st, struct arc_ghost *g)
+ *  \brief Elimina un fantasma dalla propria lista e dalla tabella hash
+ */
+static void
+ghost_remove(struct arc_state *st, struct arc_ghost *g)
+{
+    struct arc_ghost **pg = GHOST_HASH(st, g->pid, g->page);
+
+    while (*pg != g)
+        pg = &(*pg)->next;
+    *pg = g->next;
+    TAILQ_REMOVE(&st->b[g->list - ARC_B1], g, entries);
+    st->size[g->list]--;
+    POOL_PUT(&st->ghosts, g);
+}
+
+
+/*! \fn void adapt(struct arc_state *st, int procnum, uint64_t page, unsigned c)
+ *  \brief Adatta la dimensione obiettivo di T1 alla pagina in caricamento
+ *  \details Un fantasma in B1 indica che T1 e' troppo piccola, uno in B2 che
+ *  lo e' T2. L'adattamento avviene una sola volta per fault, prima della
+ *  scelta della vittima oppure, con frame liberi, al caricamento.
+ */
+static void
+adapt(struct arc_state *st, int procnum, uint64_t page, unsigned c)
+{
+    struct arc_ghost *g;
+    unsigned delta;
+
+    if (st->adapted)
+        return;
+    st->adapted = 1;
+    st->pending = g = ghost_find(st, procnum, page);
+    if (!g)
+        return;
+    if (g->list == ARC_B1) {
+        delta = (st->size[ARC_B1] >= st->size[ARC_B2]) ? 1 :
+                st->size[ARC_B2] / st->size[ARC_B1];
+        st->target = (st->target + delta > c) ? c : st->target + delta;
+    } else {
+        delta = (st->size[ARC_B2] >= st->size[ARC_B1]) ? 1 :
+                st->size[ARC_B1] / st->size[ARC_B2];
+        st->target = (st->target > delta) ? st->target - delta : 0;
+    }
+}
+
+
+/*! \addtogroup POLICY
+ * @{
+ *  \fn void arc_create(struct policy *p, const char *param)
+ *  \brief Alloca lo stato della politica ARC
+ */
+static void
+arc_create(struct policy *p, const char *param)
+{
+    struct arc_state *st = XMALLOC(struct arc_state, 1);
+    uint32_t buckets = 1;
+
+    memset(st, 0, sizeof(*st));
+    TAILQ_INIT(&st->t[0]);
+    TAILQ_INIT(&st->t[1]);
+    TAILQ_INIT(&st->b[0]);
+    TAILQ_INIT(&st->b[1]);
+    st->nodes = XMALLOC(struct arc_node, p->nframes);
+    while (buckets < 2 * p->capacity)
+        buckets <<= 1;
+    st->hash = XMALLOC(struct arc_ghost *, buckets);
+    memset(st->hash, 0, buckets * sizeof(struct arc_ghost *));
+    st->hash_mask = buckets - 1;
+    pool_init(&st->ghosts, sizeof(struct arc_ghost), 2 * p->capacity + 1);
+    p->state = st;
+}
+
+
+/*! \fn void arc_destroy(struct policy *p)
+ *  \brief Dealloca lo stato della politica ARC ed i fantasmi
+ */
+static void
+arc_destroy(struct policy *p)
+{
+    struct arc_state *st = p->state;
+    struct arc_ghost *g;
+    int i;
+
+    for (i = 0; i < 2; i++)
+        while ((g = TAILQ_FIRST(&st->b[i])))
+            ghost_remove(st, g);
+    pool_destroy(&st->ghosts);
+    XFREE(st->hash);
+    XFREE(st->nodes);
+    XFREE(st);
+}
+
+
+/*! \fn void arc_hit(struct policy *p, frame_t *f)
+ *  \brief Sposta il frame in coda a T2
+ */
+static void
+arc_hit(struct policy *p, frame_t *f)
+{
+    struct arc_state *st = p->state;
+    struct arc_node *n = &st->nodes[f->id];
+
+    TAILQ_REMOVE(&st->t[n->list], n, entries);
+    st->size[n->list]--;
+    n->list = ARC_T2;
+    TAILQ_INSERT_TAIL(&st->t[ARC_T2], n, entries);
+    st->size[ARC_T2]++;
+}
+
+
+/*! \fn frame_t *arc_victim(struct policy *p, int procnum, uint64_t page)
+ *  \brief Sceglie la vittima in T1 oppure in T2
+ *  \details Viene liberato il frame meno recente di T1 se questa supera la
+ *  dimensione obiettivo (o la eguaglia e la pagina richiesta si trova in B2),
+ *  altrimenti quello meno recente di T2.
+ */
+static frame_t *
+arc_victim(struct policy *p, int procnum, uint64_t page)
+{
+    struct arc_state *st = p->state;
+    struct arc_node *n;
+    int in_b2;
+
+    POLICY_SCAN(p);
+    adapt(st, procnum, page, p->capacity);
+    in_b2 = st->pending && st->pending->list == ARC_B2;
+    if (st->size[ARC_T1] > 0 &&
+        (st->size[ARC_T1] > st->target ||
+         (in_b2 && st->size[ARC_T1] == st->target)))
+        n = TAILQ_FIRST(&st->t[ARC_T1]);
+    else if (st->size[ARC_T2] > 0)
+        n = TAILQ_FIRST(&st->t[ARC_T2]);
+    else
+        n = TAILQ_FIRST(&st->t[ARC_T1]);
+    return &p->frames[n - st->nodes];
+}
+
+
+/*! \fn void arc_evict(struct policy *p, frame_t *f)
+ *  \brief Rimuove il frame da T1 o T2 e ne ricorda la pagina in B1 o B2
+ */
+static void
+arc_evict(struct policy *p, frame_t *f)
+{
+    struct arc_state *st = p->state;
+    struct arc_node *n = &st->nodes[f->id];
+    struct arc_ghost *g, **pg;
+
+    TAILQ_REMOVE(&st->t[n->list], n, entries);
+    st->size[n->list]--;
+
+    g = POOL_GET(&st->ghosts, struct arc_ghost);
+    g->pid = f->owner.pid;
+    g->page = f->owner.page_id;
+    g->list = (n->list == ARC_T1) ? ARC_B1 : ARC_B2;
+    pg = GHOST_HASH(st, g->pid, g->page);
+    g->next = *pg;
+    *pg = g;
+    TAILQ_INSERT_TAIL(&st->b[g->list - ARC_B1], g, entries);
+    st->size[g->list]++;
+}
+
+
+/*! \fn void arc_fault(struct policy *p, frame_t *f, int procnum, uint64_t page)
+ *  \brief Inserisce il frame appena caricato in T1 oppure, se la pagina era
+ *  ricordata tra i fantasmi, in T2
+ *  \details Al termine le liste dei fantasmi vengono ridotte, cosi' che
+ *  |T1| + |B1| non superi il numero di frame e l'insieme delle quattro liste
+ *  non ne superi il doppio.
+ */
+static void
+arc_fault(struct policy *p, frame_t *f, int procnum, uint64_t page)
+{
+    struct arc_state *st = p->state;
+    struct arc_node *n = &st->nodes[f->id];
+    unsigned c = p->capacity;
+
+    adapt(st, procnum, page, c);
+    if (st->pending) {
+        ghost_remove(st, st->pending);
+        n->list = ARC_T2;
+    } else
+        n->list = ARC_T1;
+    TAILQ_INSERT_TAIL(&st->t[n->list], n, entries);
+    st->size[n->list]++;
+    st->pending = NULL;
+    st->adapted = 0;
+
+    while (st->size[ARC_T1] + st->size[ARC_B1] > c && st->size[ARC_B1])
+        ghost_remove(st, TAILQ_FIRST(&st->b[0]));
+    while (st->size[ARC_T1] + st->size[ARC_T2] + st->size[ARC_B1] +
+           st->size[ARC_B2] > 2 * c && st->size[ARC_B2])
+        ghost_remove(st, TAILQ_FIRST(&st->b[1]));
+}
+
+
+/*! \var const struct policy_ops policy_arc
+ *  \brief Adaptive Replacement Cache
+ */
+const struct policy_ops policy_arc = {
+    "arc", "adaptive replacement cache",
+    arc_create, arc_destroy, arc_hit, arc_fault, arc_victim, arc_evict
+};
+
+/*! @} */
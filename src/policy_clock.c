@@ -0,0 +1,362 @@
+/*! \file policy_clock.c
+ *  Politiche di rimpiazzo basate su lancetta: second chance, clock, enhanced
+ *  second chance e WSClock.
+ */
+
+#include "policy.h"
+#include "mmu.h"
+#include <stdlib.h>
+
+/*! \def SC_SWEEPS
+ *  \brief Numero massimo di giri della lancetta per second chance
+ *  \details Un giro completo azzera i bit R e D di tutte le pagine: in assenza
+ *  di TLB hit concorrenti la vittima viene trovata entro il secondo giro.
+ */
+#define SC_SWEEPS           2
+
+/*! \def ESC_PASSES
+ *  \brief Numero massimo di giri della lancetta per enhanced second chance
+ *  \details Il primo giro cerca una pagina della classe (0,0) senza toccare
+ *  i bit, il secondo una pagina (0,1) azzerando il bit R; dopo il secondo
+ *  giro tutte le pagine hanno R uguale a zero, quindi il terzo o il quarto
+ *  trovano sicuramente una vittima.
+ */
+#define ESC_PASSES          4
+
+/*! \def CLOCK_SWEEPS
+ *  \brief Numero massimo di giri della lancetta per clock
+ *  \details Un giro completo azzera il bit R di tutte le pagine: in assenza
+ *  di TLB hit concorrenti la vittima viene trovata entro il secondo giro.
+ */
+#define CLOCK_SWEEPS        2
+
+/*! \def WSCLOCK_SWEEPS
+ *  \brief Numero di giri della lancetta dopo i quali WSClock sceglie il
+ *  frame usato meno di recente
+ */
+#define WSCLOCK_SWEEPS      2
+
+/*! \struct wsclock_state
+ *  \brief Stato della politica WSClock
+ */
+struct wsclock_state {
+    /*! anello dei frame residenti */
+    struct clock_ring ring;
+    /*! tempo virtuale: numero di riferimenti serviti dalla MMU */
+    uint32_t now;
+    /*! ampiezza della finestra del working set */
+    uint32_t tau;
+};
+
+
+/*! \addtogroup POLICY
+ * @{
+ *  \fn void hand_create(struct policy *p, const char *param)
+ *  \brief Alloca l'anello delle politiche second chance, clock ed enhanced
+ *  second chance
+ */
+static void
+hand_create(struct policy *p, const char *param)
+{
+    struct clock_ring *r = XMALLOC(struct clock_ring, 1);
+
+    clock_init(r, p->nframes);
+    p->state = r;
+}
+
+
+/*! \fn void hand_destroy(struct policy *p)
+ *  \brief Dealloca l'anello delle politiche second chance, clock ed enhanced
+ *  second chance
+ */
+static void
+hand_destroy(struct policy *p)
+{
+    clock_destroy(p->state);
+    XFREE(p->state);
+}
+
+
+/*! \fn void hand_hit(struct policy *p, frame_t *f)
+ *  \brief Un page hit e' gia' registrato nel bit Reference
+ */
+static void
+hand_hit(struct policy *p, frame_t *f)
+{
+}
+
+
+/*! \fn void hand_fault(struct policy *p, frame_t *f, int procnum, uint64_t page)
+ *  \brief Inserisce il frame appena caricato dietro la lancetta
+ */
+static void
+hand_fault(struct policy *p, frame_t *f, int procnum, uint64_t page)
+{
+    clock_insert(p->state, f->id);
+}
+
+
+/*! \fn void hand_evict(struct policy *p, frame_t *f)
+ *  \brief Rimuove il frame dall'anello
+ */
+static void
+hand_evict(struct policy *p, frame_t *f)
+{
+    clock_remove(p->state, f->id);
+}
+
+
+/*! \fn frame_t *sc_victim(struct policy *p, int procnum, uint64_t page)
+ *  \brief Algoritmo di rimpiazzo "second chance"
+ *  \details La lancetta riprende dal punto in cui si era fermata al fault
+ *  precedente, alla ricerca di una pagina con i bit R e D posti a zero; se
+ *  trova una pagina con il bit D uguale ad uno, ne effettua una copia su disco
+ *  (write back) e pone il bit a zero; se trova una pagina con il bit R uguale
+ *  ad uno, lo pone uguale a zero e prosegue. Dopo SC_SWEEPS giri senza
+ *  vittime viene scelta la pagina sotto la lancetta.
+ */
+static frame_t *
+sc_victim(struct policy *p, int procnum, uint64_t page)
+{
+    struct clock_ring *r = p->state;
+    unsigned i;
+    frame_t *f;
+
+    for (i = 0; i < SC_SWEEPS * r->count; i++) {
+        f = CLOCK_FRAME(p, r, clock_advance(r));
+        POLICY_SCAN(p);
+        if (IS_PAGE_DIRTY(FRAME_PAGE(f))) {
+            mmu_write_back(f);
+            PAGE_CLEAR_REFERENCED(FRAME_PAGE(f));
+            continue;
+        }
+        if (!IS_PAGE_REFERENCED(FRAME_PAGE(f)) && mmu_try_victim(f))
+            return f;
+        PAGE_CLEAR_REFERENCED(FRAME_PAGE(f));
+    }
+    f = CLOCK_FRAME(p, r, clock_advance(r));
+    POLICY_SCAN(p);
+    mmu_try_victim(f);
+    return f;
+}
+
+
+/*! \fn frame_t *clock_victim(struct policy *p, int procnum, uint64_t page)
+ *  \brief Algoritmo "clock"
+ *  \details La lancetta avanza azzerando il bit R delle pagine referenziate
+ *  e si ferma sulla prima pagina non referenziata. I TLB hit concorrenti
+ *  possono impostare nuovamente il bit R dopo il passaggio della lancetta:
+ *  dopo CLOCK_SWEEPS giri senza vittime viene scelta la pagina sotto la
+ *  lancetta.
+ */
+static frame_t *
+clock_victim(struct policy *p, int procnum, uint64_t page)
+{
+    struct clock_ring *r = p->state;
+    unsigned i;
+    frame_t *f;
+
+    for (i = 0; i < CLOCK_SWEEPS * r->count; i++) {
+        f = CLOCK_FRAME(p, r, clock_advance(r));
+        POLICY_SCAN(p);
+        if (!IS_PAGE_REFERENCED(FRAME_PAGE(f)) && mmu_try_victim(f))
+            return f;
+        PAGE_CLEAR_REFERENCED(FRAME_PAGE(f));
+    }
+    f = CLOCK_FRAME(p, r, clock_advance(r));
+    POLICY_SCAN(p);
+    mmu_try_victim(f);
+    return f;
+}
+
+
+/*! \fn frame_t *esc_victim(struct policy *p, int procnum, uint64_t page)
+ *  \brief Algoritmo "enhanced second chance"
+ *  \details Le pagine vengono classificate secondo la coppia (R, D) e la
+ *  vittima e' la prima pagina della classe piu' bassa incontrata dalla
+ *  lancetta:
+ *  \li giri pari: cerca una pagina (0,0) senza modificare i bit
+ *  \li giri dispari: cerca una pagina (0,1), azzerando il bit R delle pagine
+ *  esaminate
+ *
+ *  Una vittima "sporca" viene copiata su disco da evict_page. Se un TLB hit
+ *  concorrente impedisce di trovare una vittima entro ESC_PASSES giri, viene
+ *  scelta la pagina sotto la lancetta.
+ */
+static frame_t *
+esc_victim(struct policy *p, int procnum, uint64_t page)
+{
+    struct clock_ring *r = p->state;
+    unsigned i, pass;
+    frame_t *f;
+
+    for (pass = 0; pass < ESC_PASSES; pass++) {
+        for (i = 0; i < r->count; i++) {
+            f = CLOCK_FRAME(p, r, clock_advance(r));
+            POLICY_SCAN(p);
+            if (!IS_PAGE_REFERENCED(FRAME_PAGE(f)) &&
+                IS_PAGE_DIRTY(FRAME_PAGE(f)) == (pass & 1) &&
+                mmu_try_victim(f))
+                return f;
+            if (pass & 1)
+                PAGE_CLEAR_REFERENCED(FRAME_PAGE(f));
+        }
+    }
+    f = CLOCK_FRAME(p, r, clock_advance(r));
+    POLICY_SCAN(p);
+    mmu_try_victim(f);
+    return f;
+}
+
+
+/*! \fn void wsclock_create(struct policy *p, const char *param)
+ *  \brief Alloca lo stato della politica WSClock
+ *  \param param         Ampiezza della finestra del working set, espressa in
+ *                       riferimenti serviti dalla MMU (predefinita: numero di
+ *                       frame)
+ */
+static void
+wsclock_create(struct policy *p, const char *param)
+{
+    struct wsclock_state *st = XMALLOC(struct wsclock_state, 1);
+
+    clock_init(&st->ring, p->nframes);
+    st->now = 0;
+    st->tau = param ? strtoul(param, NULL, 10) : 0;
+    if (st->tau == 0)
+        st->tau = p->capacity;
+    p->state = st;
+}
+
+
+/*! \fn void wsclock_destroy(struct policy *p)
+ *  \brief Dealloca lo stato della politica WSClock
+ */
+static void
+wsclock_destroy(struct policy *p)
+{
+    struct wsclock_state *st = p->state;
+
+    clock_destroy(&st->ring);
+    XFREE(st);
+}
+
+
+/*! \fn void wsclock_hit(struct policy *p, frame_t *f)
+ *  \brief Aggiorna l'istante dell'ultimo utilizzo del frame
+ */
+static void
+wsclock_hit(struct policy *p, frame_t *f)
+{
+    struct wsclock_state *st = p->state;
+
+    st->ring.nodes[f->id].last_use = ++st->now;
+}
+
+
+/*! \fn void wsclock_fault(struct policy *p, frame_t *f, int procnum, uint64_t page)
+ *  \brief Inserisce il frame appena caricato dietro la lancetta
+ */
+static void
+wsclock_fault(struct policy *p, frame_t *f, int procnum, uint64_t page)
+{
+    struct wsclock_state *st = p->state;
+
+    clock_insert(&st->ring, f->id);
+    st->ring.nodes[f->id].last_use = ++st->now;
+}
+
+
+/*! \fn void wsclock_evict(struct policy *p, frame_t *f)
+ *  \brief Rimuove il frame dall'anello
+ */
+static void
+wsclock_evict(struct policy *p, frame_t *f)
+{
+    struct wsclock_state *st = p->state;
+
+    clock_remove(&st->ring, f->id);
+}
+
+
+/*! \fn frame_t *wsclock_victim(struct policy *p, int procnum, uint64_t page)
+ *  \brief Algoritmo "WSClock"
+ *  \details Per ogni frame sotto la lancetta:
+ *  \li se la pagina e' stata referenziata, azzera il bit R ed aggiorna
+ *  l'istante dell'ultimo utilizzo
+ *  \li se la pagina e' fuori dal working set (eta' maggiore di tau) ed e'
+ *  "sporca", ne avvia la copia su disco e prosegue
+ *  \li se la pagina e' fuori dal working set ed e' "pulita", la sceglie
+ *
+ *  Dopo WSCLOCK_SWEEPS giri senza vittime viene scelto il frame non
+ *  referenziato usato meno di recente.
+ */
+static frame_t *
+wsclock_victim(struct policy *p, int procnum, uint64_t page)
+{
+    struct wsclock_state *st = p->state;
+    struct clock_ring *r = &st->ring;
+    struct clock_node *n, *oldest = NULL;
+    unsigned i;
+    frame_t *f;
+
+    for (i = 0; i < WSCLOCK_SWEEPS * r->count; i++) {
+        n = clock_advance(r);
+        f = CLOCK_FRAME(p, r, n);
+        POLICY_SCAN(p);
+        if (IS_PAGE_REFERENCED(FRAME_PAGE(f))) {
+            PAGE_CLEAR_REFERENCED(FRAME_PAGE(f));
+            n->last_use = st->now;
+            continue;
+        }
+        if (!oldest || (int) (n->last_use - oldest->last_use) < 0)
+            oldest = n;
+        if (st->now - n->last_use <= st->tau)
+            continue;
+        if (IS_PAGE_DIRTY(FRAME_PAGE(f))) {
+            mmu_write_back(f);
+            continue;
+        }
+        if (mmu_try_victim(f))
+            return f;
+    }
+    f = CLOCK_FRAME(p, r, oldest ? oldest : clock_advance(r));
+    mmu_try_victim(f);
+    return f;
+}
+
+
+/*! \var const struct policy_ops policy_sc
+ *  \brief Second chance: lancetta sui bit Reference e Dirty
+ */
+const struct policy_ops policy_sc = {
+    "sc", "second chance con write-back (predefinito)",
+    hand_create, hand_destroy, hand_hit, hand_fault, sc_victim, hand_evict
+};
+
+/*! \var const struct policy_ops policy_clock
+ *  \brief Clock: lancetta sul bit Reference
+ */
+const struct policy_ops policy_clock = {
+    "clock", "clock (second chance circolare)",
+    hand_create, hand_destroy, hand_hit, hand_fault, clock_victim, hand_evict
+};
+
+/*! \var const struct policy_ops policy_esc
+ *  \brief Enhanced second chance: lancetta sulle classi (R, D)
+ */
+const struct policy_ops policy_esc = {
+    "esc", "enhanced second chance, classi (R,D)",
+    hand_create, hand_destroy, hand_hit, hand_fault, esc_victim, hand_evict
+};
+
+/*! \var const struct policy_ops policy_wsclock
+ *  \brief WSClock: lancetta sul working set
+ */
+const struct policy_ops policy_wsclock = {
+    "wsclock", "WSClock, finestra in accessi (wsclock:TAU)",
+    wsclock_create, wsclock_destroy, wsclock_hit, wsclock_fault,
+    wsclock_victim, wsclock_evict
+};
+
+/*! @} */
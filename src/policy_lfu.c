@@ -0,0 +1,195 @@
+/*! \file policy_lfu.c
+ *  Politica di rimpiazzo Least Frequently Used con operazioni in tempo
+ *  costante.
+ */
+
+#include "policy.h"
+#include "mmu.h"
+
+/*! \struct lfu_node
+ *  \brief Frame residente, inserito nel gruppo della propria frequenza
+ */
+struct lfu_node {
+    /*! collegamenti della lista del gruppo */
+    TAILQ_ENTRY(lfu_node) entries;
+    /*! gruppo di appartenenza */
+    struct lfu_bucket *bucket;
+};
+
+/*! \struct lfu_bucket
+ *  \brief Gruppo dei frame con la stessa frequenza d'uso
+ *  \details I frame di un gruppo sono ordinati per istante di ingresso nel
+ *  gruppo: a parita' di frequenza viene scelto quello usato meno di recente.
+ */
+struct lfu_bucket {
+    /*! collegamenti della lista dei gruppi, ordinata per frequenza */
+    TAILQ_ENTRY(lfu_bucket) entries;
+    /*! numero di riferimenti dei frame del gruppo */
+    uint32_t freq;
+    /*! frame del gruppo */
+    TAILQ_HEAD(lfu_nodes, lfu_node) nodes;
+};
+
+/*! \struct lfu_state
+ *  \brief Stato della politica LFU
+ *  \details I gruppi non vuoti sono al piu' uno per frame: vengono
+ *  preallocati ed estratti da una lista di gruppi liberi.
+ */
+struct lfu_state {
+    /*! gruppi non vuoti, in ordine di frequenza crescente */
+    TAILQ_HEAD(lfu_buckets, lfu_bucket) buckets;
+    /*! gruppi inutilizzati */
+    struct lfu_buckets free_buckets;
+    /*! vettore dei nodi, indicizzato dal frame-id */
+    struct lfu_node *nodes;
+    /*! vettore dei gruppi preallocati */
+    struct lfu_bucket *pool;
+};
+
+
+/*! \fn struct lfu_bucket *bucket_get(struct lfu_state *st, uint32_t freq)
+ *  \brief Estrae un gruppo libero per la frequenza "freq"
+ */
+static struct lfu_bucket *
+bucket_get(struct lfu_state *st, uint32_t freq)
+{
+    struct lfu_bucket *b = TAILQ_FIRST(&st->free_buckets);
+
+    TAILQ_REMOVE(&st->free_buckets, b, entries);
+    b->freq = freq;
+    TAILQ_INIT(&b->nodes);
+    return b;
+}
+
+
+/*! \fn void node_unlink(struct lfu_state *st, struct lfu_node *n)
+ *  \brief Rimuove un nodo dal proprio gruppo, liberando il gruppo se vuoto
+ */
+static void
+node_unlink(struct lfu_state *st, struct lfu_node *n)
+{
+    struct lfu_bucket *b = n->bucket;
+
+    TAILQ_REMOVE(&b->nodes, n, entries);
+    if (TAILQ_EMPTY(&b->nodes)) {
+        TAILQ_REMOVE(&st->buckets, b, entries);
+        TAILQ_INSERT_HEAD(&st->free_buckets, b, entries);
+    }
+}
+
+
+/*! \addtogroup POLICY
+ * @{
+ *  \fn void lfu_create(struct policy *p, const char *param)
+ *  \brief Alloca lo stato della politica LFU
+ */
+static void
+lfu_create(struct policy *p, const char *param)
+{
+    struct lfu_state *st = XMALLOC(struct lfu_state, 1);
+    unsigned i;
+
+    TAILQ_INIT(&st->buckets);
+    TAILQ_INIT(&st->free_buckets);
+    st->nodes = XMALLOC(struct lfu_node, p->nframes);
+    st->pool = XMALLOC(struct lfu_bucket, p->nframes + 1);
+    for (i = 0; i <= p->nframes; i++)
+        TAILQ_INSERT_TAIL(&st->free_buckets, &st->pool[i], entries);
+    p->state = st;
+}
+
+
+/*! \fn void lfu_destroy(struct policy *p)
+ *  \brief Dealloca lo stato della politica LFU
+ */
+static void
+lfu_destroy(struct policy *p)
+{
+    struct lfu_state *st = p->state;
+
+    XFREE(st->nodes);
+    XFREE(st->pool);
+    XFREE(st);
+}
+
+
+/*! \fn void lfu_hit(struct policy *p, frame_t *f)
+ *  \brief Sposta il frame nel gruppo della frequenza successiva
+ *  \details Se il frame e' l'unico del gruppo e la frequenza successiva non
+ *  e' rappresentata, e' sufficiente incrementare la frequenza del gruppo.
+ */
+static void
+lfu_hit(struct policy *p, frame_t *f)
+{
+    struct lfu_state *st = p->state;
+    struct lfu_node *n = &st->nodes[f->id];
+    struct lfu_bucket *b = n->bucket, *next = TAILQ_NEXT(b, entries);
+
+    if (!next || next->freq != b->freq + 1) {
+        if (TAILQ_FIRST(&b->nodes) == n && !TAILQ_NEXT(n, entries)) {
+            b->freq++;
+            return;
+        }
+        next = bucket_get(st, b->freq + 1);
+        TAILQ_INSERT_AFTER(&st->buckets, b, next, entries);
+    }
+    node_unlink(st, n);
+    TAILQ_INSERT_TAIL(&next->nodes, n, entries);
+    n->bucket = next;
+}
+
+
+/*! \fn void lfu_fault(struct policy *p, frame_t *f, int procnum, uint64_t page)
+ *  \brief Inserisce il frame appena caricato nel gruppo di frequenza uno
+ */
+static void
+lfu_fault(struct policy *p, frame_t *f, int procnum, uint64_t page)
+{
+    struct lfu_state *st = p->state;
+    struct lfu_node *n = &st->nodes[f->id];
+    struct lfu_bucket *b = TAILQ_FIRST(&st->buckets);
+
+    if (!b || b->freq != 1) {
+        b = bucket_get(st, 1);
+        TAILQ_INSERT_HEAD(&st->buckets, b, entries);
+    }
+    TAILQ_INSERT_TAIL(&b->nodes, n, entries);
+    n->bucket = b;
+}
+
+
+/*! \fn frame_t *lfu_victim(struct policy *p, int procnum, uint64_t page)
+ *  \brief Sceglie il frame meno recente del gruppo a frequenza minima
+ */
+static frame_t *
+lfu_victim(struct policy *p, int procnum, uint64_t page)
+{
+    struct lfu_state *st = p->state;
+    struct lfu_bucket *b = TAILQ_FIRST(&st->buckets);
+
+    POLICY_SCAN(p);
+    return &p->frames[TAILQ_FIRST(&b->nodes) - st->nodes];
+}
+
+
+/*! \fn void lfu_evict(struct policy *p, frame_t *f)
+ *  \brief Rimuove il frame dal proprio gruppo
+ */
+static void
+lfu_evict(struct policy *p, frame_t *f)
+{
+    struct lfu_state *st = p->state;
+
+    node_unlink(st, &st->nodes[f->id]);
+}
+
+
+/*! \var const struct policy_ops policy_lfu
+ *  \brief Least Frequently Used
+ */
+const struct policy_ops policy_lfu = {
+    "lfu", "least frequently used",
+    lfu_create, lfu_destroy, lfu_hit, lfu_fault, lfu_victim, lfu_evict
+};
+
+/*! @} */
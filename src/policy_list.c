@@ -0,0 +1,135 @@
+/*! \file policy_list.c
+ *  Politiche di rimpiazzo basate su liste: FIFO ed LRU.
+ */
+
+#include "policy.h"
+#include "mmu.h"
+
+/*! \struct list_node
+ *  \brief Elemento di lista associato ad un frame (FIFO, LRU)
+ */
+struct list_node {
+    /*! collegamenti della lista */
+    TAILQ_ENTRY(list_node) entries;
+};
+
+/*! \struct list_state
+ *  \brief Stato delle politiche FIFO ed LRU
+ *  \details I nodi sono allocati in un vettore indicizzato dal frame-id; la
+ *  lista e' ordinata dal frame caricato (FIFO) o usato (LRU) meno di recente.
+ */
+struct list_state {
+    /*! lista dei frame residenti */
+    TAILQ_HEAD(node_list, list_node) list;
+    /*! vettore dei nodi, indicizzato dal frame-id */
+    struct list_node *nodes;
+};
+
+/*! \addtogroup POLICY
+ * @{
+ *  \fn void list_create(struct policy *p, const char *param)
+ *  \brief Alloca lo stato delle politiche FIFO ed LRU
+ */
+static void
+list_create(struct policy *p, const char *param)
+{
+    struct list_state *st = XMALLOC(struct list_state, 1);
+
+    TAILQ_INIT(&st->list);
+    st->nodes = XMALLOC(struct list_node, p->nframes);
+    p->state = st;
+}
+
+
+/*! \fn void list_destroy(struct policy *p)
+ *  \brief Dealloca lo stato delle politiche FIFO ed LRU
+ */
+static void
+list_destroy(struct policy *p)
+{
+    struct list_state *st = p->state;
+
+    XFREE(st->nodes);
+    XFREE(st);
+}
+
+
+/*! \fn void list_insert(struct policy *p, frame_t *f, int procnum, uint64_t page)
+ *  \brief Inserisce il frame appena caricato in coda alla lista
+ */
+static void
+list_insert(struct policy *p, frame_t *f, int procnum, uint64_t page)
+{
+    struct list_state *st = p->state;
+
+    TAILQ_INSERT_TAIL(&st->list, &st->nodes[f->id], entries);
+}
+
+
+/*! \fn void list_remove(struct policy *p, frame_t *f)
+ *  \brief Rimuove dalla lista il frame appena liberato
+ */
+static void
+list_remove(struct policy *p, frame_t *f)
+{
+    struct list_state *st = p->state;
+
+    TAILQ_REMOVE(&st->list, &st->nodes[f->id], entries);
+}
+
+
+/*! \fn frame_t *list_victim(struct policy *p, int procnum, uint64_t page)
+ *  \brief Sceglie il frame in testa alla lista
+ */
+static frame_t *
+list_victim(struct policy *p, int procnum, uint64_t page)
+{
+    struct list_state *st = p->state;
+
+    POLICY_SCAN(p);
+    return &p->frames[TAILQ_FIRST(&st->list) - st->nodes];
+}
+
+
+/*! \fn void fifo_hit(struct policy *p, frame_t *f)
+ *  \brief FIFO: un page hit non modifica l'ordine della lista
+ */
+static void
+fifo_hit(struct policy *p, frame_t *f)
+{
+}
+
+
+/*! \fn void lru_hit(struct policy *p, frame_t *f)
+ *  \brief LRU: il frame referenziato viene spostato in coda alla lista
+ */
+static void
+lru_hit(struct policy *p, frame_t *f)
+{
+    struct list_state *st = p->state;
+    struct list_node *n = &st->nodes[f->id];
+
+    if (n != TAILQ_LAST(&st->list, node_list)) {
+        TAILQ_REMOVE(&st->list, n, entries);
+        TAILQ_INSERT_TAIL(&st->list, n, entries);
+    }
+}
+
+
+/*! \var const struct policy_ops policy_fifo
+ *  \brief First In, First Out
+ */
+const struct policy_ops policy_fifo = {
+    "fifo", "first in, first out",
+    list_create, list_destroy, fifo_hit, list_insert, list_victim, list_remove
+};
+
+/*! \var const struct policy_ops policy_lru
+ *  \brief Least Recently Used
+ */
+const struct policy_ops policy_lru = {
+    "lru", "least recently used",
+    list_create, list_destroy, lru_hit, list_insert, list_victim, list_remove
+};
+
+/*! @} */
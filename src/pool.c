@@ -0,0 +1,115 @@
+/*! \file pool.c
+ */
+
+#include "pool.h"
+#include <stdlib.h>
+#include <pthread.h>
+
+/*! \def POOL_ALIGN
+ *  \brief Allineamento degli oggetti all'interno di un blocco
+ */
+#define POOL_ALIGN              sizeof(void *)
+
+/*! \var struct pool_stats pool_stats
+ *  \brief Statistiche accumulate da pool_destroy
+ */
+struct pool_stats pool_stats;
+
+/*! \var pthread_mutex_t stats_lock
+ *  \brief Mutex a protezione di pool_stats: i pool vengono deallocati da
+ *  thread diversi
+ */
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+/*! \fn void pool_grow(struct pool *p)
+ *  \brief Alloca un nuovo blocco e ne inserisce gli oggetti nella lista
+ *  degli oggetti liberi
+ */
+static void
+pool_grow(struct pool *p)
+{
+    struct pool_chunk *c;
+    char *obj;
+    unsigned i;
+
+    c = (struct pool_chunk *) xmalloc(POOL_ALIGN + p->count * p->size);
+    c->next = p->chunks;
+    p->chunks = c;
+    p->allocs++;
+    obj = (char *) c + POOL_ALIGN;
+    for (i = 0; i < p->count; i++, obj += p->size) {
+        *(void **) obj = p->free;
+        p->free = obj;
+    }
+}
+
+
+/*! \addtogroup POOL
+ * @{
+ *  \fn void pool_init(struct pool *p, size_t size, unsigned count)
+ *  \brief Inizializza un pool preallocando "count" oggetti
+ *  \param p             Pool da inizializzare
+ *  \param size          Dimensione di un oggetto
+ *  \param count         Numero di oggetti per blocco, da dimensionare sul
+ *                       massimo numero di oggetti contemporaneamente in uso
+ */
+void pool_init(struct pool *p, size_t size, unsigned count)
+{
+    if (size < sizeof(void *))
+        size = sizeof(void *);
+    p->size = (size + POOL_ALIGN - 1) & ~(POOL_ALIGN - 1);
+    p->count = count ? count : 1;
+    p->free = NULL;
+    p->chunks = NULL;
+    p->gets = p->allocs = 0;
+    pool_grow(p);
+}
+
+
+/*! \fn void pool_destroy(struct pool *p)
+ *  \brief Dealloca i blocchi del pool e ne accumula le statistiche
+ */
+void pool_destroy(struct pool *p)
+{
+    struct pool_chunk *c;
+
+    while ((c = p->chunks)) {
+        p->chunks = c->next;
+        XFREE(c);
+    }
+    p->free = NULL;
+    pthread_mutex_lock(&stats_lock);
+    pool_stats.gets += p->gets;
+    pool_stats.allocs += p->allocs;
+    pthread_mutex_unlock(&stats_lock);
+}
+
+
+/*! \fn void *pool_get(struct pool *p)
+ *  \brief Estrae un oggetto dal pool
+ *  \return              Oggetto non inizializzato
+ */
+void *pool_get(struct pool *p)
+{
+    void *obj;
+
+    if (!p->free)
+        pool_grow(p);
+    obj = p->free;
+    p->free = *(void **) obj;
+    p->gets++;
+    return obj;
+}
+
+
+/*! \fn void pool_put(struct pool *p, void *obj)
+ *  \brief Restituisce un oggetto al pool
+ */
+void pool_put(struct pool *p, void *obj)
+{
+    *(void **) obj = p->free;
+    p->free = obj;
+}
+
+/*! @} */
@@ -0,0 +1,73 @@
+/*! \file pool.h
+ *  \defgroup POOL Pool di oggetti a dimensione fissa
+ */
+
+#ifndef __POOL_H__
+#define __POOL_H__
+
+#include <stddef.h>
+#include "vm_types.h"
+
+/*! \def POOL_GET(p, type)
+ *  \brief Estrae un oggetto di tipo "type" dal pool "p"
+ *  \def POOL_PUT(p, obj)
+ *  \brief Restituisce l'oggetto "obj" al pool "p" e ne azzera il puntatore
+ */
+#define POOL_GET(p, type)       ((type *) pool_get(p))
+#define POOL_PUT(p, obj)        do { \
+pool_put((p), (void *) (obj)); \
+obj = 0; \
+} while (0)
+
+/*! \struct pool_chunk
+ *  \brief Blocco di memoria contiguo dal quale vengono ricavati gli oggetti
+ */
+struct pool_chunk {
+    /*! blocco allocato in precedenza */
+    struct pool_chunk *next;
+};
+
+/*! \struct pool
+ *  \brief Pool di oggetti della stessa dimensione
+ *  \details Gli oggetti liberi formano una lista il cui collegamento occupa
+ *  i primi byte dell'oggetto stesso: estrazione e restituzione costano un
+ *  paio di assegnamenti. Se il pool si esaurisce viene allocato un ulteriore
+ *  blocco della stessa capacita'. Il pool non e' protetto da alcun lock: ogni
+ *  utilizzatore lo accede in mutua esclusione.
+ */
+struct pool {
+    /*! dimensione di un oggetto, arrotondata all'allineamento */
+    size_t size;
+    /*! numero di oggetti per blocco */
+    unsigned count;
+    /*! lista degli oggetti liberi */
+    void *free;
+    /*! blocchi allocati */
+    struct pool_chunk *chunks;
+    /*! numero di oggetti estratti */
+    uint64_t gets;
+    /*! numero di blocchi allocati dall'heap */
+    uint32_t allocs;
+};
+
+/*! \struct pool_stats
+ *  \brief Statistiche complessive dei pool deallocati
+ */
+struct pool_stats {
+    /*! oggetti estratti dai pool */
+    uint64_t gets;
+    /*! blocchi allocati dall'heap */
+    uint32_t allocs;
+};
+
+/*
+ *  Prototipi di funzioni pubbliche
+ */
+void pool_init(struct pool *, size_t, unsigned);
+void pool_destroy(struct pool *);
+void *pool_get(struct pool *);
+void pool_put(struct pool *, void *);
+
+extern struct pool_stats pool_stats;
+
+#endif              /* __POOL_H__ */
@@ -13,6 +13,7 @@
 #include "proc.h"
 #include "mmu.h"
 #include "io_device.h"
+#include "trace.h"
 #include <string.h>
 #include <math.h>
 
@@ -44,6 +45,29 @@ uint16_t *reference_string;
  */
 int reference_count;
 
+/*! \var struct trace *replay_trace
+ *  \brief Traccia binaria da riprodurre
+ *  \details Se impostata (parametro "--trace"), i processi effettuano gli
+ *  accessi registrati nella traccia anziche' generarli casualmente.
+ */
+struct trace *replay_trace;
+
+/*! \var int direct_replay
+ *  \brief Riproduzione diretta (parametro "--fast")
+ *  \details Se vale uno (1), proc_init non crea i thread dei processi: la
+ *  traccia o la reference string vengono riprodotte da proc_replay nel
+ *  thread chiamante.
+ */
+int direct_replay;
+
+/*! \var int process_logs
+ *  \brief Se vale zero (0), i log dei processi (PROC_NN.log) non vengono
+ *  creati
+ *  \details Le esecuzioni concorrenti di "--sweep" condividono la directory
+ *  corrente e non devono sovrascrivere i log l'una dell'altra.
+ */
+int process_logs = 1;
+
 
 /*! \def DSS(proc)
  *  \brief Dimensione spazio indirizzamento virtuale
@@ -51,7 +75,12 @@ int reference_count;
  *  processo, dato dal prodotto del numero di pagine allocate per la dimensione
  *  della singola.
  */
-#define DSS(p)                     (((proc_table[p]))->page_count*mmu.page_size)
+#define DSS(p)                     (((proc_table[p]))->page_count*(uint64_t) mmu.page_size)
+
+/*! \def PROC_RNG(p)
+ *  \brief Generatore di numeri casuali del processo
+ */
+#define PROC_RNG(p)                (&proc_table[p]->rng)
 
 /*! \def MEM_ACCESS_PROBABILITY(n)
  *  \brief Probabilita di effettuare un accesso in memoria
@@ -65,12 +94,9 @@ int reference_count;
  *  \brief Attesa per il completamente I/O
  *  \details Il processo deve restare in attesa che il dispositivo di I/O
  *  espleti la richiesta effettuata.
+ *  \sa io_device_wait
  */
-#define WAIT_FOR_IO_TO_COMPLETE(n) do { \
-    pthread_mutex_lock(&proc_table[n]->io_lock);\
-    pthread_cond_wait(&proc_table[n]->io_cond, &proc_table[n]->io_lock);\
-    pthread_mutex_unlock(&proc_table[n]->io_lock); \
-    } while (0)
+#define WAIT_FOR_IO_TO_COMPLETE(n) io_device_wait(n)
 
 /*! \var int temporal_locality
  *  \brief Localita temporale
@@ -78,6 +104,32 @@ int reference_count;
  */
 int temporal_locality = 30;
 
+/*! \var unsigned tlb_entries
+ *  \brief Numero di voci del TLB di ogni processo (zero lo disabilita)
+ */
+unsigned tlb_entries;
+
+/*! \var unsigned tlb_ways
+ *  \brief Associativita' del TLB (voci per insieme)
+ */
+unsigned tlb_ways;
+
+/*! \var int tlb_policy
+ *  \brief Politica di rimpiazzo delle voci del TLB
+ */
+int tlb_policy;
+
+/*! \var unsigned pt_levels
+ *  \brief Numero di livelli della tabella delle pagine di ogni processo
+ */
+unsigned pt_levels;
+
+/*! \var char *workload_list
+ *  \brief Modelli di carico dei processi (parametro "--workload")
+ *  \sa workload_parse
+ */
+char *workload_list;
+
 /*! \var static int only_read_allowed
  *  \brief Tipo di accesso alla memoria (R o RW)
  *  \details Determina se i processi possono effettuare accessi alla memoria
@@ -108,21 +160,24 @@ int max_proc;
  *  \brief Simulazione d'accesso ad un vettore di elementi
  *  \details La funzione e' responsabile della simulazione di un'iterazione su
  *  un vettore di LOOP_ITERATIONS elementi, ognuno dei quali e' pari a 
- *  SIZE_OF_ITEM byte.
+ *  SIZE_OF_ITEM byte: gli accessi vengono consegnati alla MMU in un unico
+ *  vettore.
  */
 static int
 simulate_loop(int procnum)
 {
-    int rw, i;
-    uint32_t addr;
+    struct mmu_access v[LOOP_ITERATIONS];
+    int i;
+    uint64_t addr;
     
-    addr = bounded_rand(0, DSS(procnum)-LOOP_ITERATIONS*SIZE_OF_ITEM);
+    addr = bounded_rand64(PROC_RNG(procnum), 0,
+                          DSS(procnum)-LOOP_ITERATIONS*SIZE_OF_ITEM);
     for (i=0; i<LOOP_ITERATIONS; i++) {
-        rw = only_read_allowed ? 0 : (bounded_rand(0, 100) > 50 ? 1 : 0);
-        if (memory_access(procnum, addr + (i*SIZE_OF_ITEM), rw) == (uint32_t) - 1)
-            return 0;
+        v[i].virtual_address = addr + (i*SIZE_OF_ITEM);
+        v[i].rw = only_read_allowed ? 0 :
+                  (bounded_rand(PROC_RNG(procnum), 0, 100) > 50 ? 1 : 0);
     }
-    return 1;
+    return memory_access_batch(procnum, v, LOOP_ITERATIONS) == LOOP_ITERATIONS;
 }
 
 
@@ -138,28 +193,53 @@ simulate_loop(int procnum)
 static int
 random_access(int procnum)
 {
-    uint32_t addr;
+    uint64_t addr;
     int rw; 
     
-    if (proc_table[procnum]->last_address == (uint32_t) -1)
+    if (proc_table[procnum]->last_address == (uint64_t) -1)
         /*
          *  E' la prima volta che il processo accede alla memoria: genero un
          *  indirizzo compresso tra 0 ed il massimo spazio d'indirizzamento del
          *  processo.
          */
-        addr = bounded_rand(0, DSS(procnum));
+        addr = bounded_rand64(PROC_RNG(procnum), 0, DSS(procnum)-1);
     else {
-        if (bounded_rand(0, 100) <= temporal_locality) {
+        if (bounded_rand(PROC_RNG(procnum), 0, 100) <= temporal_locality) {
             addr = proc_table[procnum]->last_address+1024;
-            if (addr > DSS(procnum))
+            if (addr >= DSS(procnum))
                 addr = proc_table[procnum]->last_address;
         } else
-            addr = bounded_rand(0, DSS(procnum));   
+            addr = bounded_rand64(PROC_RNG(procnum), 0, DSS(procnum)-1);   
     }
     proc_table[procnum]->last_address = addr;
     
-    rw = only_read_allowed ? 0 : (bounded_rand(0, 100) > 50 ? 1 : 0);
-    return (memory_access(procnum, addr, rw) != (uint32_t) - 1);
+    rw = only_read_allowed ? 0 :
+         (bounded_rand(PROC_RNG(procnum), 0, 100) > 50 ? 1 : 0);
+    return (memory_access(procnum, addr, rw) != (uint64_t) -1);
+}
+
+
+/*! \fn uint64_t replay_address(int procnum, const struct trace_record *rec)
+ *  \brief Riconduce l'indirizzo di un record allo spazio del processo
+ *  \details Lo spazio d'indirizzamento e' una potenza di due: gli indirizzi
+ *  esterni vengono ridotti modulo la sua dimensione, ricadendo sulle pagine
+ *  iniziali, ed alla prima occorrenza viene stampato un avviso.
+ *  \param procnum       Identificativo del processo all'interno di proc_table
+ *  \param rec           Record della traccia
+ *  \return              Indirizzo virtuale da riprodurre
+ */
+static uint64_t
+replay_address(int procnum, const struct trace_record *rec)
+{
+    static int warned;
+    
+    if (rec->address >= DSS(procnum) &&
+        !__atomic_exchange_n(&warned, 1, __ATOMIC_RELAXED))
+        fprintf(stderr, "Attenzione: l'indirizzo %" PRIu64 " della traccia "
+                "eccede lo spazio d'indirizzamento del processo %d (%" PRIu64
+                " byte) e viene ricondotto alle pagine iniziali: aumentare "
+                "--address-bits.\n", rec->address, procnum, DSS(procnum));
+    return rec->address & (DSS(procnum) - 1);
 }
 
 
@@ -178,37 +258,71 @@ static void *
 thread_proc(int procnum)
 {
     int condition = 1, reference_item = 0;
+    struct trace_cursor cursor;
     
     fprintf(LOG_FILE(procnum),  "INIZIO PROCESSO\n======================\n"
-            "PID             = %d\nPAGINE VIRTUALI = %d\nPROBABILITA'    = %.0f%%\n"
-            "======================\n", procnum, proc_table[procnum]->page_count,
+            "PID             = %d\nPAGINE VIRTUALI = %" PRIu64 "\nPROBABILITA'    = %.0f%%\n",
+            procnum, proc_table[procnum]->page_count,
             proc_table[procnum]->percentile);
+    fprintf(LOG_FILE(procnum), "CARICO          = ");
+    workload_describe(&proc_table[procnum]->workload, LOG_FILE(procnum));
+    fprintf(LOG_FILE(procnum), "\n======================\n");
+    if (replay_trace)
+        trace_cursor_init(replay_trace, &cursor, procnum, max_proc);
     
     while (condition) {
         /*
          *  Verifico se sono nella modalta' in cui viene misurato il numero di
-         *  page fault usando la reference string: in questo caso il processo
-         *  effettua gli accessi richiesti, viceversa effettua gli accessi come
+         *  page fault usando una traccia o la reference string: in questo caso
+         *  il processo effettua gli accessi richiesti, viceversa effettua gli accessi come
          *  da specifica (I/O e memoria).
          */
-        if (reference_string) {
-            uint32_t addr;
+        if (replay_trace) {
+            const struct trace_record *rec = NULL;
+            struct mmu_access v[MMU_RING_SIZE];
+            int n;
+            
+            /*
+             *  Riproduco gli accessi del processo registrati nella traccia,
+             *  MMU_RING_SIZE alla volta: gli indirizzi vengono ricondotti
+             *  allo spazio d'indirizzamento del processo, una potenza di due.
+             */
+            for (n = 0; n < MMU_RING_SIZE &&
+                        (rec = trace_next(&cursor)) != NULL; n++) {
+                v[n].virtual_address = replay_address(procnum, rec);
+                v[n].rw = rec->flags & TRACE_WRITE;
+            }
+            if (memory_access_batch(procnum, v, n) < n || rec == NULL)
+                condition = 0;
+        } else if (reference_string) {
+            uint64_t addr;
             
             if (reference_item >= reference_count)
                 reference_item = 0;
             addr = reference_string[reference_item++];
             addr *= mmu.page_size;
-            if (memory_access(procnum, addr, 0) == (uint32_t) -1)
+            if (memory_access(procnum, addr, 0) == (uint64_t) -1)
                 condition = 0;
         } else {        
-            if (bounded_rand(0, 100) <= MEM_ACCESS_PROBABILITY(procnum)) {
+            if (bounded_rand(PROC_RNG(procnum), 0, 100) <=
+                MEM_ACCESS_PROBABILITY(procnum)) {
+                struct workload *w = &proc_table[procnum]->workload;
+                
+                if (w->model != WL_DEFAULT) {
+                    uint64_t addr = workload_next(w, PROC_RNG(procnum));
+                    int rw = only_read_allowed ? 0 :
+                             (bounded_rand(PROC_RNG(procnum), 0, 100) > 50);
+                    
+                    condition = memory_access(procnum, addr, rw) != (uint64_t) -1;
+                    continue;
+                }
                 /*  Nel 20% dei casi, il processo effettua un loop (while/for), 
                  *  effettuando acessi ad indirizzi di memoria contigui. 
                  *  Nel restante 80% effettua un accesso casuale al proprio spazio 
                  *  d'indirizzamento, con la possibilita di localita temporale, 
                  *  ovvero di accedere ad un indirizzo usato di recente.
                  */
-                if (bounded_rand(0, 100) <= 30)
+                if (bounded_rand(PROC_RNG(procnum), 0, 100) <= 30)
                     condition = simulate_loop(procnum);
                 else
                     condition = random_access(procnum);
@@ -225,6 +339,9 @@ thread_proc(int procnum)
         }
     }
     
+    if (replay_trace)
+        trace_cursor_destroy(&cursor);
+    io_device_proc_exit();
     pthread_exit(NULL);
 }
 
@@ -255,7 +372,7 @@ proc_init(int num, int percentile, int only_read, int max_memory, char *pl, int
 {
     char proc_filename[FILENAME_MAX];
     int *probs = NULL;
-    int i, j;
+    int i;
     
     temporal_locality = lp;
     only_read_allowed = only_read;
@@ -291,33 +408,44 @@ proc_init(int num, int percentile, int only_read, int max_memory, char *pl, int
         snprintf(proc_filename, FILENAME_MAX, "PROC_%02d.log", i);
         proc_table[i] = XMALLOC(proc_t, 1);
         proc_table[i]->pid = i;
+        rng_init(&proc_table[i]->rng, RNG_STREAM_PROC(i));
         if (reference_string)
             proc_table[i]->page_count = reference_count;
         else
-            proc_table[i]->page_count = max_memory?exp2(mmu.page_bits):bounded_rand(1, exp2(mmu.page_bits));
+            proc_table[i]->page_count = max_memory ? 1ULL << mmu.page_bits :
+                                        bounded_rand64(&proc_table[i]->rng, 1,
+                                                       1ULL << mmu.page_bits);
+        workload_parse(workload_list, i, &proc_table[i]->workload);
+        workload_init(&proc_table[i]->workload, &proc_table[i]->rng,
+                      proc_table[i]->page_count, mmu.page_size);
         proc_table[i]->percentile = probs?((i<max_proc)?probs[i]:percentile):percentile;
-        proc_table[i]->log_file = fopen(proc_filename, "w");
+        proc_table[i]->log_file = fopen(process_logs ? proc_filename :
+                                        "/dev/null", "w");
         proc_table[i]->stats.mem_accesses = proc_table[i]->stats.page_faults = 0;
         proc_table[i]->stats.io_requests = proc_table[i]->stats.time_elapsed = 0;
-        proc_table[i]->last_address = (uint32_t) -1;
+        proc_table[i]->stats.tlb_hits = proc_table[i]->stats.tlb_misses = 0;
+        proc_table[i]->stats.io_wait = proc_table[i]->stats.io_wait_max = 0;
+        proc_table[i]->stats.page_ins = proc_table[i]->stats.fault_wait = 0;
+        memset(proc_table[i]->stats.io_wait_hist, 0,
+               sizeof(proc_table[i]->stats.io_wait_hist));
+        proc_table[i]->last_address = (uint64_t) -1;
         pthread_cond_init(&proc_table[i]->io_cond, NULL);
         pthread_mutex_init(&proc_table[i]->io_lock, NULL);
+        proc_table[i]->io_issued = proc_table[i]->io_completed = 0;
+        ring_init(&proc_table[i]->ring);
+        tlb_init(&proc_table[i]->tlb, tlb_entries, tlb_ways, tlb_policy);
         
         /*
-         *  Alloco ed inizializzo la page table del processo: il numero di 
-         *  pagine e' tracciato dalla variabile "page_count", generato
-         *  casualmente in un intervallo [1,16], in modo tale che ogni 
-         *  processo abbia almeno una pagina.
+         *  Inizializzo la page table del processo: il numero di pagine e'
+         *  tracciato dalla variabile "page_count", generato casualmente in
+         *  modo tale che ogni processo abbia almeno una pagina. I nodi della
+         *  tabella vengono allocati soltanto al primo accesso.
          */
-        proc_table[i]->page_table = XMALLOC(page_t, proc_table[i]->page_count);
-        for (j = 0; j < proc_table[i]->page_count; j++) {
-            proc_table[i]->page_table[j].id = j;
-            proc_table[i]->page_table[j].frame_id = (uint16_t) -1;
-            proc_table[i]->page_table[j].present = 0;
-            proc_table[i]->page_table[j].reference = 0;
-            proc_table[i]->page_table[j].dirty = 0;         
-        }
+        pt_init(&proc_table[i]->page_table, mmu.page_bits, pt_levels);
     }
+    if (direct_replay)
+        return;
+    
     /*
      *  Eseguo "max_proc" thread di tipo processo utente.
      */
@@ -328,34 +456,81 @@ proc_init(int num, int percentile, int only_read, int max_memory, char *pl, int
 }
 
 
+/*! \fn void proc_replay()
+ *  \brief Riproduzione diretta della traccia o della reference string
+ *  \details Gli accessi vengono effettuati, nel thread chiamante, tramite
+ *  mmu_direct_access: la traccia viene riprodotta nel suo ordine globale,
+ *  attribuendo ogni record al processo simulato come in thread_proc, mentre
+ *  la reference string viene ripetuta fino a raggiungere il numero totale
+ *  di accessi. Il risultato e' deterministico; con piu' processi, tuttavia,
+ *  l'ordine differisce da quello dei thread, che dipende dallo scheduling,
+ *  ed in main viene stampato un avviso.
+ *  \sa direct_replay
+ */
+void proc_replay()
+{
+    const struct trace_record *rec;
+    struct trace_cursor cursor;
+    uint64_t n;
+    int pid;
+    
+    if (replay_trace) {
+        trace_cursor_init(replay_trace, &cursor, 0, 1);
+        for (n = 0; n < mmu.total_access &&
+                    (rec = trace_next(&cursor)) != NULL; n++) {
+            pid = rec->pid % max_proc;
+            mmu_direct_access(pid, replay_address(pid, rec),
+                              rec->flags & TRACE_WRITE);
+        }
+        trace_cursor_destroy(&cursor);
+    } else {
+        for (n = 0; n < mmu.total_access; n++)
+            mmu_direct_access(0, (uint64_t) reference_string[n % reference_count]
+                              * mmu.page_size, 0);
+    }
+}
+
+
+/*! \fn void page_info(uint64_t page, page_t *pte, void *arg)
+ *  \brief Stampa lo stato di una pagina nel file di log del processo "arg"
+ */
+static void
+page_info(uint64_t page, page_t *pte, void *arg)
+{
+    proc_t *proc = arg;
+    
+    if (page >= proc->page_count)
+        return;
+    fprintf(proc->log_file, "         PAGE %2" PRIu64 " : ", page);
+    if (IS_PAGE_PRESENT(*pte)) {
+        unsigned int frame_id = FRAME_ID(*pte);
+        fprintf(proc->log_file, "FRAME %2d ", frame_id);
+        if (IS_PAGE_REFERENCED(*pte))
+            fprintf(proc->log_file, "[REF");
+        else
+            fprintf(proc->log_file, "[NOT REF");
+        if (IS_PAGE_DIRTY(*pte))
+            fprintf(proc->log_file, ", DIRTY]\n");
+        else
+            fprintf(proc->log_file, "]\n");
+    } else
+        fprintf(proc->log_file, "\n");
+}
+
+
 /*! \fn void process_info(int procnum)
  *  \brief Stampa lo stato delle pagine di un processo
  *  \details La funzione scrive, nel file di log del processo, lo stato delle 
  *  pagine: per ognuna di esse viene indicato se e' presente o meno in memoria, 
- *  se e' referenziata o se "sporca".
+ *  se e' referenziata o se "sporca". Vengono elencate soltanto le pagine
+ *  delle foglie gia' allocate della tabella.
  *  \param procnum       Identificativo processo nella page table
  */
 void process_info(int procnum)
 {
     proc_t *proc = proc_table[procnum];
-    int i;
     
-    for (i = 0; i < proc->page_count; i++) {
-        fprintf(proc->log_file, "         PAGE %2d : ", i);
-        if (IS_PAGE_PRESENT(proc->page_table[i])) {
-            unsigned int frame_id = FRAME_ID(proc->page_table[i]);
-            fprintf(proc->log_file, "FRAME %2d ", frame_id);
-            if (IS_PAGE_REFERENCED(proc->page_table[i]))
-                fprintf(proc->log_file, "[REF");
-            else
-                fprintf(proc->log_file, "[NOT REF");
-            if (IS_PAGE_DIRTY(proc->page_table[i]))
-                fprintf(proc->log_file, ", DIRTY]\n");
-            else
-                fprintf(proc->log_file, "]\n");
-        } else
-            fprintf(proc->log_file, "\n");
-    }
+    pt_foreach(&proc->page_table, page_info, proc);
     fprintf(proc->log_file, "============================================\n");
 }
 
@@ -15,6 +15,11 @@
 
 #include <pthread.h>
 #include "vm_types.h"
+#include "ring.h"
+#include "tlb.h"
+#include "pagetable.h"
+#include "random.h"
+#include "workload.h"
 
 /*! \def LOG_FILE(n)
  *  \brief File di log del processo
@@ -24,6 +29,12 @@
  */
 #define LOG_FILE(n)                (proc_table[n]->log_file)
 
+/*! \def IO_WAIT_BUCKETS
+ *  \brief Classi (di 1 ms) dell'istogramma delle attese di I/O: l'ultima
+ *  raccoglie le attese superiori
+ */
+#define IO_WAIT_BUCKETS            1024
+
 /*! \struct proc
  *  \brief Struttura per la rappresentazione in memoria di un processo
  *  \details E' la funzione proc_init ad avere il compito di creare i thread che 
@@ -36,9 +47,9 @@ struct proc {
     /*! Thread ID associato al processo */
     pthread_t tid;
     /*! Numero di pagine allocate dal processo */
-    unsigned page_count;
+    uint64_t page_count;
     /*! Tabella delle pagine del processo */
-    page_t *page_table;
+    struct page_table page_table;
     /*! Percentuale di effettuare un accesso alla memoria piuttosto che una
      lettura dal dispositivo di I/O */
     float percentile;
@@ -46,21 +57,48 @@ struct proc {
     pthread_cond_t io_cond;
     /*! Mutex per la condizione d'attesa */
     pthread_mutex_t io_lock;
+    /*! Richieste di I/O effettuate dal processo (protetto da io_lock) */
+    uint64_t io_issued;
+    /*! Richieste di I/O completate dal dispositivo (protetto da io_lock):
+     il processo attende finche' e' inferiore a io_issued */
+    uint64_t io_completed;
     /*! File di log associato al processo */
     FILE *log_file;
     /*! Statistiche delle operazioni effettuate dal processo */
     struct  proc_stats {
         /*! Numero di accessi alla memoria */
-        uint16_t mem_accesses;
+        uint64_t mem_accesses;
         /*! Numero di page fault generati a seguito di un accesso */
-        uint16_t page_faults;
+        uint64_t page_faults;
         /*! Numero di richieste al dispositivo di I/O */
-        uint16_t io_requests;
+        uint64_t io_requests;
         /*! Totale dei tempi d'attesa per espletare le richieste di I/O */
-        uint16_t time_elapsed;
+        uint64_t time_elapsed;
+        /*! Totale delle attese di I/O, coda compresa (us) */
+        uint64_t io_wait;
+        /*! Attesa di I/O massima (us) */
+        uint64_t io_wait_max;
+        /*! Istogramma delle attese di I/O, in ms */
+        uint32_t io_wait_hist[IO_WAIT_BUCKETS];
+        /*! Caricamenti di pagine attesi dal processo (--fault-io) */
+        uint64_t page_ins;
+        /*! Totale delle attese per il caricamento delle pagine (us) */
+        uint64_t fault_wait;
+        /*! Numero di traduzioni risolte dal TLB del processo */
+        uint64_t tlb_hits;
+        /*! Numero di traduzioni inoltrate alla MMU dopo un TLB miss */
+        uint64_t tlb_misses;
     } stats;
     /*! Ultimo indirizzo di memoria generato (localita) */
-    uint32_t last_address;
+    uint64_t last_address;
+    /*! Code richiesta/risposta verso la MMU */
+    struct mmu_ring ring;
+    /*! TLB del processo, consultato prima di inoltrare la richiesta alla MMU */
+    struct tlb tlb;
+    /*! Generatore di numeri casuali del processo */
+    struct rng rng;
+    /*! Modello di carico che genera gli indirizzi del processo */
+    struct workload workload;
 };
 
 /*! \typedef struct proc proc_t
@@ -72,6 +110,7 @@ typedef struct proc proc_t;
  *  Prototipi di funzioni pubbliche
  */
 void proc_init(int, int, int, int, char *, int);
+void proc_replay();
 void process_info(int);
 
 #endif              /* __PROC_H__ */
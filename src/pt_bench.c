@@ -0,0 +1,110 @@
+/*! \file pt_bench.c
+ *  Microbenchmark delle scansioni della tabella delle pagine: compilato con
+ *  e senza PT_BITMAP (make bench-layout) confronta la disposizione a voci
+ *  contigue con quella a bitmap.
+ */
+
+#include <stdlib.h>
+#include <time.h>
+#include "mmu.h"
+
+/*! \def BENCH_ROUNDS
+ *  \brief Numero di ripetizioni di ogni scansione
+ */
+#define BENCH_ROUNDS            20
+
+/*! \def NSEC_PER_PAGE(t0, t1, pages)
+ *  \brief Tempo medio per pagina, in nanosecondi, di BENCH_ROUNDS scansioni
+ */
+#define NSEC_PER_PAGE(t0, t1, pages) \
+    (((t1).tv_sec - (t0).tv_sec) * 1e9 + ((t1).tv_nsec - (t0).tv_nsec)) / \
+    ((double) BENCH_ROUNDS * (pages))
+
+
+/*! \fn void *xmalloc(size_t num)
+ *  \brief Wrapper della funzione "malloc"
+ */
+void *
+xmalloc(size_t num)
+{
+    void *p = (void *) malloc(num);
+    if (!p) {
+        printf("Memory exhausted");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+
+/*! \fn void dump_page(uint64_t page, page_t *pte, void *arg)
+ *  \brief Conta le pagine presenti, come farebbe process_info
+ */
+static void
+dump_page(uint64_t page, page_t *pte, void *arg)
+{
+    if (IS_PAGE_PRESENT(*pte))
+        (*(uint64_t *) arg)++;
+}
+
+
+int
+main(int argc, char **argv)
+{
+    struct page_table pt;
+    struct timespec t0, t1;
+    unsigned bits = argc > 1 ? atoi(argv[1]) : 22;
+    uint64_t page, pages = 1ULL << bits, present = 0, count = 0;
+    double clear_ns, count_ns, dump_ns;
+    page_t *pte;
+    int i;
+
+    if (pt_init(&pt, bits, pt_default_levels(bits)) == -1) {
+        fprintf(stderr, "Numero di bit non valido: %u\n", bits);
+        return EXIT_FAILURE;
+    }
+
+    /*
+     *  Popolo la tabella: meta' delle pagine residenti, un quarto delle quali
+     *  "sporche".
+     */
+    srandom(1);
+    for (page = 0; page < pages; page++) {
+        pte = pt_walk(&pt, page, 1, NULL);
+        if (random() & 1) {
+            PAGE_SET_PRESENT(*pte);
+            PAGE_SET_FRAMEID(*pte, page);
+            if (!(random() & 3))
+                PAGE_SET_DIRTY(*pte);
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (i = 0; i < BENCH_ROUNDS; i++)
+        pt_clear_referenced(&pt);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    clear_ns = NSEC_PER_PAGE(t0, t1, pages);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (i = 0; i < BENCH_ROUNDS; i++)
+        count += pt_count(&pt, PAGE_PRESENT, PAGE_REFERENCED | PAGE_DIRTY);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    count_ns = NSEC_PER_PAGE(t0, t1, pages);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (i = 0; i < BENCH_ROUNDS; i++)
+        pt_foreach(&pt, dump_page, &present);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    dump_ns = NSEC_PER_PAGE(t0, t1, pages);
+
+#ifdef PT_BITMAP
+    printf("bitmap  ");
+#else
+    printf("voci    ");
+#endif /* PT_BITMAP */
+    printf("pagine=%" PRIu64 " memoria=%" PRIu64 "Kb azzera-R=%.3f ns "
+           "pulite-non-ref=%.3f ns dump=%.3f ns (%" PRIu64 "/%" PRIu64 ")\n",
+           pages, pt.bytes / 1024, clear_ns, count_ns, dump_ns,
+           count / BENCH_ROUNDS, present / BENCH_ROUNDS);
+    pt_destroy(&pt);
+    return EXIT_SUCCESS;
+}
@@ -11,22 +11,75 @@
  */
 
 #include "random.h"
-#include <stdlib.h>
-#include <limits.h>
 
-/*! \fn int bounded_rand(int min, int max)
+/*! \var uint64_t random_seed
+ *  \brief Seme dal quale vengono derivati i flussi di tutti i thread
+ *  \details Impostato da main con il parametro "--seed" o, in sua assenza,
+ *  con l'ora corrente.
+ */
+uint64_t random_seed;
+
+
+/*! \fn uint64_t splitmix64(uint64_t *x)
+ *  \brief Generatore ausiliario usato per inizializzare lo stato xoshiro
+ */
+static uint64_t
+splitmix64(uint64_t *x)
+{
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+
+/*! \fn void rng_init(struct rng *r, uint64_t stream)
+ *  \brief Inizializza il generatore di un thread
+ *  \details Lo stato viene derivato da random_seed e dall'identificativo
+ *  del flusso: a parita' di seme ogni thread ripete la stessa sequenza,
+ *  indipendentemente dall'ordine in cui i thread vengono eseguiti.
+ *  \param r            Generatore da inizializzare
+ *  \param stream       Identificativo del flusso (RNG_STREAM_IO,
+ *                      RNG_STREAM_PROC)
+ */
+void rng_init(struct rng *r, uint64_t stream)
+{
+    uint64_t x = random_seed ^ splitmix64(&stream);
+    int i;
+
+    for (i = 0; i < 4; i++)
+        r->s[i] = splitmix64(&x);
+}
+
+
+/*! \fn int bounded_rand(struct rng *r, int min, int max)
  *  \brief La funzione restituisce un numero intero casuale nell'intervallo
- *         compreso tra i due parametri.
- *         L'uso di questa funzione prevede che il generatore di numeri pseudo
- *         casuali sia stato gia' inizializzato.
+ *         compreso tra i due parametri, con distribuzione uniforme.
+ *  \param r            Generatore del thread chiamante
+ *  \param min          Estremo sinistro dell'intervallo chiuso
+ *  \param max          Estremo destro dell'intervallo chiuso
+ *  \return             Restituisce un numero casuale
+ */
+int bounded_rand(struct rng *r, int min, int max)
+{
+    if (max < min)
+        return min;
+    return min + (int) rng_bounded(r, (uint64_t) ((int64_t) max - min + 1));
+}
+
+
+/*! \fn uint64_t bounded_rand64(struct rng *r, uint64_t min, uint64_t max)
+ *  \brief La funzione restituisce un numero intero casuale a 64 bit 
+ *         nell'intervallo compreso tra i due parametri.
+ *         Viene usata per gli indirizzi virtuali, che possono superare 
+ *         l'intervallo di un int.
+ *  \param r            Generatore del thread chiamante
  *  \param min          Estremo sinistro dell'intervallo chiuso
  *  \param max          Estremo destro dell'intervallo chiuso
  *  \return             Restituisce un numero casuale
  */
-int bounded_rand(int min, int max)
+uint64_t bounded_rand64(struct rng *r, uint64_t min, uint64_t max)
 {
-    int range = max - min < 0 ? max - min - 1 : max - min + 1;
-    int value = (int) (range * ((float) random() / (float) LONG_MAX));
-	
-    return value == range ? min : min + value;
+    return min + rng_bounded(r, max - min + 1);
 }
@@ -13,6 +13,78 @@
 #ifndef __RANDOM_H__
 #define __RANDOM_H__
 
-int bounded_rand(int, int);
+#include <stdint.h>
 
-#endif /* __RANDOM_H__ */
\ No newline at end of file
+/*! \def RNG_STREAM_IO
+ *  \brief Flusso del generatore riservato al dispositivo di I/O
+ *  \def RNG_STREAM_PROC(n)
+ *  \brief Flusso del generatore del processo "n"
+ */
+#define RNG_STREAM_IO           0
+#define RNG_STREAM_PROC(n)      ((uint64_t) (n) + 1)
+
+/*! \struct rng
+ *  \brief Stato di un generatore xoshiro256**
+ *  \details Ogni thread possiede il proprio generatore: nessuno stato e'
+ *  condiviso, pertanto le estrazioni non richiedono sincronizzazione.
+ */
+struct rng {
+    uint64_t s[4];
+};
+
+/*! \var uint64_t random_seed
+ *  \brief Seme dal quale vengono derivati i flussi di tutti i thread
+ */
+extern uint64_t random_seed;
+
+/*! \fn uint64_t rng_next(struct rng *r)
+ *  \brief Restituisce il prossimo numero casuale a 64 bit
+ */
+static inline uint64_t
+rng_next(struct rng *r)
+{
+    uint64_t *s = r->s, x = s[1] * 5, t = s[1] << 17;
+
+    x = ((x << 7) | (x >> 57)) * 9;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 45) | (s[3] >> 19);
+    return x;
+}
+
+/*! \fn uint64_t rng_bounded(struct rng *r, uint64_t range)
+ *  \brief Restituisce un numero casuale uniforme nell'intervallo [0, range)
+ *  \details Metodo di Lemire: il prodotto a 128 bit con "range" fornisce il
+ *  risultato nella parte alta; la divisione, necessaria per scartare i
+ *  valori che introdurrebbero una distorsione, viene calcolata soltanto
+ *  quando la parte bassa cade nella zona a rischio. Un intervallo nullo
+ *  indica tutti i 2^64 valori.
+ */
+static inline uint64_t
+rng_bounded(struct rng *r, uint64_t range)
+{
+    __uint128_t m;
+    uint64_t l, t;
+
+    if (!range)
+        return rng_next(r);
+    m = (__uint128_t) rng_next(r) * range;
+    l = (uint64_t) m;
+    if (l < range) {
+        for (t = -range % range; l < t; l = (uint64_t) m)
+            m = (__uint128_t) rng_next(r) * range;
+    }
+    return (uint64_t) (m >> 64);
+}
+
+/*
+ *  Prototipi di funzioni pubbliche
+ */
+void rng_init(struct rng *, uint64_t);
+int bounded_rand(struct rng *, int, int);
+uint64_t bounded_rand64(struct rng *, uint64_t, uint64_t);
+
+#endif /* __RANDOM_H__ */
@@ -0,0 +1,89 @@
+/*! \file ring.c
+ */
+
+#include "ring.h"
+#include <sched.h>
+
+/*! \def RING_SPIN
+ *  \brief Numero di tentativi prima di sospendere il processo
+ *  \details Una risposta della MMU arriva, di norma, in pochi microsecondi:
+ *  prima di sospendersi sulla condizione il processo cede piu' volte la CPU.
+ */
+#define RING_SPIN               64
+
+
+/*! \addtogroup RING
+ * @{
+ *  \fn void ring_init(struct mmu_ring *r)
+ *  \brief Inizializza la coppia di code di un processo
+ *  \param r             Code da inizializzare
+ */
+void ring_init(struct mmu_ring *r)
+{
+    r->req_head = r->req_tail = 0;
+    r->resp_head = r->resp_tail = 0;
+    r->waiting = 0;
+    pthread_mutex_init(&r->lock, NULL);
+    pthread_cond_init(&r->cond, NULL);
+}
+
+
+/*! \fn void ring_destroy(struct mmu_ring *r)
+ *  \brief Rilascia le risorse associate alle code
+ *  \param r             Code da distruggere
+ */
+void ring_destroy(struct mmu_ring *r)
+{
+    pthread_mutex_destroy(&r->lock);
+    pthread_cond_destroy(&r->cond);
+}
+
+
+/*! \fn void ring_wait_response(struct mmu_ring *r, uint32_t count)
+ *  \brief Attende che la MMU abbia prodotto almeno "count" risposte
+ *  \details Il processo dapprima cede la CPU per un numero limitato di volte;
+ *  se le risposte non sono ancora disponibili, dichiara la propria attesa
+ *  (campo "waiting") e si sospende sulla condizione. La MMU, dopo aver
+ *  pubblicato le risposte, controlla "waiting" e risveglia il processo
+ *  tramite ring_wake().
+ *  \param r             Code del processo chiamante
+ *  \param count         Numero di risposte attese
+ *  \sa ring_wake
+ */
+void ring_wait_response(struct mmu_ring *r, uint32_t count)
+{
+    int i;
+
+    for (i = 0; i < RING_SPIN; i++) {
+        if (RING_LOAD(r->resp_tail) - r->resp_head >= count)
+            return;
+        sched_yield();
+    }
+
+    pthread_mutex_lock(&r->lock);
+    __atomic_store_n(&r->waiting, 1, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&r->resp_tail, __ATOMIC_SEQ_CST) - r->resp_head < count)
+        pthread_cond_wait(&r->cond, &r->lock);
+    __atomic_store_n(&r->waiting, 0, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&r->lock);
+}
+
+
+/*! \fn void ring_wake(struct mmu_ring *r)
+ *  \brief Risveglia il processo se sospeso in attesa di risposte
+ *  \details Deve essere invocata dalla MMU dopo aver aggiornato "resp_tail":
+ *  la barriera garantisce che il processo veda le nuove risposte oppure che
+ *  la MMU veda il processo in attesa.
+ *  \param r             Code del processo da risvegliare
+ */
+void ring_wake(struct mmu_ring *r)
+{
+    RING_FENCE();
+    if (__atomic_load_n(&r->waiting, __ATOMIC_SEQ_CST)) {
+        pthread_mutex_lock(&r->lock);
+        pthread_cond_signal(&r->cond);
+        pthread_mutex_unlock(&r->lock);
+    }
+}
+
+/*! @} */
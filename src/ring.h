@@ -0,0 +1,100 @@
+/*! \file ring.h
+ *  \defgroup RING Code richiesta/risposta processo-MMU
+ */
+
+#ifndef __RING_H__
+#define __RING_H__
+
+#include <pthread.h>
+#include "vm_types.h"
+
+/*! \def MMU_RING_SIZE
+ *  \brief Numero di elementi di ogni coda circolare (potenza di due)
+ */
+#define MMU_RING_SIZE           64
+
+/*! \def MMU_RING_MASK
+ *  \brief Maschera per ottenere la posizione all'interno della coda
+ */
+#define MMU_RING_MASK           (MMU_RING_SIZE - 1)
+
+/*! \def RING_LOAD(v)
+ *  \brief Lettura di un indice con semantica "acquire"
+ *  \def RING_STORE(v, n)
+ *  \brief Scrittura di un indice con semantica "release"
+ *  \def RING_FENCE()
+ *  \brief Barriera completa, usata dal protocollo di risveglio
+ */
+#define RING_LOAD(v)            __atomic_load_n(&(v), __ATOMIC_ACQUIRE)
+#define RING_STORE(v, n)        __atomic_store_n(&(v), (n), __ATOMIC_RELEASE)
+#define RING_FENCE()            __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+/*! \def RING_PAD(n)
+ *  \brief Riempimento per separare gli indici su linee di cache distinte,
+ *  evitando che processo e MMU si contendano la stessa linea.
+ */
+#define RING_PAD(n)             char __pad##n[60]
+
+/*! \struct mmu_request
+ *  \brief Richiesta di traduzione inviata da un processo alla MMU
+ */
+struct mmu_request {
+    /*! indirizzo virtuale generato dal processo */
+    uint64_t virtual_address;
+    /*! tipo di operazione: vale zero se e' lettura, uno se scrittura */
+    int rw;
+};
+
+/*! \struct mmu_response
+ *  \brief Risposta della MMU ad una richiesta di traduzione
+ */
+struct mmu_response {
+    /*! indirizzo fisico tradotto dalla MMU */
+    uint64_t translated_address;
+    /*! vale uno (1) in caso di page hit, zero (0) per un page fault */
+    int hit;
+};
+
+/*! \struct mmu_ring
+ *  \brief Coppia di code circolari richiesta/risposta di un processo
+ *  \details Ogni processo possiede una propria coppia di code "single
+ *  producer, single consumer": il processo inserisce le richieste e legge le
+ *  risposte, il thread MMU fa l'opposto. Gli indici crescono in modo
+ *  monotono e vengono ridotti con MMU_RING_MASK; nessun lock viene usato sul
+ *  percorso principale. Il mutex e la condizione servono unicamente a
+ *  sospendere il processo quando la risposta tarda ad arrivare.
+ */
+struct mmu_ring {
+    /*! richieste in attesa di essere servite dalla MMU */
+    struct mmu_request req[MMU_RING_SIZE];
+    /*! risposte prodotte dalla MMU */
+    struct mmu_response resp[MMU_RING_SIZE];
+    /*! prossima richiesta da servire (scritto dalla MMU) */
+    uint32_t req_head;
+    RING_PAD(0);
+    /*! prossima posizione libera per una richiesta (scritto dal processo) */
+    uint32_t req_tail;
+    RING_PAD(1);
+    /*! prossima risposta da leggere (scritto dal processo) */
+    uint32_t resp_head;
+    RING_PAD(2);
+    /*! prossima posizione libera per una risposta (scritto dalla MMU) */
+    uint32_t resp_tail;
+    RING_PAD(3);
+    /*! vale uno (1) se il processo e' sospeso in attesa di una risposta */
+    int waiting;
+    /*! mutex per la condizione d'attesa */
+    pthread_mutex_t lock;
+    /*! condizione d'attesa del processo */
+    pthread_cond_t cond;
+};
+
+/*
+ *  Prototipi di funzioni pubbliche
+ */
+void ring_init(struct mmu_ring *);
+void ring_destroy(struct mmu_ring *);
+void ring_wait_response(struct mmu_ring *, uint32_t);
+void ring_wake(struct mmu_ring *);
+
+#endif              /* __RING_H__ */
@@ -0,0 +1,282 @@
+/*! \file stackdist.c
+ */
+
+#include "stackdist.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+/*! \def SD_EMPTY_KEY
+ *  \brief Chiave di una posizione libera della tabella hash
+ *  \def SD_NO_OWNER
+ *  \brief Posizione dell'albero non occupata da alcuna pagina
+ */
+#define SD_EMPTY_KEY            ((uint64_t) -1)
+#define SD_NO_OWNER             ((uint32_t) -1)
+
+/*! \def SD_HASH(key, size)
+ *  \brief Posizione iniziale di una pagina nella tabella hash
+ */
+#define SD_HASH(key, size)      ((uint32_t) (((key) * 0x9e3779b97f4a7c15ULL) >> 32) & ((size) - 1))
+
+
+/*! \fn uint32_t tree_prefix(struct stackdist *sd, uint32_t pos)
+ *  \brief Numero di posizioni occupate in [1, pos]
+ */
+static inline uint32_t
+tree_prefix(struct stackdist *sd, uint32_t pos)
+{
+    uint32_t sum = 0;
+
+    for (; pos; pos &= pos - 1)
+        sum += sd->tree[pos];
+    return sum;
+}
+
+
+/*! \fn void tree_add(struct stackdist *sd, uint32_t pos, int32_t delta)
+ *  \brief Somma "delta" alla posizione "pos"
+ */
+static inline void
+tree_add(struct stackdist *sd, uint32_t pos, int32_t delta)
+{
+    for (; pos <= sd->times; pos += pos & -pos)
+        sd->tree[pos] += delta;
+}
+
+
+/*! \fn void compact(struct stackdist *sd)
+ *  \brief Rinumera le posizioni occupate dell'albero, nel loro ordine
+ *  \details Le posizioni libere vengono eliminate e l'albero ricostruito in
+ *  tempo lineare; se le pagine occupano piu' di meta' delle posizioni,
+ *  l'albero viene raddoppiato.
+ */
+static void
+compact(struct stackdist *sd)
+{
+    uint32_t *owner, pos, n, j;
+
+    if ((uint64_t) sd->distinct * 2 > sd->times)
+        sd->times *= 2;
+    owner = XMALLOC(uint32_t, sd->times + 1);
+    for (n = 0, pos = 1; pos < sd->now; pos++) {
+        if (sd->owner[pos] == SD_NO_OWNER)
+            continue;
+        owner[++n] = sd->owner[pos];
+        sd->last[owner[n]] = n;
+    }
+    for (pos = n + 1; pos <= sd->times; pos++)
+        owner[pos] = SD_NO_OWNER;
+    XFREE(sd->owner);
+    sd->owner = owner;
+
+    XFREE(sd->tree);
+    sd->tree = XMALLOC(uint32_t, sd->times + 1);
+    for (pos = 1; pos <= sd->times; pos++)
+        sd->tree[pos] = pos <= n;
+    for (pos = 1; pos <= sd->times; pos++)
+        if ((j = pos + (pos & -pos)) <= sd->times)
+            sd->tree[j] += sd->tree[pos];
+    sd->now = n + 1;
+}
+
+
+/*! \fn void grow_table(struct stackdist *sd)
+ *  \brief Raddoppia la tabella hash delle pagine
+ *  \details Le pagine cambiano posizione nella tabella: il proprietario di
+ *  ogni posizione dell'albero viene aggiornato di conseguenza.
+ */
+static void
+grow_table(struct stackdist *sd)
+{
+    uint64_t *keys = sd->keys;
+    uint32_t *last = sd->last, size = sd->size, i, j;
+
+    sd->size *= 2;
+    sd->keys = XMALLOC(uint64_t, sd->size);
+    sd->last = XMALLOC(uint32_t, sd->size);
+    for (j = 0; j < sd->size; j++)
+        sd->keys[j] = SD_EMPTY_KEY;
+    for (i = 0; i < size; i++) {
+        if (keys[i] == SD_EMPTY_KEY)
+            continue;
+        for (j = SD_HASH(keys[i], sd->size); sd->keys[j] != SD_EMPTY_KEY;
+             j = (j + 1) & (sd->size - 1))
+            ;
+        sd->keys[j] = keys[i];
+        sd->last[j] = last[i];
+        sd->owner[last[i]] = j;
+    }
+    XFREE(keys);
+    XFREE(last);
+}
+
+
+/*! \addtogroup STACKDIST
+ * @{
+ *  \fn void stackdist_init(struct stackdist *sd, uint32_t max_frames)
+ *  \brief Inizializza l'analisi
+ *  \param sd            Analisi da inizializzare
+ *  \param max_frames    Numero massimo di frame per i quali calcolare i fault
+ */
+void stackdist_init(struct stackdist *sd, uint32_t max_frames)
+{
+    uint32_t i;
+
+    memset(sd, 0, sizeof(*sd));
+    sd->max_frames = max_frames;
+    sd->hits = XMALLOC(uint64_t, max_frames + 1);
+    memset(sd->hits, 0, (max_frames + 1) * sizeof(uint64_t));
+
+    sd->times = STACKDIST_MIN_TIMES;
+    sd->now = 1;
+    sd->tree = XMALLOC(uint32_t, sd->times + 1);
+    sd->owner = XMALLOC(uint32_t, sd->times + 1);
+    memset(sd->tree, 0, (sd->times + 1) * sizeof(uint32_t));
+    for (i = 0; i <= sd->times; i++)
+        sd->owner[i] = SD_NO_OWNER;
+
+    sd->size = 1024;
+    sd->keys = XMALLOC(uint64_t, sd->size);
+    sd->last = XMALLOC(uint32_t, sd->size);
+    for (i = 0; i < sd->size; i++)
+        sd->keys[i] = SD_EMPTY_KEY;
+}
+
+
+/*! \fn void stackdist_access(struct stackdist *sd, uint64_t page)
+ *  \brief Registra un accesso alla pagina "page"
+ *  \details Le pagine di processi diversi devono avere identificativi
+ *  diversi. Il primo accesso ad una pagina ha distanza infinita ed e' un
+ *  fault per ogni numero di frame.
+ */
+void stackdist_access(struct stackdist *sd, uint64_t page)
+{
+    uint32_t slot, pos, d;
+
+    sd->accesses++;
+    for (slot = SD_HASH(page, sd->size); sd->keys[slot] != SD_EMPTY_KEY;
+         slot = (slot + 1) & (sd->size - 1))
+        if (sd->keys[slot] == page)
+            break;
+
+    if (sd->keys[slot] == page) {
+        /*
+         *  Le pagine accedute dopo l'ultimo accesso a "page" occupano le
+         *  posizioni successive alla sua.
+         */
+        pos = sd->last[slot];
+        d = sd->distinct - tree_prefix(sd, pos);
+        if (d < sd->max_frames)
+            sd->hits[d + 1]++;
+        tree_add(sd, pos, -1);
+        sd->owner[pos] = SD_NO_OWNER;
+    } else {
+        if (2 * (sd->distinct + 1) > sd->size) {
+            grow_table(sd);
+            for (slot = SD_HASH(page, sd->size); sd->keys[slot] != SD_EMPTY_KEY;
+                 slot = (slot + 1) & (sd->size - 1))
+                ;
+        }
+        sd->keys[slot] = page;
+        sd->distinct++;
+    }
+
+    if (sd->now > sd->times)
+        compact(sd);
+    pos = sd->now++;
+    tree_add(sd, pos, 1);
+    sd->owner[pos] = slot;
+    sd->last[slot] = pos;
+}
+
+
+/*! \fn uint64_t stackdist_faults(struct stackdist *sd, uint32_t frames)
+ *  \brief Restituisce i fault della politica LRU con "frames" frame
+ */
+uint64_t stackdist_faults(struct stackdist *sd, uint32_t frames)
+{
+    uint64_t hits = 0;
+    uint32_t i;
+
+    if (frames > sd->max_frames)
+        frames = sd->max_frames;
+    for (i = 1; i <= frames; i++)
+        hits += sd->hits[i];
+    return sd->accesses - hits;
+}
+
+
+/*! \fn void stackdist_trace(struct stackdist *sd, struct trace *t, uint32_t procs, unsigned page_bits, unsigned offset_bits)
+ *  \brief Analizza gli accessi di una traccia
+ *  \details I record vengono esaminati nell'ordine della traccia ed
+ *  attribuiti ai processi simulati come nella riproduzione: il processo
+ *  occupa i bit dell'identificativo di pagina successivi a "page_bits".
+ *  \param sd            Analisi
+ *  \param t             Traccia (eventualmente ridotta a una finestra)
+ *  \param procs         Numero di processi simulati
+ *  \param page_bits     Bit del numero di pagina (mmu.page_bits)
+ *  \param offset_bits   Bit di offset (mmu.offset_bits)
+ */
+void stackdist_trace(struct stackdist *sd, struct trace *t, uint32_t procs,
+                     unsigned page_bits, unsigned offset_bits)
+{
+    const struct trace_record *rec;
+    struct trace_cursor cursor;
+    uint64_t mask = (1ULL << page_bits) - 1, n;
+
+    trace_cursor_init(t, &cursor, 0, 1);
+    for (n = 0; n < t->count && (rec = trace_next(&cursor)) != NULL; n++)
+        stackdist_access(sd, (uint64_t) (rec->pid % procs) << page_bits |
+                         ((rec->address >> offset_bits) & mask));
+    trace_cursor_destroy(&cursor);
+}
+
+
+/*! \fn int stackdist_write(struct stackdist *sd, const char *path)
+ *  \brief Scrive i fault per ogni numero di frame, da 1 a max_frames
+ *  \details Ogni riga contiene numero di frame, fault e percentuale di
+ *  fault sugli accessi.
+ *  \param sd            Analisi
+ *  \param path          Percorso del file, "-" per lo standard output
+ *  \return              0 in caso di successo, -1 (dopo aver stampato il
+ *                       motivo su stderr) altrimenti
+ */
+int stackdist_write(struct stackdist *sd, const char *path)
+{
+    FILE *out = strcmp(path, "-") ? fopen(path, "w") : stdout;
+    uint64_t faults = sd->accesses;
+    uint32_t i;
+
+    if (!out) {
+        fprintf(stderr, "Impossibile creare %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    fprintf(out, "# frame fault fault%%\n");
+    for (i = 1; i <= sd->max_frames; i++) {
+        faults -= sd->hits[i];
+        fprintf(out, "%u %" PRIu64 " %.4f\n", i, faults,
+                sd->accesses ? 100.0 * faults / sd->accesses : 0);
+    }
+    if (out != stdout && fclose(out)) {
+        fprintf(stderr, "Errore di scrittura su %s: %s\n", path,
+                strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+
+/*! \fn void stackdist_destroy(struct stackdist *sd)
+ *  \brief Dealloca le strutture dell'analisi
+ */
+void stackdist_destroy(struct stackdist *sd)
+{
+    XFREE(sd->tree);
+    XFREE(sd->owner);
+    XFREE(sd->keys);
+    XFREE(sd->last);
+    XFREE(sd->hits);
+}
+
+/*! @} */
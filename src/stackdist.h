@@ -0,0 +1,66 @@
+/*! \file stackdist.h
+ *  \defgroup STACKDIST Analisi delle distanze di stack (LRU)
+ */
+
+#ifndef __STACKDIST_H__
+#define __STACKDIST_H__
+
+#include "vm_types.h"
+#include "trace.h"
+
+/*! \def STACKDIST_MIN_TIMES
+ *  \brief Dimensione minima dell'albero di Fenwick
+ */
+#define STACKDIST_MIN_TIMES     (1 << 16)
+
+/*! \struct stackdist
+ *  \brief Stato dell'analisi delle distanze di stack
+ *  \details La distanza di stack di un accesso e' il numero di pagine
+ *  distinte referenziate dopo il precedente accesso alla stessa pagina: con
+ *  la politica LRU l'accesso e' un hit se e solo se i frame sono piu' della
+ *  sua distanza. L'istogramma delle distanze fornisce quindi, in un'unica
+ *  passata, i fault per ogni numero di frame.\n
+ *  Ogni pagina e' rappresentata dalla posizione del suo ultimo accesso in
+ *  un albero di Fenwick: la distanza e' il numero di posizioni occupate
+ *  successive a quella della pagina, ottenuto in O(log n). Quando l'albero e'
+ *  pieno le posizioni vengono compattate, cosi' che la memoria dipenda dalle
+ *  pagine distinte e non dalla lunghezza della traccia.
+ */
+struct stackdist {
+    /*! albero di Fenwick: vale uno la posizione dell'ultimo accesso di ogni
+     pagina */
+    uint32_t *tree;
+    /*! pagina (posizione nella tabella hash) di ogni posizione occupata */
+    uint32_t *owner;
+    /*! numero di posizioni dell'albero, potenza di due */
+    uint32_t times;
+    /*! prossima posizione libera */
+    uint32_t now;
+    /*! tabella hash (indirizzamento aperto): pagina */
+    uint64_t *keys;
+    /*! tabella hash: posizione dell'ultimo accesso */
+    uint32_t *last;
+    /*! numero di posizioni della tabella hash, potenza di due */
+    uint32_t size;
+    /*! numero di pagine distinte */
+    uint32_t distinct;
+    /*! hits[d] = accessi con distanza d - 1, per d da 1 a max_frames */
+    uint64_t *hits;
+    /*! numero massimo di frame analizzati */
+    uint32_t max_frames;
+    /*! numero di accessi */
+    uint64_t accesses;
+};
+
+/*
+ *  Prototipi di funzioni pubbliche
+ */
+void stackdist_init(struct stackdist *, uint32_t);
+void stackdist_access(struct stackdist *, uint64_t);
+uint64_t stackdist_faults(struct stackdist *, uint32_t);
+void stackdist_trace(struct stackdist *, struct trace *, uint32_t, unsigned,
+                     unsigned);
+int stackdist_write(struct stackdist *, const char *);
+void stackdist_destroy(struct stackdist *);
+
+#endif              /* __STACKDIST_H__ */
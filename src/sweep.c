@@ -0,0 +1,380 @@
+/*! \file sweep.c
+ */
+
+#include "sweep.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+/*! \def SWEEP_MAX_SPEC
+ *  \brief Lunghezza massima della descrizione di un'esplorazione
+ */
+#define SWEEP_MAX_SPEC          256
+
+/*! \def SWEEP_MAX_CONFIGS
+ *  \brief Numero massimo di configurazioni di un'esplorazione
+ */
+#define SWEEP_MAX_CONFIGS       65536
+
+/*! \struct sweep_job
+ *  \brief Processo figlio in esecuzione
+ */
+struct sweep_job {
+    /*! pid del processo, 0 se la posizione e' libera */
+    pid_t pid;
+    /*! lato in lettura della pipe del risultato */
+    int fd;
+    /*! configurazione eseguita */
+    uint64_t index;
+};
+
+/*! \var const char *param_names[]
+ *  \brief Nomi dei parametri, nell'ordine di sweep_param
+ */
+static const char *param_names[] = { "ram", "frame", "procs", "locality", NULL };
+
+/*! \var int report_fd
+ *  \brief Pipe sulla quale il processo figlio scrive il risultato
+ */
+static int report_fd = -1;
+
+/*! \var uint64_t report_value
+ *  \brief Valori dei parametri della configurazione del processo figlio
+ */
+static uint64_t report_value[SWEEP_PARAMS];
+
+
+/*! \fn uint64_t next_value(struct sweep_range *r, uint64_t v)
+ *  \brief Restituisce il valore successivo a "v" nell'intervallo
+ */
+static uint64_t
+next_value(struct sweep_range *r, uint64_t v)
+{
+    return r->geometric ? v * r->step : v + r->step;
+}
+
+
+/*! \fn int parse_range(struct sweep_range *r, char *s, int geometric)
+ *  \brief Interpreta un intervallo "MIN[:MAX[:PASSO]]"
+ *  \details Il passo e' geometrico se preceduto da '*', aritmetico se
+ *  preceduto da '+' o privo di prefisso; se omesso vale *2 o +1 a seconda
+ *  di "geometric".
+ *  \return              0 in caso di successo, -1 se l'intervallo non e'
+ *                       valido
+ */
+static int
+parse_range(struct sweep_range *r, char *s, int geometric)
+{
+    char *end;
+
+    r->min = r->max = strtoull(s, &end, 10);
+    r->geometric = geometric;
+    r->step = geometric ? 2 : 1;
+    if (end == s)
+        return -1;
+    if (*end == ':')
+        r->max = strtoull(s = end + 1, &end, 10);
+    if (*end == ':') {
+        s = end + 1;
+        if (*s == '*' || *s == '+')
+            r->geometric = *s++ == '*';
+        r->step = strtoull(s, &end, 10);
+    }
+    if (*end != '\0' || r->max < r->min || r->step == 0 ||
+        (r->geometric && (r->step < 2 || r->min == 0)))
+        return -1;
+    return 0;
+}
+
+
+/*! \fn int write_results(struct sweep *sw, struct sweep_result *res, const char *path)
+ *  \brief Scrive i risultati in formato CSV, o JSON se il file ha estensione
+ *  ".json"
+ */
+static int
+write_results(struct sweep *sw, struct sweep_result *res, const char *path)
+{
+    const char *ext = strrchr(path, '.');
+    int json = ext && !strcmp(ext, ".json");
+    FILE *out = strcmp(path, "-") ? fopen(path, "w") : stdout;
+    uint64_t i;
+    int j;
+
+    if (!out) {
+        fprintf(stderr, "Impossibile creare %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    if (json)
+        fprintf(out, "[\n");
+    else {
+        for (j = 0; j < SWEEP_PARAMS; j++)
+            fprintf(out, "%s,", param_names[j]);
+        fprintf(out, "status,accesses,faults,fault_rate,evictions,write_backs,"
+                "tlb_hits,io_requests,io_wait_ms,wall_time\n");
+    }
+    for (i = 0; i < sw->configs; i++, res++) {
+        double rate = res->accesses ? (double) res->faults / res->accesses : 0;
+        double wait = res->io_requests ?
+                      (double) res->io_time / res->io_requests : 0;
+
+        if (json) {
+            fprintf(out, "  {");
+            for (j = 0; j < SWEEP_PARAMS; j++)
+                fprintf(out, "\"%s\": %" PRIu64 ", ", param_names[j],
+                        res->value[j]);
+            fprintf(out, "\"status\": %d, \"accesses\": %" PRIu64 ", "
+                    "\"faults\": %" PRIu64 ", \"fault_rate\": %.6f, "
+                    "\"evictions\": %" PRIu64 ", \"write_backs\": %" PRIu64
+                    ", \"tlb_hits\": %" PRIu64 ", \"io_requests\": %" PRIu64
+                    ", \"io_wait_ms\": %.3f, \"wall_time\": %.6f}%s\n",
+                    res->status, res->accesses, res->faults, rate,
+                    res->evictions, res->write_backs, res->tlb_hits,
+                    res->io_requests, wait, res->wall_time,
+                    i + 1 < sw->configs ? "," : "");
+        } else {
+            for (j = 0; j < SWEEP_PARAMS; j++)
+                fprintf(out, "%" PRIu64 ",", res->value[j]);
+            fprintf(out, "%d,%" PRIu64 ",%" PRIu64 ",%.6f,%" PRIu64 ",%" PRIu64
+                    ",%" PRIu64 ",%" PRIu64 ",%.3f,%.6f\n", res->status,
+                    res->accesses, res->faults, rate, res->evictions,
+                    res->write_backs, res->tlb_hits, res->io_requests, wait,
+                    res->wall_time);
+        }
+    }
+    if (json)
+        fprintf(out, "]\n");
+    if (out != stdout && fclose(out)) {
+        fprintf(stderr, "Errore di scrittura su %s: %s\n", path,
+                strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+
+/*! \addtogroup SWEEP
+ * @{
+ *  \fn int sweep_parse(struct sweep *sw, const char *spec, const uint64_t *defaults)
+ *  \brief Interpreta la descrizione di un'esplorazione
+ *  \details La descrizione contiene, separati da virgole, gli intervalli
+ *  "nome=MIN[:MAX[:PASSO]]" dei parametri ram, frame, procs e locality; i
+ *  parametri non indicati assumono il valore di default. Il passo di RAM e
+ *  pagina e' per default geometrico (*2), quello degli altri parametri
+ *  aritmetico (+1).
+ *  \param sw            Esplorazione da inizializzare
+ *  \param spec          Descrizione (parametro "--sweep")
+ *  \param defaults      Valori dei parametri non indicati (sweep_param)
+ *  \return              0 in caso di successo, -1 (dopo aver stampato il
+ *                       motivo su stderr) altrimenti
+ */
+int sweep_parse(struct sweep *sw, const char *spec, const uint64_t *defaults)
+{
+    char buf[SWEEP_MAX_SPEC], *item, *value, *save;
+    uint64_t v;
+    int i;
+
+    memset(sw, 0, sizeof(*sw));
+    for (i = 0; i < SWEEP_PARAMS; i++) {
+        sw->range[i].min = sw->range[i].max = defaults[i];
+        sw->range[i].step = 1;
+    }
+    if (strlen(spec) >= sizeof(buf)) {
+        fprintf(stderr, "Descrizione dell'esplorazione troppo lunga.\n");
+        return -1;
+    }
+    strcpy(buf, spec);
+
+    for (item = strtok_r(buf, ",", &save); item;
+         item = strtok_r(NULL, ",", &save)) {
+        if ((value = strchr(item, '=')) != NULL)
+            *value++ = '\0';
+        for (i = 0; param_names[i]; i++)
+            if (!strcmp(item, param_names[i]))
+                break;
+        if (!value || !param_names[i] ||
+            parse_range(&sw->range[i], value, i <= SWEEP_FRAME) == -1 ||
+            (i == SWEEP_LOCALITY ? sw->range[i].max > 100 :
+             sw->range[i].min == 0)) {
+            fprintf(stderr, "Intervallo non valido nell'esplorazione: %s%s%s "
+                    "(ram|frame|procs|locality=MIN[:MAX[:[*+]PASSO]])\n",
+                    item, value ? "=" : "", value ? value : "");
+            return -1;
+        }
+        sw->given |= 1 << i;
+    }
+
+    for (sw->configs = 1, i = 0; i < SWEEP_PARAMS; i++) {
+        for (v = sw->range[i].min; v <= sw->range[i].max &&
+             sw->values[i] <= SWEEP_MAX_CONFIGS; v = next_value(&sw->range[i], v))
+            sw->values[i]++;
+        if ((sw->configs *= sw->values[i]) > SWEEP_MAX_CONFIGS)
+            break;
+    }
+    if (sw->configs > SWEEP_MAX_CONFIGS) {
+        fprintf(stderr, "L'esplorazione comprende troppe configurazioni "
+                "(%" PRIu64 ", massimo %d).\n", sw->configs, SWEEP_MAX_CONFIGS);
+        return -1;
+    }
+    return 0;
+}
+
+
+/*! \fn uint64_t sweep_value(struct sweep *sw, uint64_t index, int param)
+ *  \brief Restituisce il valore di un parametro nella configurazione "index"
+ *  \details Le configurazioni sono numerate variando piu' rapidamente
+ *  l'ultimo parametro di sweep_param.
+ */
+uint64_t sweep_value(struct sweep *sw, uint64_t index, int param)
+{
+    uint64_t v, k;
+    int i;
+
+    for (i = SWEEP_PARAMS - 1; i > param; i--)
+        index /= sw->values[i];
+    k = index % sw->values[param];
+    for (v = sw->range[param].min; k; k--)
+        v = next_value(&sw->range[param], v);
+    return v;
+}
+
+
+/*! \fn int sweep_run(struct sweep *sw, int jobs, const char *path, uint64_t *value)
+ *  \brief Esegue le configurazioni in processi figli concorrenti
+ *  \details Tutto lo stato del simulatore e' globale: ogni configurazione
+ *  viene quindi eseguita da un processo creato con fork, che prosegue
+ *  l'esecuzione di main con i parametri della propria configurazione ed
+ *  invia il risultato al padre tramite sweep_report. Il padre mantiene al
+ *  piu' "jobs" figli in esecuzione e, al termine, scrive una riga per
+ *  configurazione nell'ordine in cui sono numerate.\n
+ *  L'output dei figli viene scartato, ad eccezione dei messaggi d'errore.
+ *  \param sw            Esplorazione
+ *  \param jobs          Numero massimo di figli contemporanei
+ *  \param path          File dei risultati, "-" per lo standard output
+ *  \param value         Nel figlio, valori dei parametri da simulare
+ *  \return              Nel padre 0 in caso di successo, -1 altrimenti; nel
+ *                       figlio 1
+ */
+int sweep_run(struct sweep *sw, int jobs, const char *path, uint64_t *value)
+{
+    struct sweep_result *results, res;
+    struct sweep_job *job;
+    uint64_t next = 0, done = 0;
+    int fds[2], active = 0, i, j, status, ret;
+    pid_t pid;
+
+    results = XMALLOC(struct sweep_result, sw->configs);
+    job = XMALLOC(struct sweep_job, jobs);
+    memset(job, 0, jobs * sizeof(struct sweep_job));
+    fprintf(stdout, "--> Esplorazione di %" PRIu64 " configurazioni con %d "
+            "processi\n", sw->configs, jobs);
+
+    while (done < sw->configs) {
+        /*
+         *  Avvio una nuova configurazione se vi e' una posizione libera.
+         */
+        if (next < sw->configs && active < jobs) {
+            for (i = 0; job[i].pid; i++)
+                ;
+            if (pipe(fds) == -1) {
+                fprintf(stderr, "Impossibile creare la pipe: %s\n",
+                        strerror(errno));
+                break;
+            }
+            fflush(stdout);
+            fflush(stderr);
+            if ((pid = fork()) == -1) {
+                fprintf(stderr, "Impossibile creare il processo: %s\n",
+                        strerror(errno));
+                close(fds[0]);
+                close(fds[1]);
+                break;
+            }
+            if (pid == 0) {
+                int null = open("/dev/null", O_WRONLY);
+
+                for (j = 0; j < jobs; j++)
+                    if (job[j].pid)
+                        close(job[j].fd);
+                close(fds[0]);
+                dup2(null, STDOUT_FILENO);
+                close(null);
+                report_fd = fds[1];
+                for (j = 0; j < SWEEP_PARAMS; j++)
+                    value[j] = report_value[j] = sweep_value(sw, next, j);
+                XFREE(results);
+                XFREE(job);
+                return 1;
+            }
+            close(fds[1]);
+            job[i].pid = pid;
+            job[i].fd = fds[0];
+            job[i].index = next++;
+            active++;
+            continue;
+        }
+
+        /*
+         *  Attendo la terminazione di un figlio e ne leggo il risultato: il
+         *  figlio lo scrive prima di terminare, pertanto e' gia' nella pipe.
+         */
+        if ((pid = waitpid(-1, &status, 0)) == -1) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        for (i = 0; i < jobs && job[i].pid != pid; i++)
+            ;
+        if (i == jobs)
+            continue;
+        if (read(job[i].fd, &res, sizeof(res)) != sizeof(res)) {
+            memset(&res, 0, sizeof(res));
+            res.status = -1;
+        }
+        if (!WIFEXITED(status) || WEXITSTATUS(status))
+            res.status = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+        for (j = 0; j < SWEEP_PARAMS; j++)
+            res.value[j] = sweep_value(sw, job[i].index, j);
+        results[job[i].index] = res;
+        close(job[i].fd);
+        job[i].pid = 0;
+        active--;
+        done++;
+        fprintf(stdout, "    [%" PRIu64 "/%" PRIu64 "] ram=%" PRIu64 " frame=%"
+                PRIu64 " procs=%" PRIu64 " locality=%" PRIu64 ": %s\n", done,
+                sw->configs, res.value[SWEEP_RAM], res.value[SWEEP_FRAME],
+                res.value[SWEEP_PROCS], res.value[SWEEP_LOCALITY],
+                res.status ? "errore" : "completata");
+    }
+
+    /*
+     *  In caso d'errore attendo comunque i figli gia' avviati.
+     */
+    ret = done == sw->configs ? write_results(sw, results, path) : -1;
+    while (active && waitpid(-1, NULL, 0) > 0)
+        active--;
+    XFREE(results);
+    XFREE(job);
+    return ret;
+}
+
+
+/*! \fn void sweep_report(struct sweep_result *res)
+ *  \brief Invia al padre il risultato della configurazione
+ *  \details Non ha effetto al di fuori dei processi figli di sweep_run.
+ */
+void sweep_report(struct sweep_result *res)
+{
+    if (report_fd == -1)
+        return;
+    memcpy(res->value, report_value, sizeof(report_value));
+    if (write(report_fd, res, sizeof(*res)) != sizeof(*res))
+        fprintf(stderr, "Impossibile inviare il risultato: %s\n",
+                strerror(errno));
+    close(report_fd);
+    report_fd = -1;
+}
+
+/*! @} */
@@ -0,0 +1,89 @@
+/*! \file sweep.h
+ *  \defgroup SWEEP Esplorazione parallela dei parametri
+ */
+
+#ifndef __SWEEP_H__
+#define __SWEEP_H__
+
+#include <stdio.h>
+#include <sys/types.h>
+#include "vm_types.h"
+
+/*! \enum sweep_param
+ *  \brief Parametri variabili di un'esplorazione
+ */
+enum sweep_param {
+    /*! dimensione della RAM (-R) */
+    SWEEP_RAM,
+    /*! dimensione della pagina (-s) */
+    SWEEP_FRAME,
+    /*! numero di processi (-p) */
+    SWEEP_PROCS,
+    /*! localita' temporale (-L) */
+    SWEEP_LOCALITY,
+    SWEEP_PARAMS
+};
+
+/*! \struct sweep_range
+ *  \brief Valori assunti da un parametro: da "min" a "max" compresi
+ *  \details Il valore successivo si ottiene moltiplicando per "step" se
+ *  "geometric" vale uno, sommando "step" altrimenti.
+ */
+struct sweep_range {
+    uint64_t min;
+    uint64_t max;
+    uint64_t step;
+    int geometric;
+};
+
+/*! \struct sweep_result
+ *  \brief Risultato di una configurazione
+ *  \details Viene scritto dal processo figlio che ha eseguito la
+ *  configurazione sulla propria pipe, con un'unica write.
+ */
+struct sweep_result {
+    /*! valori dei parametri (sweep_param) */
+    uint64_t value[SWEEP_PARAMS];
+    /*! accessi alla memoria */
+    uint64_t accesses;
+    /*! page fault */
+    uint64_t faults;
+    /*! pagine rimosse */
+    uint64_t evictions;
+    /*! pagine copiate su disco */
+    uint64_t write_backs;
+    /*! traduzioni risolte dai TLB */
+    uint64_t tlb_hits;
+    /*! richieste al dispositivo di I/O */
+    uint64_t io_requests;
+    /*! attesa complessiva delle richieste di I/O, in ms */
+    uint64_t io_time;
+    /*! tempo di esecuzione, in secondi */
+    double wall_time;
+    /*! vale zero (0) se la simulazione e' terminata correttamente */
+    int status;
+};
+
+/*! \struct sweep
+ *  \brief Esplorazione del prodotto cartesiano degli intervalli
+ */
+struct sweep {
+    /*! intervallo di ogni parametro */
+    struct sweep_range range[SWEEP_PARAMS];
+    /*! numero di valori di ogni parametro */
+    uint64_t values[SWEEP_PARAMS];
+    /*! numero di configurazioni */
+    uint64_t configs;
+    /*! parametri indicati nella descrizione (un bit per sweep_param) */
+    unsigned given;
+};
+
+/*
+ *  Prototipi di funzioni pubbliche
+ */
+int sweep_parse(struct sweep *, const char *, const uint64_t *);
+uint64_t sweep_value(struct sweep *, uint64_t, int);
+int sweep_run(struct sweep *, int, const char *, uint64_t *);
+void sweep_report(struct sweep_result *);
+
+#endif              /* __SWEEP_H__ */
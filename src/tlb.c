@@ -0,0 +1,234 @@
+/*! \file tlb.c
+ */
+
+#include "tlb.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*! \def TLB_SET(t, page)
+ *  \brief Restituisce il puntatore alla prima voce dell'insieme della pagina
+ */
+#define TLB_SET(t, page)        (&(t)->entries[((page) % (t)->sets) * (t)->ways])
+
+/*! \def LOAD(v)
+ *  \brief Lettura atomica di un campo di una voce
+ *  \def STORE(v, n)
+ *  \brief Scrittura atomica di un campo di una voce
+ */
+#define LOAD(v)                 __atomic_load_n(&(v), __ATOMIC_RELAXED)
+#define STORE(v, n)             __atomic_store_n(&(v), (n), __ATOMIC_RELAXED)
+
+
+/*! \fn void entry_write(struct tlb_entry *e, int valid, uint64_t page, uint32_t frame_id, page_t *pte, int dirty)
+ *  \brief Aggiorna una voce secondo il protocollo seqlock
+ *  \details Il contatore viene reso dispari prima della modifica e pari al
+ *  termine: un lettore concorrente rileva la variazione e considera la
+ *  ricerca fallita.
+ */
+static void
+entry_write(struct tlb_entry *e, int valid, uint64_t page, uint32_t frame_id,
+            page_t *pte, int dirty)
+{
+    uint32_t seq = e->seq;
+
+    __atomic_store_n(&e->seq, seq + 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    STORE(e->valid, valid);
+    STORE(e->page, page);
+    STORE(e->frame_id, frame_id);
+    STORE(e->pte, pte);
+    STORE(e->dirty, dirty);
+    __atomic_store_n(&e->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+
+/*! \addtogroup TLB
+ * @{
+ *  \fn void tlb_init(struct tlb *t, unsigned entries, unsigned ways, int policy)
+ *  \brief Inizializza il TLB di un processo
+ *  \details Con zero voci il TLB resta disabilitato e tutti gli accessi
+ *  vengono inoltrati alla MMU. Un'associativita' nulla o superiore al numero
+ *  di voci rende il TLB completamente associativo.
+ *  \param t             TLB da inizializzare
+ *  \param entries       Numero complessivo di voci
+ *  \param ways          Numero di voci per insieme
+ *  \param policy        Politica di rimpiazzo
+ */
+void tlb_init(struct tlb *t, unsigned entries, unsigned ways, int policy)
+{
+    memset(t, 0, sizeof(*t));
+    if (entries == 0)
+        return;
+    if (ways == 0 || ways > entries)
+        ways = entries;
+    t->ways = ways;
+    t->sets = entries / ways;
+    t->policy = policy;
+    t->seed = 2463534242U;
+    t->entries = XMALLOC(struct tlb_entry, t->sets * t->ways);
+    memset(t->entries, 0, t->sets * t->ways * sizeof(struct tlb_entry));
+    t->fifo_next = XMALLOC(unsigned, t->sets);
+    memset(t->fifo_next, 0, t->sets * sizeof(unsigned));
+}
+
+
+/*! \fn void tlb_destroy(struct tlb *t)
+ *  \brief Dealloca le voci del TLB
+ */
+void tlb_destroy(struct tlb *t)
+{
+    XFREE(t->entries);
+    XFREE(t->fifo_next);
+}
+
+
+/*! \fn struct tlb_entry *tlb_lookup(struct tlb *t, uint64_t page, int rw, uint32_t *frame_id, page_t **pte, uint32_t *seq)
+ *  \brief Ricerca la traduzione di una pagina nel TLB
+ *  \details Invocata dal processo proprietario. Una scrittura viene risolta
+ *  solo se la voce riporta la pagina come "sporca", altrimenti deve essere la
+ *  MMU ad impostare il bit Dirty.
+ *  \param t             TLB del processo
+ *  \param page          Pagina virtuale da tradurre
+ *  \param rw            Se vale uno (1) l'accesso e' in scrittura
+ *  \param frame_id      Frame associato alla pagina (in caso di hit)
+ *  \param pte           Voce della tabella delle pagine (in caso di hit)
+ *  \param seq           Versione della voce letta, per tlb_still_valid
+ *  \return              La voce trovata, NULL in caso di miss
+ *  \sa tlb_still_valid
+ */
+struct tlb_entry *
+tlb_lookup(struct tlb *t, uint64_t page, int rw, uint32_t *frame_id,
+           page_t **pte, uint32_t *seq)
+{
+    struct tlb_entry *e = TLB_SET(t, page);
+    uint32_t s1, s2, fid;
+    page_t *p;
+    unsigned i;
+    int hit;
+
+    for (i = 0; i < t->ways; i++, e++) {
+        s1 = __atomic_load_n(&e->seq, __ATOMIC_ACQUIRE);
+        if (s1 & 1)
+            continue;
+        hit = LOAD(e->valid) && LOAD(e->page) == page &&
+              (!rw || LOAD(e->dirty));
+        fid = LOAD(e->frame_id);
+        p = LOAD(e->pte);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        s2 = LOAD(e->seq);
+        if (hit && s1 == s2) {
+            if (t->policy == TLB_LRU)
+                STORE(e->stamp, __atomic_add_fetch(&t->clock, 1, __ATOMIC_RELAXED));
+            *frame_id = fid;
+            *pte = p;
+            *seq = s1;
+            return e;
+        }
+    }
+    return NULL;
+}
+
+
+/*! \fn int tlb_still_valid(struct tlb_entry *e, uint32_t seq)
+ *  \brief Verifica che una voce non sia stata modificata dopo la lettura
+ *  \details Il processo imposta il bit Reference della pagina e poi invoca
+ *  questa funzione: se la voce e' ancora valida, l'accesso precede qualunque
+ *  successiva invalidazione da parte della MMU.
+ */
+int tlb_still_valid(struct tlb_entry *e, uint32_t seq)
+{
+    return __atomic_load_n(&e->seq, __ATOMIC_SEQ_CST) == seq;
+}
+
+
+/*! \fn void tlb_fill(struct tlb *t, uint64_t page, uint32_t frame_id, page_t *pte, int dirty)
+ *  \brief Inserisce la traduzione di una pagina nel TLB
+ *  \details Invocata dalla MMU al termine di una traduzione. Se la pagina e'
+ *  gia' presente nell'insieme la voce viene aggiornata; altrimenti viene
+ *  usata una voce libera o, in mancanza, quella scelta dalla politica di
+ *  rimpiazzo.
+ *  \param t             TLB del processo
+ *  \param page          Pagina virtuale tradotta
+ *  \param frame_id      Frame associato alla pagina
+ *  \param pte           Voce della tabella delle pagine
+ *  \param dirty         Vale uno (1) se la pagina e' "sporca"
+ */
+void tlb_fill(struct tlb *t, uint64_t page, uint32_t frame_id, page_t *pte,
+              int dirty)
+{
+    struct tlb_entry *set = TLB_SET(t, page), *victim = NULL;
+    unsigned i;
+
+    for (i = 0; i < t->ways; i++) {
+        if (set[i].valid && set[i].page == page) {
+            victim = &set[i];
+            break;
+        }
+        if (!victim && !set[i].valid)
+            victim = &set[i];
+    }
+
+    if (!victim) {
+        switch (t->policy) {
+            case TLB_FIFO:
+                i = t->fifo_next[(page % t->sets)]++ % t->ways;
+                break;
+            case TLB_RANDOM:
+                t->seed ^= t->seed << 13;
+                t->seed ^= t->seed >> 17;
+                t->seed ^= t->seed << 5;
+                i = t->seed % t->ways;
+                break;
+            default:
+                for (victim = set, i = 1; i < t->ways; i++)
+                    if ((int) (LOAD(set[i].stamp) - LOAD(victim->stamp)) < 0)
+                        victim = &set[i];
+                i = victim - set;
+                break;
+        }
+        victim = &set[i];
+    }
+
+    entry_write(victim, 1, page, frame_id, pte, dirty);
+    STORE(victim->stamp, __atomic_add_fetch(&t->clock, 1, __ATOMIC_RELAXED));
+}
+
+
+/*! \fn void tlb_invalidate(struct tlb *t, uint64_t page)
+ *  \brief Invalida la traduzione di una pagina
+ *  \details Invocata dalla MMU prima di rimuovere una pagina dalla memoria o
+ *  di azzerarne il bit Dirty.
+ *  \param t             TLB del processo proprietario della pagina
+ *  \param page          Pagina virtuale da invalidare
+ */
+void tlb_invalidate(struct tlb *t, uint64_t page)
+{
+    struct tlb_entry *set;
+    unsigned i;
+
+    if (!TLB_ENABLED(t))
+        return;
+    set = TLB_SET(t, page);
+    for (i = 0; i < t->ways; i++)
+        if (set[i].valid && set[i].page == page)
+            entry_write(&set[i], 0, 0, 0, NULL, 0);
+}
+
+
+/*! \fn int tlb_policy_by_name(const char *name)
+ *  \brief Converte il nome di una politica di rimpiazzo nel suo codice
+ *  \param name          "lru", "fifo" oppure "random"
+ *  \return              Codice della politica, -1 se sconosciuta
+ */
+int tlb_policy_by_name(const char *name)
+{
+    if (!strcmp(name, "lru"))
+        return TLB_LRU;
+    if (!strcmp(name, "fifo"))
+        return TLB_FIFO;
+    if (!strcmp(name, "random"))
+        return TLB_RANDOM;
+    return -1;
+}
+
+/*! @} */
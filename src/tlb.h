@@ -0,0 +1,87 @@
+/*! \file tlb.h
+ *  \defgroup TLB Translation Lookaside Buffer
+ */
+
+#ifndef __TLB_H__
+#define __TLB_H__
+
+#include "vm_types.h"
+
+/*! \def TLB_LRU
+ *  \brief Rimpiazzo della voce usata meno di recente
+ *  \def TLB_FIFO
+ *  \brief Rimpiazzo della voce inserita per prima
+ *  \def TLB_RANDOM
+ *  \brief Rimpiazzo di una voce casuale
+ */
+#define TLB_LRU                 0
+#define TLB_FIFO                1
+#define TLB_RANDOM              2
+
+/*! \def TLB_ENABLED(t)
+ *  \brief Restituisce 1 se il TLB e' stato configurato con almeno una voce
+ */
+#define TLB_ENABLED(t)          ((t)->entries != NULL)
+
+/*! \struct tlb_entry
+ *  \brief Voce del TLB
+ *  \details Le voci vengono scritte esclusivamente dal thread MMU e lette dal
+ *  processo proprietario: il campo "seq" funge da seqlock, e' dispari durante
+ *  l'aggiornamento e viene incrementato ad ogni modifica, cosi' che il
+ *  processo possa riconoscere una lettura inconsistente o invalidata.
+ */
+struct tlb_entry {
+    /*! contatore di versione (seqlock) */
+    uint32_t seq;
+    /*! vale uno (1) se la voce contiene una traduzione valida */
+    uint32_t valid;
+    /*! pagina virtuale tradotta */
+    uint64_t page;
+    /*! voce della tabella delle pagine, per impostare il bit Reference senza
+     *  percorrere la tabella */
+    page_t *pte;
+    /*! frame associato alla pagina */
+    uint32_t frame_id;
+    /*! vale uno (1) se la pagina era gia' "sporca": solo in questo caso una
+     *  scrittura puo' essere risolta dal TLB */
+    uint32_t dirty;
+    /*! istante dell'ultimo utilizzo, per il rimpiazzo LRU */
+    uint32_t stamp;
+};
+
+/*! \struct tlb
+ *  \brief TLB software di un processo
+ *  \details Il TLB e' organizzato in "sets" insiemi di "ways" voci ciascuno:
+ *  una pagina puo' risiedere solo nell'insieme (page % sets). Con ways pari
+ *  al numero di voci si ottiene un TLB completamente associativo.
+ */
+struct tlb {
+    /*! vettore di sets*ways voci */
+    struct tlb_entry *entries;
+    /*! numero di insiemi */
+    unsigned sets;
+    /*! numero di voci per insieme (associativita') */
+    unsigned ways;
+    /*! politica di rimpiazzo (TLB_LRU, TLB_FIFO, TLB_RANDOM) */
+    int policy;
+    /*! prossima voce da rimpiazzare per ogni insieme (TLB_FIFO) */
+    unsigned *fifo_next;
+    /*! orologio logico per il rimpiazzo LRU */
+    uint32_t clock;
+    /*! stato del generatore per il rimpiazzo casuale */
+    uint32_t seed;
+};
+
+/*
+ *  Prototipi di funzioni pubbliche
+ */
+void tlb_init(struct tlb *, unsigned, unsigned, int);
+void tlb_destroy(struct tlb *);
+struct tlb_entry *tlb_lookup(struct tlb *, uint64_t, int, uint32_t *,
+                             page_t **, uint32_t *);
+int tlb_still_valid(struct tlb_entry *, uint32_t);
+void tlb_fill(struct tlb *, uint64_t, uint32_t, page_t *, int);
+void tlb_invalidate(struct tlb *, uint64_t);
+int tlb_policy_by_name(const char *);
+
+#endif              /* __TLB_H__ */
@@ -0,0 +1,517 @@
+/*! \file trace.c
+ */
+
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+/*! \fn int open_raw(struct trace *t, const char *path)
+ *  \brief Verifica l'intestazione di una traccia non compressa
+ */
+static int
+open_raw(struct trace *t, const char *path)
+{
+    const struct trace_header *h = t->map;
+    uint64_t records;
+
+    records = (t->size - sizeof(*h)) / sizeof(struct trace_record);
+    if (h->version != TRACE_VERSION ||
+        h->record_size != sizeof(struct trace_record) || h->procs == 0) {
+        fprintf(stderr, "La traccia %s non contiene un'intestazione valida.\n",
+                path);
+        return -1;
+    }
+    if (h->count > records) {
+        fprintf(stderr, "La traccia %s e' troncata: %" PRIu64 " record su %"
+                PRIu64 ".\n", path, records, h->count);
+        return -1;
+    }
+
+    t->records = (const struct trace_record *) (h + 1);
+    t->count = h->count ? h->count : records;
+    t->procs = h->procs;
+    return 0;
+}
+
+
+/*! \fn int open_compressed(struct trace *t, const char *path)
+ *  \brief Verifica l'intestazione e l'indice di una traccia compressa
+ */
+static int
+open_compressed(struct trace *t, const char *path)
+{
+    const struct trace_zheader *h = t->map;
+    uint64_t i;
+
+    if (t->size < sizeof(*h) || h->version != TRACE_VERSION ||
+        h->procs == 0 || h->block_records == 0 ||
+        h->blocks != (h->count + h->block_records - 1) / h->block_records ||
+        h->index_offset < sizeof(*h) || h->index_offset > t->size ||
+        (t->size - h->index_offset) / sizeof(uint64_t) < h->blocks + 1) {
+        fprintf(stderr, "La traccia %s non contiene un'intestazione valida.\n",
+                path);
+        return -1;
+    }
+
+    t->index = (const uint64_t *) ((const char *) t->map + h->index_offset);
+    for (i = 0; i <= h->blocks; i++) {
+        if (t->index[i] < (i ? t->index[i - 1] : sizeof(*h)) ||
+            t->index[i] > h->index_offset) {
+            fprintf(stderr, "L'indice della traccia %s e' danneggiato.\n",
+                    path);
+            return -1;
+        }
+    }
+
+    t->count = h->count;
+    t->procs = h->procs;
+    t->block_records = h->block_records;
+    t->blocks = h->blocks;
+    return 0;
+}
+
+
+/*! \addtogroup TRACE
+ * @{
+ *  \fn int trace_open(struct trace *t, const char *path)
+ *  \brief Mappa in memoria un file di traccia e ne verifica l'intestazione
+ *  \details Il file viene mappato con MAP_PRIVATE in sola lettura e
+ *  segnalato al kernel come letto in modo sequenziale: le pagine vengono
+ *  caricate su richiesta durante la simulazione, pertanto la dimensione
+ *  della traccia non e' limitata dalla memoria disponibile. Il formato,
+ *  compresso o meno, viene riconosciuto dall'identificativo iniziale.
+ *  \param t             Traccia da inizializzare
+ *  \param path          Percorso del file
+ *  \return              0 in caso di successo, -1 (dopo aver stampato il
+ *                       motivo su stderr) altrimenti
+ */
+int trace_open(struct trace *t, const char *path)
+{
+    struct stat st;
+    int fd, ret;
+
+    memset(t, 0, sizeof(*t));
+    if ((fd = open(path, O_RDONLY)) == -1 || fstat(fd, &st) == -1) {
+        fprintf(stderr, "Impossibile aprire la traccia %s: %s\n", path,
+                strerror(errno));
+        if (fd != -1)
+            close(fd);
+        return -1;
+    }
+    if (st.st_size < (off_t) sizeof(struct trace_header)) {
+        fprintf(stderr, "La traccia %s non contiene un'intestazione valida.\n",
+                path);
+        close(fd);
+        return -1;
+    }
+
+    t->size = st.st_size;
+    t->map = mmap(NULL, t->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (t->map == MAP_FAILED) {
+        fprintf(stderr, "Impossibile mappare la traccia %s: %s\n", path,
+                strerror(errno));
+        t->map = NULL;
+        return -1;
+    }
+    madvise(t->map, t->size, MADV_SEQUENTIAL);
+
+    switch (*(const uint32_t *) t->map) {
+        case TRACE_MAGIC:
+            ret = open_raw(t, path);
+            break;
+        case TRACE_ZMAGIC:
+            ret = open_compressed(t, path);
+            break;
+        default:
+            fprintf(stderr, "La traccia %s non contiene un'intestazione "
+                    "valida.\n", path);
+            ret = -1;
+    }
+    if (ret == 0 && t->count == 0) {
+        fprintf(stderr, "La traccia %s non contiene accessi.\n", path);
+        ret = -1;
+    }
+    if (ret == -1)
+        trace_close(t);
+    return ret;
+}
+
+
+/*! \fn void trace_close(struct trace *t)
+ *  \brief Rimuove la mappatura della traccia
+ */
+void trace_close(struct trace *t)
+{
+    if (t->map)
+        munmap(t->map, t->size);
+    memset(t, 0, sizeof(*t));
+}
+
+
+/*! \fn int trace_set_window(struct trace *t, uint64_t first, uint64_t count)
+ *  \brief Limita la riproduzione ad un intervallo di record
+ *  \details Nelle tracce compresse il blocco che contiene il primo record
+ *  viene individuato tramite l'indice: i cursori iniziano la decodifica da
+ *  quel blocco anziche' dall'inizio della traccia.
+ *  \param t             Traccia aperta con trace_open
+ *  \param first         Numero di sequenza del primo record
+ *  \param count         Numero di record, 0 fino al termine della traccia
+ *  \return              0 in caso di successo, -1 se l'intervallo non e'
+ *                       contenuto nella traccia
+ */
+int trace_set_window(struct trace *t, uint64_t first, uint64_t count)
+{
+    if (first >= t->count || count > t->count - first)
+        return -1;
+    if (!count)
+        count = t->count - first;
+    if (t->records)
+        t->records += first;
+    else
+        t->first += first;
+    t->count = count;
+    return 0;
+}
+
+
+/*! \fn void trace_cursor_init(struct trace *t, struct trace_cursor *c, uint32_t pid, uint32_t procs)
+ *  \brief Posiziona il cursore di un processo all'inizio della traccia
+ *  \param t             Traccia
+ *  \param c             Cursore da inizializzare
+ *  \param pid           Processo simulato
+ *  \param procs         Numero di processi simulati, tra i quali vengono
+ *                       ripartiti quelli della traccia
+ */
+void trace_cursor_init(struct trace *t, struct trace_cursor *c, uint32_t pid,
+                       uint32_t procs)
+{
+    memset(c, 0, sizeof(*c));
+    c->pid = pid;
+    c->procs = procs;
+    if (t->records) {
+        c->next = t->records;
+        c->end = t->records + t->count;
+    } else {
+        c->trace = t;
+        c->seq = t->first - t->first % t->block_records;
+        c->last_address = XMALLOC(uint64_t, t->procs);
+    }
+}
+
+
+/*! \fn void trace_cursor_destroy(struct trace_cursor *c)
+ *  \brief Dealloca lo stato di decodifica del cursore
+ */
+void trace_cursor_destroy(struct trace_cursor *c)
+{
+    XFREE(c->last_address);
+}
+
+
+/*! \fn uint64_t read_varint(const uint8_t **p)
+ *  \brief Decodifica un intero a lunghezza variabile
+ */
+static inline uint64_t
+read_varint(const uint8_t **p)
+{
+    const uint8_t *q = *p;
+    uint64_t v = 0;
+    unsigned shift = 0;
+
+    do {
+        v |= (uint64_t) (*q & 0x7f) << shift;
+        shift += 7;
+    } while ((*q++ & 0x80) && shift < 64);
+    *p = q;
+    return v;
+}
+
+
+/*! \fn const struct trace_record *trace_decode(struct trace_cursor *c)
+ *  \brief Decodifica il prossimo record del processo da una traccia compressa
+ *  \details I record degli altri processi vengono soltanto attraversati; i
+ *  record del processo che precedono l'intervallo da riprodurre vengono
+ *  decodificati per ricostruire gli indirizzi successivi. Una traccia
+ *  danneggiata termina il programma: la MMU attende tutti gli accessi
+ *  dichiarati e non potrebbe terminare.
+ *  \return              Record, NULL al termine della traccia
+ */
+const struct trace_record *trace_decode(struct trace_cursor *c)
+{
+    const struct trace *t = c->trace;
+    uint64_t end = t->first + t->count, v, delta;
+    uint32_t pid;
+
+    while (c->seq < end) {
+        if (c->seq % t->block_records == 0) {
+            uint64_t b = c->seq / t->block_records;
+
+            c->p = (const uint8_t *) t->map + t->index[b];
+            c->block_end = (const uint8_t *) t->map + t->index[b + 1];
+            memset(c->last_address, 0, t->procs * sizeof(uint64_t));
+        }
+        v = read_varint(&c->p);
+        delta = read_varint(&c->p);
+        if (c->p > c->block_end || (v >> 1) >= t->procs) {
+            fprintf(stderr, "Traccia danneggiata al record %" PRIu64 ".\n",
+                    c->seq);
+            exit(EXIT_FAILURE);
+        }
+        pid = v >> 1;
+        if (pid % c->procs != c->pid) {
+            c->seq++;
+            continue;
+        }
+        c->rec.address = c->last_address[pid] +=
+            (delta >> 1) ^ -(delta & 1);
+        c->rec.pid = pid;
+        c->rec.flags = v & 1 ? TRACE_WRITE : 0;
+        if (c->seq++ >= t->first)
+            return &c->rec;
+    }
+    return NULL;
+}
+
+
+/*! \fn size_t write_varint(uint8_t *p, uint64_t v)
+ *  \brief Codifica un intero a lunghezza variabile
+ *  \return              Numero di byte scritti, al piu' 10
+ */
+static inline size_t
+write_varint(uint8_t *p, uint64_t v)
+{
+    size_t n = 0;
+
+    while (v >= 0x80) {
+        p[n++] = (uint8_t) v | 0x80;
+        v >>= 7;
+    }
+    p[n++] = (uint8_t) v;
+    return n;
+}
+
+
+/*! \fn void flush_block(struct trace_encoder *e)
+ *  \brief Scrive il blocco corrente e ne registra la fine nell'indice
+ */
+static void
+flush_block(struct trace_encoder *e)
+{
+    struct trace_zheader *h = &e->header;
+
+    if (!e->records)
+        return;
+    if (h->blocks + 1 == e->index_size) {
+        uint64_t *index = XMALLOC(uint64_t, e->index_size * 2);
+
+        memcpy(index, e->index, e->index_size * sizeof(uint64_t));
+        XFREE(e->index);
+        e->index = index;
+        e->index_size *= 2;
+    }
+    fwrite(e->buf, 1, e->bytes, e->file);
+    h->blocks++;
+    e->index[h->blocks] = e->index[h->blocks - 1] + e->bytes;
+    e->bytes = e->records = 0;
+    memset(e->last_address, 0, h->procs * sizeof(uint64_t));
+}
+
+
+/*! \fn int trace_encoder_open(struct trace_encoder *e, const char *path, uint32_t procs)
+ *  \brief Crea un file di traccia compresso
+ *  \param e             Codificatore da inizializzare
+ *  \param path          Percorso del file, troncato se esistente
+ *  \param procs         Numero di processi della traccia
+ *  \return              0 in caso di successo, -1 (dopo aver stampato il
+ *                       motivo su stderr) altrimenti
+ */
+int trace_encoder_open(struct trace_encoder *e, const char *path,
+                       uint32_t procs)
+{
+    memset(e, 0, sizeof(*e));
+    if (!(e->file = fopen(path, "w"))) {
+        fprintf(stderr, "Impossibile creare la traccia %s: %s\n", path,
+                strerror(errno));
+        return -1;
+    }
+    e->path = path;
+    e->header.version = TRACE_VERSION;
+    e->header.procs = procs;
+    e->header.block_records = TRACE_BLOCK_RECORDS;
+    e->index_size = 1024;
+    e->index = XMALLOC(uint64_t, e->index_size);
+    e->index[0] = sizeof(e->header);
+    e->last_address = XMALLOC(uint64_t, procs);
+    memset(e->last_address, 0, procs * sizeof(uint64_t));
+    e->buf = XMALLOC(uint8_t, (size_t) TRACE_BLOCK_RECORDS * 20);
+    fwrite(&e->header, sizeof(e->header), 1, e->file);
+    return 0;
+}
+
+
+/*! \fn int trace_encoder_put(struct trace_encoder *e, uint32_t pid, uint64_t address, int rw)
+ *  \brief Aggiunge un accesso alla traccia
+ *  \return              0 in caso di successo, -1 se il processo non e' tra
+ *                       quelli dichiarati a trace_encoder_open
+ */
+int trace_encoder_put(struct trace_encoder *e, uint32_t pid, uint64_t address,
+                      int rw)
+{
+    uint64_t delta;
+
+    if (pid >= e->header.procs)
+        return -1;
+    delta = address - e->last_address[pid];
+    e->last_address[pid] = address;
+    e->bytes += write_varint(e->buf + e->bytes,
+                             (uint64_t) pid << 1 | (rw ? 1 : 0));
+    e->bytes += write_varint(e->buf + e->bytes, delta << 1 ^ -(delta >> 63));
+    e->header.count++;
+    if (++e->records == TRACE_BLOCK_RECORDS)
+        flush_block(e);
+    return 0;
+}
+
+
+/*! \fn int trace_encoder_close(struct trace_encoder *e, uint64_t *bytes)
+ *  \brief Scrive l'ultimo blocco, l'indice e l'intestazione
+ *  \param e             Codificatore
+ *  \param bytes         Se non NULL, riceve la dimensione del file
+ *  \return              0 in caso di successo, -1 (dopo aver stampato il
+ *                       motivo su stderr) altrimenti
+ */
+int trace_encoder_close(struct trace_encoder *e, uint64_t *bytes)
+{
+    struct trace_zheader *h = &e->header;
+    int ret = 0;
+
+    flush_block(e);
+    h->index_offset = e->index[h->blocks];
+    fwrite(e->index, sizeof(uint64_t), h->blocks + 1, e->file);
+    h->magic = TRACE_ZMAGIC;
+    if (fseek(e->file, 0, SEEK_SET) == -1 ||
+        fwrite(h, sizeof(*h), 1, e->file) != 1 || fflush(e->file) == EOF ||
+        ferror(e->file)) {
+        fprintf(stderr, "Impossibile scrivere la traccia %s: %s\n", e->path,
+                strerror(errno));
+        ret = -1;
+    }
+    fclose(e->file);
+    if (bytes)
+        *bytes = h->index_offset + (h->blocks + 1) * sizeof(uint64_t);
+    XFREE(e->buf);
+    XFREE(e->last_address);
+    XFREE(e->index);
+    return ret;
+}
+
+
+/*! \fn int trace_compress(struct trace *t, const char *path, uint64_t *bytes)
+ *  \brief Scrive i record da riprodurre di una traccia nel formato compresso
+ *  \details La traccia di ingresso, compressa o meno, viene letta con un
+ *  cursore che ne attraversa tutti i processi.
+ *  \param t             Traccia di ingresso, eventualmente limitata da
+ *                       trace_set_window
+ *  \param path          Percorso del file da creare
+ *  \param bytes         Se non NULL, riceve la dimensione del file creato
+ *  \return              0 in caso di successo, -1 (dopo aver stampato il
+ *                       motivo su stderr) altrimenti
+ */
+int trace_compress(struct trace *t, const char *path, uint64_t *bytes)
+{
+    struct trace_encoder e;
+    struct trace_cursor c;
+    const struct trace_record *rec;
+    int ret = 0;
+
+    if (trace_encoder_open(&e, path, t->procs) == -1)
+        return -1;
+    trace_cursor_init(t, &c, 0, 1);
+    while (ret == 0 && (rec = trace_next(&c)) != NULL) {
+        if (trace_encoder_put(&e, rec->pid, rec->address,
+                              rec->flags & TRACE_WRITE) == -1) {
+            fprintf(stderr, "Un record fa riferimento al processo %u, non "
+                    "dichiarato nell'intestazione.\n", rec->pid);
+            ret = -1;
+        }
+    }
+    trace_cursor_destroy(&c);
+    if (trace_encoder_close(&e, bytes) == -1)
+        ret = -1;
+    if (ret == -1)
+        unlink(path);
+    return ret;
+}
+
+
+/*! \fn int trace_create(struct trace_writer *w, const char *path, uint64_t capacity)
+ *  \brief Crea un file di traccia per "capacity" accessi
+ *  \details Il file viene esteso alla dimensione finale senza scriverne il
+ *  contenuto (le pagine mai scritte non occupano spazio su disco).
+ *  L'intestazione viene completata soltanto da trace_commit: una
+ *  registrazione interrotta produce un file che trace_open rifiuta.
+ *  \param w             Traccia da inizializzare
+ *  \param path          Percorso del file, troncato se esistente
+ *  \param capacity      Numero massimo di accessi da registrare
+ *  \return              0 in caso di successo, -1 (dopo aver stampato il
+ *                       motivo su stderr) altrimenti
+ */
+int trace_create(struct trace_writer *w, const char *path, uint64_t capacity)
+{
+    int fd;
+
+    memset(w, 0, sizeof(*w));
+    w->capacity = capacity;
+    w->size = sizeof(struct trace_header) +
+              capacity * sizeof(struct trace_record);
+    if ((fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644)) == -1 ||
+        ftruncate(fd, w->size) == -1 ||
+        (w->map = mmap(NULL, w->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                       fd, 0)) == MAP_FAILED) {
+        fprintf(stderr, "Impossibile creare la traccia %s: %s\n", path,
+                strerror(errno));
+        if (fd != -1)
+            close(fd);
+        w->map = NULL;
+        return -1;
+    }
+    close(fd);
+    madvise(w->map, w->size, MADV_SEQUENTIAL);
+    w->records = (struct trace_record *) ((struct trace_header *) w->map + 1);
+    return 0;
+}
+
+
+/*! \fn void trace_commit(struct trace_writer *w, uint32_t procs, uint64_t count)
+ *  \brief Completa l'intestazione e chiude la traccia registrata
+ *  \param w             Traccia registrata
+ *  \param procs         Numero di processi simulati
+ *  \param count         Numero di accessi registrati, non superiore alla
+ *                       capacita' indicata a trace_create
+ */
+void trace_commit(struct trace_writer *w, uint32_t procs, uint64_t count)
+{
+    struct trace_header *h = w->map;
+
+    if (!h)
+        return;
+    h->version = TRACE_VERSION;
+    h->record_size = sizeof(struct trace_record);
+    h->procs = procs;
+    h->flags = 0;
+    h->count = count < w->capacity ? count : w->capacity;
+    h->reserved = 0;
+    __atomic_store_n(&h->magic, TRACE_MAGIC, __ATOMIC_RELEASE);
+    munmap(w->map, w->size);
+    memset(w, 0, sizeof(*w));
+}
+
+/*! @} */
@@ -0,0 +1,261 @@
+/*! \file trace.h
+ *  \defgroup TRACE Tracce binarie degli accessi alla memoria
+ */
+
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <stddef.h>
+#include <stdio.h>
+#include "vm_types.h"
+
+/*! \def TRACE_MAGIC
+ *  \brief Identificativo di un file di traccia ("VMBT")
+ *  \def TRACE_VERSION
+ *  \brief Versione del formato
+ */
+#define TRACE_MAGIC             0x54424d56
+#define TRACE_VERSION           1
+
+/*! \def TRACE_ZMAGIC
+ *  \brief Identificativo di un file di traccia compresso ("VMBZ")
+ *  \def TRACE_BLOCK_RECORDS
+ *  \brief Numero di record per blocco delle tracce compresse
+ *  \details Determina la granularita' dello spostamento all'interno della
+ *  traccia: per raggiungere un record ne vengono decodificati al piu'
+ *  TRACE_BLOCK_RECORDS - 1.
+ */
+#define TRACE_ZMAGIC            0x5a424d56
+#define TRACE_BLOCK_RECORDS     65536
+
+/*! \def TRACE_WRITE
+ *  \brief Flag di un record: l'accesso e' in scrittura
+ */
+#define TRACE_WRITE             0x01
+
+/*! \struct trace_header
+ *  \brief Intestazione di un file di traccia
+ *  \details Il file e' composto dall'intestazione seguita da "count" record
+ *  trace_record, memorizzati nell'ordine in cui gli accessi sono stati
+ *  effettuati e nel formato little-endian della macchina. Un valore nullo di
+ *  "count" indica una traccia il cui scrittore non ha aggiornato
+ *  l'intestazione: il numero di record viene ricavato dalla dimensione del
+ *  file.
+ */
+struct trace_header {
+    /*! TRACE_MAGIC */
+    uint32_t magic;
+    /*! TRACE_VERSION */
+    uint16_t version;
+    /*! dimensione di un record, sizeof(struct trace_record) */
+    uint16_t record_size;
+    /*! numero di processi che compaiono nella traccia */
+    uint32_t procs;
+    /*! riservato */
+    uint32_t flags;
+    /*! numero di record */
+    uint64_t count;
+    /*! riservato, allinea i record a 16 byte */
+    uint64_t reserved;
+};
+
+/*! \struct trace_record
+ *  \brief Singolo accesso alla memoria
+ */
+struct trace_record {
+    /*! indirizzo virtuale */
+    uint64_t address;
+    /*! processo che ha effettuato l'accesso */
+    uint32_t pid;
+    /*! TRACE_WRITE per le scritture */
+    uint32_t flags;
+};
+
+/*! \struct trace_zheader
+ *  \brief Intestazione di un file di traccia compresso
+ *  \details I record vengono raggruppati, nell'ordine della traccia, in
+ *  blocchi di "block_records" record. Ogni record e' codificato con due
+ *  interi a lunghezza variabile (7 bit per byte, little-endian): il pid
+ *  moltiplicato per due piu' il flag di scrittura, e la differenza (zig-zag)
+ *  tra l'indirizzo ed il precedente indirizzo dello stesso processo
+ *  all'interno del blocco. Ogni blocco e' quindi decodificabile
+ *  indipendentemente dagli altri.\n
+ *  Ai blocchi segue l'indice: "blocks" + 1 posizioni a 64 bit, l'ultima delle
+ *  quali indica la fine dell'ultimo blocco.
+ */
+struct trace_zheader {
+    /*! TRACE_ZMAGIC */
+    uint32_t magic;
+    /*! TRACE_VERSION */
+    uint16_t version;
+    /*! riservato */
+    uint16_t flags;
+    /*! numero di processi che compaiono nella traccia */
+    uint32_t procs;
+    /*! numero di record per blocco */
+    uint32_t block_records;
+    /*! numero di record */
+    uint64_t count;
+    /*! numero di blocchi */
+    uint64_t blocks;
+    /*! posizione dell'indice dei blocchi */
+    uint64_t index_offset;
+    /*! riservato */
+    uint64_t reserved;
+};
+
+/*! \struct trace
+ *  \brief Traccia mappata in memoria
+ *  \details Il file viene mappato in sola lettura: i record vengono letti
+ *  direttamente dalle pagine del file, senza essere copiati.
+ */
+struct trace {
+    /*! indirizzo della mappatura */
+    void *map;
+    /*! dimensione della mappatura */
+    size_t size;
+    /*! primo record da riprodurre, NULL per le tracce compresse */
+    const struct trace_record *records;
+    /*! numero di record da riprodurre */
+    uint64_t count;
+    /*! numero di processi dichiarato nell'intestazione */
+    uint32_t procs;
+    /*! numero di record per blocco (tracce compresse) */
+    uint32_t block_records;
+    /*! indice dei blocchi (tracce compresse) */
+    const uint64_t *index;
+    /*! numero di blocchi (tracce compresse) */
+    uint64_t blocks;
+    /*! numero di sequenza del primo record da riprodurre */
+    uint64_t first;
+};
+
+/*! \struct trace_cursor
+ *  \brief Posizione di un processo all'interno della traccia
+ *  \details Ogni processo simulato scorre la traccia con un proprio cursore,
+ *  saltando i record degli altri processi: l'ordine degli accessi di ogni
+ *  processo viene cosi' preservato senza costruire copie per processo.\n
+ *  Le tracce compresse vengono decodificate un blocco alla volta
+ *  direttamente dalla mappatura: soltanto il record corrente viene
+ *  ricostruito in "rec".
+ */
+struct trace_cursor {
+    /*! prossimo record da esaminare (tracce non compresse) */
+    const struct trace_record *next;
+    /*! fine della traccia (tracce non compresse) */
+    const struct trace_record *end;
+    /*! processo simulato */
+    uint32_t pid;
+    /*! numero di processi simulati */
+    uint32_t procs;
+    /*! traccia compressa, NULL per le tracce non compresse */
+    const struct trace *trace;
+    /*! prossimo byte da decodificare e fine del blocco corrente */
+    const uint8_t *p, *block_end;
+    /*! numero di sequenza del prossimo record da decodificare */
+    uint64_t seq;
+    /*! ultimo indirizzo di ogni processo della traccia nel blocco corrente */
+    uint64_t *last_address;
+    /*! record corrente */
+    struct trace_record rec;
+};
+
+/*! \struct trace_writer
+ *  \brief Traccia in fase di registrazione
+ *  \details Il file viene dimensionato in anticipo per il numero massimo di
+ *  accessi e mappato in lettura/scrittura: l'accesso con numero di sequenza
+ *  "seq" occupa il record di posizione "seq", pertanto i processi scrivono
+ *  senza lock e la posizione nel file rappresenta l'ordine globale degli
+ *  accessi. La scrittura su disco e' delegata alla page cache.
+ */
+struct trace_writer {
+    /*! indirizzo della mappatura */
+    void *map;
+    /*! dimensione della mappatura */
+    size_t size;
+    /*! primo record */
+    struct trace_record *records;
+    /*! numero massimo di record */
+    uint64_t capacity;
+};
+
+/*! \struct trace_encoder
+ *  \brief Traccia compressa in fase di scrittura
+ *  \details I record vengono codificati nel blocco corrente, scritto sul file
+ *  quando contiene TRACE_BLOCK_RECORDS record; l'indice dei blocchi cresce in
+ *  memoria e viene scritto, con l'intestazione, da trace_encoder_close.
+ */
+struct trace_encoder {
+    /*! file in scrittura */
+    FILE *file;
+    /*! percorso del file */
+    const char *path;
+    /*! intestazione, completata alla chiusura */
+    struct trace_zheader header;
+    /*! ultimo indirizzo di ogni processo nel blocco corrente */
+    uint64_t *last_address;
+    /*! posizioni dei blocchi scritti */
+    uint64_t *index;
+    /*! capacita' dell'indice */
+    uint64_t index_size;
+    /*! blocco corrente */
+    uint8_t *buf;
+    /*! byte del blocco corrente */
+    size_t bytes;
+    /*! record del blocco corrente */
+    uint32_t records;
+};
+
+/*! \def TRACE_WRITE_RECORD(w, seq, procnum, addr, rw)
+ *  \brief Registra l'accesso numero "seq"
+ */
+#define TRACE_WRITE_RECORD(w, seq, procnum, addr, rw) do { \
+struct trace_record *__r = &(w)->records[seq]; \
+__r->address = (addr); \
+__r->pid = (procnum); \
+__r->flags = (rw) ? TRACE_WRITE : 0; \
+} while (0)
+
+const struct trace_record *trace_decode(struct trace_cursor *);
+
+/*! \addtogroup TRACE
+ * @{
+ *  \fn const struct trace_record *trace_next(struct trace_cursor *c)
+ *  \brief Restituisce il prossimo record del processo del cursore
+ *  \details I processi della traccia vengono ripartiti tra quelli simulati
+ *  in base al resto della divisione per il loro numero.
+ *  \return              Record, NULL al termine della traccia
+ */
+static inline const struct trace_record *
+trace_next(struct trace_cursor *c)
+{
+    const struct trace_record *rec;
+
+    if (c->trace)
+        return trace_decode(c);
+    while (c->next < c->end) {
+        rec = c->next++;
+        if (rec->pid % c->procs == c->pid)
+            return rec;
+    }
+    return NULL;
+}
+
+/*! @} */
+
+/*
+ *  Prototipi di funzioni pubbliche
+ */
+int trace_open(struct trace *, const char *);
+void trace_close(struct trace *);
+void trace_cursor_init(struct trace *, struct trace_cursor *, uint32_t, uint32_t);
+void trace_cursor_destroy(struct trace_cursor *);
+int trace_set_window(struct trace *, uint64_t, uint64_t);
+int trace_compress(struct trace *, const char *, uint64_t *);
+int trace_encoder_open(struct trace_encoder *, const char *, uint32_t);
+int trace_encoder_put(struct trace_encoder *, uint32_t, uint64_t, int);
+int trace_encoder_close(struct trace_encoder *, uint64_t *);
+int trace_create(struct trace_writer *, const char *, uint64_t);
+void trace_commit(struct trace_writer *, uint32_t, uint64_t);
+
+#endif              /* __TRACE_H__ */
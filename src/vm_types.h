@@ -14,6 +14,7 @@
 #define __VM_TYPES_H__
 
 #include <stdio.h>
+#include <inttypes.h>
 
 /*! \def XMALLOC(type, num)
  *  \brief Macro per migliorare la leggibilita' dell'operazione di allocazione 
@@ -38,31 +39,36 @@ stale = 0; } \
  */
 typedef void *(*thread_fn_t) (void *);
 
-/*! \typedef unsigned short int uint16_t
- *  \brief Definizione del tipo numero intero non segnato a 16 bit */
-typedef unsigned short int uint16_t;
-
-/*! \typedef unsigned short int uint32_t
- *  \brief Definizione del tipo numero intero non segnato a 32 bit */
-typedef unsigned int uint32_t;
+/*! \def PAGE_PRESENT
+ *  \brief Bit di stato: la pagina e' presente in memoria
+ *  \def PAGE_REFERENCED
+ *  \brief Bit di stato: la pagina e' stata referenziata di recente
+ *  \def PAGE_DIRTY
+ *  \brief Bit di stato: la pagina e' stata modificata di recente
+ */
+#define PAGE_PRESENT            0x01
+#define PAGE_REFERENCED         0x02
+#define PAGE_DIRTY              0x04
 
 /*! \struct page
  *  \brief Struttura per la rappresentazione di una pagina virtuale
- *  \details E' la funzione proc_init ad avere il compito di creare la 
- *  tabella delle pagine per ogni processo; ogni voce in tabella sara' del 
- *  tipo "struct page".
+ *  \details Ogni voce delle foglie della tabella delle pagine di un processo
+ *  e' del tipo "struct page": il numero di pagina e' implicito nella
+ *  posizione della voce.\n
+ *  I bit di stato sono raccolti in un'unica parola modificata in modo 
+ *  atomico: il bit Reference, infatti, viene impostato anche dal processo
+ *  quando la traduzione e' risolta dal proprio TLB.\n
+ *  Compilando con PT_BITMAP la voce contiene il solo frame-id, mentre i bit
+ *  di stato risiedono nelle bitmap della foglia che la contiene (vedi
+ *  pagetable.h).
  */
 struct page {
-    /*! Identificativo della pagina */
-    uint16_t id;
-    /*! Se vale 1, la pagina e' presente in memoria */
-    int present:1;
-    /*! Se vale 1, la pagina e' stata referenziata di recente */
-    int reference:1;
-    /*! Se vale 1, la pagina e' stata modificata di recente */
-    int dirty:1;
     /*! Se la pagina e' presente in memoria, questo e' l'ID del frame associato */
-    uint16_t frame_id;
+    uint32_t frame_id;
+#ifndef PT_BITMAP
+    /*! Bit di stato PAGE_PRESENT, PAGE_REFERENCED e PAGE_DIRTY */
+    unsigned int flags;
+#endif /* PT_BITMAP */
 };
 
 typedef struct page page_t;
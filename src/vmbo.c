@@ -41,12 +41,61 @@
 #include "mmu.h"
 #include "proc.h"
 #include "io_device.h"
+#include "pool.h"
+#include "trace.h"
+#include "import.h"
+#include "stackdist.h"
+#include "sweep.h"
 
 extern proc_t **proc_table;
 extern int max_proc;
 extern int anticipatory_paging;
 extern int reference_count;
 extern uint16_t *reference_string;
+extern struct trace *replay_trace;
+extern struct trace_writer *trace_recorder;
+extern unsigned tlb_entries;
+extern unsigned tlb_ways;
+extern int tlb_policy;
+extern unsigned pt_levels;
+extern const char *replacement_policy;
+extern unsigned mmu_threads;
+extern unsigned io_channels;
+extern int virtual_time;
+extern int fault_io;
+extern char *workload_list;
+extern int direct_replay;
+extern int process_logs;
+extern int mmu_log;
+
+/*! \enum long_only_options
+ *  \brief Codici dei parametri privi di una versione breve
+ */
+enum long_only_options {
+    OPT_TLB_ENTRIES = 256,
+    OPT_TLB_WAYS,
+    OPT_TLB_POLICY,
+    OPT_POLICY,
+    OPT_ADDRESS_BITS,
+    OPT_PT_LEVELS,
+    OPT_MMU_THREADS,
+    OPT_TRACE,
+    OPT_RECORD,
+    OPT_TRACE_WINDOW,
+    OPT_CONVERT,
+    OPT_IMPORT,
+    OPT_SEED,
+    OPT_WORKLOAD,
+    OPT_FAST,
+    OPT_STACK_DISTANCE,
+    OPT_SWEEP,
+    OPT_SWEEP_OUTPUT,
+    OPT_JOBS,
+    OPT_IO_CHANNELS,
+    OPT_IO_SCHEDULER,
+    OPT_VIRTUAL_TIME,
+    OPT_FAULT_IO
+};
 
 /*! \var int debug
  *  \brief Livello di debug
@@ -56,6 +105,11 @@ extern uint16_t *reference_string;
  */
 int debug;
 
+/*! \var uint32_t xmalloc_count
+ *  \brief Numero di blocchi allocati tramite xmalloc
+ */
+static uint32_t xmalloc_count;
+
 /*! \struct option longopts
  *  \brief Parametri da riga di comando (versione lunga)
  *  \details Elenco dei possibili parametri da riga di comando
@@ -77,6 +131,29 @@ static struct option longopts[] = {
     { "Tmax", required_argument, NULL, 'T' },
     { "write-enabled", no_argument, NULL, 'w' },
     { "version", no_argument, NULL, 'v' },
+    { "tlb-entries", required_argument, NULL, OPT_TLB_ENTRIES },
+    { "tlb-ways", required_argument, NULL, OPT_TLB_WAYS },
+    { "tlb-policy", required_argument, NULL, OPT_TLB_POLICY },
+    { "policy", required_argument, NULL, OPT_POLICY },
+    { "address-bits", required_argument, NULL, OPT_ADDRESS_BITS },
+    { "pt-levels", required_argument, NULL, OPT_PT_LEVELS },
+    { "mmu-threads", required_argument, NULL, OPT_MMU_THREADS },
+    { "trace", required_argument, NULL, OPT_TRACE },
+    { "record", required_argument, NULL, OPT_RECORD },
+    { "trace-window", required_argument, NULL, OPT_TRACE_WINDOW },
+    { "convert", required_argument, NULL, OPT_CONVERT },
+    { "import", required_argument, NULL, OPT_IMPORT },
+    { "seed", required_argument, NULL, OPT_SEED },
+    { "workload", required_argument, NULL, OPT_WORKLOAD },
+    { "fast", no_argument, NULL, OPT_FAST },
+    { "stack-distance", required_argument, NULL, OPT_STACK_DISTANCE },
+    { "sweep", required_argument, NULL, OPT_SWEEP },
+    { "sweep-output", required_argument, NULL, OPT_SWEEP_OUTPUT },
+    { "jobs", required_argument, NULL, OPT_JOBS },
+    { "io-channels", required_argument, NULL, OPT_IO_CHANNELS },
+    { "io-scheduler", required_argument, NULL, OPT_IO_SCHEDULER },
+    { "virtual-time", no_argument, NULL, OPT_VIRTUAL_TIME },
+    { "fault-io", no_argument, NULL, OPT_FAULT_IO },
     { NULL, 0, NULL, 0 }
 };  
 
@@ -93,34 +170,100 @@ static void usage()
             "Opzioni generali:\n"
             "  -h, --help                Stampa questo help\n"
             "  -v, --version             Stampa la versione del programma ed esce\n"
-            "  -d, --debug               Attiva il debug\n\n"
+            "  -d, --debug               Attiva il debug\n"
+            "      --seed=NUM            Seme dei generatori casuali (default: ora corrente)\n\n"
             "Opzioni MMU:\n"
             "  -a, --anticipatory        Disabilita l'anticipatory paging\n"
             "  -m, --memory-read=NUM     Numero massimo di accessi alla memoria\n"
             "  -R, --ram-size=NUM        Quantita di RAM disponibile\n"
             "  -s, --frame-size=NUM      Dimensione della pagina/frame\n"
-            "  -w, --write-enabled       Abilita gli accessi in scrittura alla memoria\n\n"
+            "  -w, --write-enabled       Abilita gli accessi in scrittura alla memoria\n"
+            "      --address-bits=NUM    Bit dell'indirizzo virtuale (default: 20, max: 48)\n"
+            "      --pt-levels=NUM       Livelli della tabella delle pagine (default: automatico)\n"
+            "      --mmu-threads=NUM     Thread MMU, ognuno con una partizione dei frame (default: 1)\n"
+            "      --tlb-entries=NUM     Numero di voci del TLB di ogni processo (0 = disabilitato)\n"
+            "      --tlb-ways=NUM        Associativita' del TLB (default: completamente associativo)\n"
+            "      --tlb-policy=NOME     Rimpiazzo delle voci del TLB: lru, fifo, random\n"
+            "      --policy=NOME[:PARAM] Politica di rimpiazzo delle pagine:\n");
+    policy_usage(stderr);
+    fprintf(stderr, "\n"
             "Opzioni PROCESSO:\n"
             "  -M, --all-memory          Forza i processi ad allocare il massimo della memoria\n"
             "  -p, --processes=NUM       Numero di processi contemporanei\n"
             "  -P, --probability=NUM     Probabilita di accessi alla memoria\n"
             "  -l, --probabilities=LIST  Specifica la probabilta per ogni processo\n"
             "  -L, --locality=NUM        Specifica la percentuale di localita temporale\n"
-            "  -r, --reference=LIST      Specifica la reference string da usare\n\n"
+            "  -r, --reference=LIST      Specifica la reference string da usare\n"
+            "      --workload=LIST       Modelli di carico dei processi, separati da virgole\n"
+            "                            (l'ultimo vale per i processi successivi):\n");
+    workload_usage(stderr);
+    fprintf(stderr,
+            "      --trace=FILE          Riproduce gli accessi di una traccia binaria\n"
+            "      --record=FILE         Registra gli accessi alla memoria in una traccia\n"
+            "      --trace-window=N[:M]  Riproduce M accessi della traccia a partire dall'N-esimo\n"
+            "      --convert=FILE        Scrive la traccia (o la finestra) in formato compresso\n"
+            "      --import=FMT:FILE     Importa un processo da una traccia din o lackey\n"
+            "                            (ripetibile, un processo per file)\n"
+            "      --fast                Riproduce traccia o reference string su un solo\n"
+            "                            thread, senza log degli accessi\n"
+            "      --stack-distance=FILE Scrive i fault LRU per ogni numero di frame\n"
+            "                            (\"-\" per lo standard output) ed esce\n\n"
             "Opzioni DISPOSITIVO I/O:\n"
             "  -t, --Tmin=NUM            Tempo minimo d'attesa del dispositivo I/O\n"
-            "  -t, --Tmax=NUM            Tempo massimo d'attesa del dispositivo I/O\n\n");
+            "  -t, --Tmax=NUM            Tempo massimo d'attesa del dispositivo I/O\n"
+            "      --io-channels=NUM     Canali che servono in parallelo le richieste (default: 1)\n"
+            "      --io-scheduler=NOME   Ordine di servizio delle richieste: fifo (default),\n"
+            "                            sjf, priority[:P0:P1...], deadline[:MS]\n"
+            "      --virtual-time        Contabilizza la latenza su un orologio simulato\n"
+            "                            anziche' attenderla in tempo reale\n"
+            "      --fault-io            Carica le pagine mancanti e copia su disco quelle\n"
+            "                            \"sporche\" tramite il dispositivo I/O; le copie\n"
+            "                            ed i caricamenti della paginazione anticipata\n"
+            "                            occupano il dispositivo senza sospendere il\n"
+            "                            processo\n\n"
+            "Opzioni ESPLORAZIONE:\n"
+            "      --sweep=SPEC          Esegue una simulazione per ogni combinazione degli\n"
+            "                            intervalli PARAM=MIN[:MAX[:[*+]PASSO]], separati da\n"
+            "                            virgole; PARAM: ram, frame, procs, locality\n"
+            "      --sweep-output=FILE   Risultati in CSV, o JSON se FILE termina in .json\n"
+            "                            (default: standard output)\n"
+            "      --jobs=NUM            Simulazioni contemporanee (default: numero di CPU)\n\n");
     fprintf(stderr, "Esempi d'utilizzo:\n"
             " - Esegue 7 processi contemporanei ed effettua 10 letture\n"
             "   vmbo --max-read=10 --max-processes=7\n"
             " - Esegue 3 processi, specificando il ritardo per il dispositivo I/O\n"
             "   vmbo --max-processes=3 --Tmin=2 --Tmax=30\n"
+            " - Serve le richieste di 16 processi con 4 canali di I/O\n"
+            "   vmbo -p 16 --io-channels=4\n"
+            " - Serve per prime le richieste piu' brevi, salvo quelle attese da 50 ms\n"
+            "   vmbo -p 16 --io-scheduler=deadline:50\n"
+            " - Simula in pochi istanti centomila accessi con latenze fino a 100 ms\n"
+            "   vmbo -m 100000 --virtual-time\n"
+            " - Misura il tempo effettivo d'accesso con fault serviti da 2 canali\n"
+            "   vmbo -w -m 20000 --fault-io --io-channels=2 --virtual-time\n"
             " - Specifica la probabilita' di effettuare un accesso alla memoria\n" 
             "   vmbo --probability=30\n"
             " - Specifica una probabilita' diversa per ogni processo\n"
             "   vmbo --probabilities=30:20:78:93:80\n"
+            " - Processo 0 con hot set Zipf, gli altri con scansioni a passo fisso\n"
+            "   vmbo -p 4 --workload=zipf:1.1,stride:8192\n"
             " - Specifica una reference string per determinare gli accessi\n"
-            "   vmbo --reference=1:2:3:4:1:2:5:1:2:3:4:5\n\n");
+            "   vmbo --reference=1:2:3:4:1:2:5:1:2:3:4:5\n"
+            " - Registra gli accessi di un'esecuzione e li riproduce con meno RAM\n"
+            "   vmbo -m 100000 --record=run.vmbt && vmbo --trace=run.vmbt -R 524288\n"
+            " - Comprime una traccia e ne riproduce un milione di accessi\n"
+            "   vmbo --trace=run.vmbt --convert=run.vmbz\n"
+            "   vmbo --trace=run.vmbz --trace-window=5000000:1000000\n"
+            " - Importa due tracce Valgrind lackey e Dinero come processi 0 e 1\n"
+            "   vmbo --import=lackey:ls.trace --import=din:gcc.din -R 262144\n"
+            " - Riproduce rapidamente una traccia su un solo thread\n"
+            "   vmbo --trace=run.vmbt --fast -R 524288\n"
+            " - Calcola in un'unica passata i fault LRU con 1..256 frame\n"
+            "   vmbo --trace=run.vmbt --stack-distance=lru.txt\n"
+            " - Misura i fault con RAM da 64 Kb a 1 Mb e da 1 a 4 processi\n"
+            "   vmbo -m 5000 --sweep=ram=65536:1048576,procs=1:4 --sweep-output=s.csv\n"
+            " - Riproduce una traccia binaria con indirizzi a 48 bit\n"
+            "   vmbo --trace=servizio.vmbt --address-bits=48 -R 1073741824\n\n");
 }
 
 
@@ -128,10 +271,25 @@ int
 main(int argc, char **argv)
 {
     pthread_t *tid_mmu, *tid_iodev;
-    int i, time_seed, ch, error, _Tmin, _Tmax, _max_memory, _locality_prob,
-    _prob, _max_read, _frame_size, _only_read, _ram_size, io_time_elapsed,
-    option_index, allocated_pages, total_faults;
-    char *prob_list, *_reference_string;
+    int i, seed_given, ch, error, _Tmin, _Tmax, _max_memory, _locality_prob,
+    _prob, _frame_size, _only_read, option_index, address_bits;
+    uint64_t _max_read, _ram_size, allocated_pages, pt_bytes, total_faults,
+    io_time_elapsed, tlb_hits = 0, tlb_misses = 0, resident, reclaimable;
+    uint32_t pt_nodes;
+    unsigned channel;
+    struct page_table pt;
+    char *prob_list, *_reference_string, *_trace_file, *_record_file,
+    *_convert_file, *_stackdist_file, *_sweep_spec, *_sweep_output;
+    uint64_t window_first, window_count;
+    char **imports, import_path[FILENAME_MAX];
+    int nimports;
+    struct trace trace;
+    struct trace_writer recorder;
+    int procs_given;
+    struct timespec start_time, end_time;
+    double wall_time;
+    struct sweep sweep;
+    int jobs;
     
     /*
      *  Analisi dei parametri specificati da riga di comando: definisco prima
@@ -148,14 +306,21 @@ main(int argc, char **argv)
     max_proc = 5;
     _frame_size = 4096;
     _ram_size = 1048576;
+    address_bits = ADDRESS_LENGTH;
     _only_read = 1;
     _Tmin = 1, _Tmax = 100;
     _max_memory = 0;
     _locality_prob = 30;
-    _reference_string = prob_list = NULL;
+    _reference_string = _trace_file = _record_file = _convert_file = NULL;
+    _stackdist_file = _sweep_spec = NULL;
+    _sweep_output = "-";
+    jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    prob_list = NULL;
+    window_first = window_count = 0;
+    imports = XMALLOC(char *, argc);
+    nimports = 0;
+    procs_given = seed_given = 0;
     anticipatory_paging = 1;
-    mmu.offset_bits = log2(_frame_size);
-    mmu.page_bits = ADDRESS_LENGTH-mmu.offset_bits;
     
     while ((ch = getopt_long(argc, argv, "hadl:L:Mm:r:R:s:t:T:p:P:wv", 
            longopts, &option_index)) != -1) {       
@@ -188,8 +353,8 @@ main(int argc, char **argv)
                 break;
             case 'm':
                 if (optarg) {
-                    _max_read = atoi(optarg);
-                    if (_max_read <= 0) {
+                    _max_read = strtoull(optarg, NULL, 10);
+                    if (_max_read == 0) {
                         fprintf(stderr, "Il numero di accessi alla memoria "
                                 "deve essere positivo.\n");
                         error = 2;
@@ -200,7 +365,8 @@ main(int argc, char **argv)
             case 'p':
                 if (optarg) {
                     max_proc = atoi(optarg);
-                    if (max_proc == 0) {
+                    procs_given = 1;
+                    if (max_proc <= 0) {
                         fprintf(stderr, "Il numero di processi deve essere "
                                 "positivo.\n");
                         error = 2;
@@ -227,13 +393,7 @@ main(int argc, char **argv)
                 break;
             case 'R':
                 if (optarg) {
-                    _ram_size = atoi(optarg);
-                    if (_ram_size > exp2(ADDRESS_LENGTH)) {
-                        fprintf(stderr, "La dimensione della RAM non puo' "
-                                " essere superiore a %d byte.\n", 
-                                (int) exp2(ADDRESS_LENGTH));
-                        error = 2;
-                    }
+                    _ram_size = strtoull(optarg, NULL, 10);
                 } else
                     error = 1;
                 break;
@@ -266,40 +426,275 @@ main(int argc, char **argv)
             case 'h':
                 error = 1;
                 break;
+            case OPT_TLB_ENTRIES:
+                tlb_entries = atoi(optarg);
+                break;
+            case OPT_TLB_WAYS:
+                tlb_ways = atoi(optarg);
+                break;
+            case OPT_TLB_POLICY:
+                if ((tlb_policy = tlb_policy_by_name(optarg)) == -1) {
+                    fprintf(stderr, "Politica di rimpiazzo del TLB "
+                            "sconosciuta: %s\n", optarg);
+                    error = 2;
+                }
+                break;
+            case OPT_POLICY:
+                if (!policy_find(optarg)) {
+                    fprintf(stderr, "Politica di rimpiazzo sconosciuta: "
+                            "%s\n", optarg);
+                    error = 1;
+                }
+                replacement_policy = optarg;
+                break;
+            case OPT_ADDRESS_BITS:
+                address_bits = atoi(optarg);
+                if (address_bits < ADDRESS_LENGTH ||
+                    address_bits > MAX_ADDRESS_LENGTH) {
+                    fprintf(stderr, "La lunghezza dell'indirizzo deve essere "
+                            "compresa tra %d e %d bit.\n", ADDRESS_LENGTH,
+                            MAX_ADDRESS_LENGTH);
+                    error = 2;
+                }
+                break;
+            case OPT_PT_LEVELS:
+                pt_levels = atoi(optarg);
+                if (pt_levels < 1 || pt_levels > PT_MAX_LEVELS) {
+                    fprintf(stderr, "Il numero di livelli della tabella delle "
+                            "pagine deve essere compreso tra 1 e %d.\n",
+                            PT_MAX_LEVELS);
+                    error = 2;
+                }
+                break;
+            case OPT_MMU_THREADS:
+                mmu_threads = atoi(optarg);
+                if (mmu_threads < 1 || mmu_threads > MMU_MAX_THREADS) {
+                    fprintf(stderr, "Il numero di thread MMU deve essere "
+                            "compreso tra 1 e %d.\n", MMU_MAX_THREADS);
+                    error = 2;
+                }
+                break;
+            case OPT_IO_CHANNELS:
+                io_channels = atoi(optarg);
+                if (io_channels < 1 || io_channels > IO_MAX_CHANNELS) {
+                    fprintf(stderr, "Il numero di canali di I/O deve essere "
+                            "compreso tra 1 e %d.\n", IO_MAX_CHANNELS);
+                    error = 2;
+                }
+                break;
+            case OPT_FAULT_IO:
+                fault_io = 1;
+                break;
+            case OPT_VIRTUAL_TIME:
+                virtual_time = 1;
+                break;
+            case OPT_IO_SCHEDULER:
+                if (io_scheduler_parse(optarg) == -1)
+                    error = 2;
+                break;
+            case OPT_TRACE:
+                _trace_file = optarg;
+                break;
+            case OPT_RECORD:
+                _record_file = optarg;
+                break;
+            case OPT_TRACE_WINDOW:
+                {
+                    char *sep;
+                    
+                    window_first = strtoull(optarg, &sep, 10);
+                    if (*sep == ':')
+                        window_count = strtoull(sep + 1, NULL, 10);
+                }
+                break;
+            case OPT_CONVERT:
+                _convert_file = optarg;
+                break;
+            case OPT_IMPORT:
+                imports[nimports++] = optarg;
+                break;
+            case OPT_WORKLOAD:
+                workload_list = optarg;
+                if (workload_check(workload_list) == -1)
+                    error = 2;
+                break;
+            case OPT_FAST:
+                direct_replay = 1;
+                break;
+            case OPT_STACK_DISTANCE:
+                _stackdist_file = optarg;
+                break;
+            case OPT_SWEEP:
+                _sweep_spec = optarg;
+                break;
+            case OPT_SWEEP_OUTPUT:
+                _sweep_output = optarg;
+                break;
+            case OPT_JOBS:
+                jobs = atoi(optarg);
+                if (jobs <= 0) {
+                    fprintf(stderr, "Il numero di simulazioni contemporanee "
+                            "deve essere positivo.\n");
+                    error = 2;
+                }
+                break;
+            case OPT_SEED:
+                random_seed = strtoull(optarg, NULL, 0);
+                seed_given = 1;
+                break;
             case 0:
                 break;
         }
     }
     
+    /*
+     *  Esplorazione dei parametri: ogni configurazione viene simulata da un
+     *  processo figlio, che prosegue da qui con i valori assegnati ed invia
+     *  il risultato al termine della simulazione. Il padre termina dopo aver
+     *  scritto i risultati di tutte le configurazioni.
+     */
+    if (_sweep_spec && !error) {
+        uint64_t value[SWEEP_PARAMS] = { _ram_size, _frame_size, max_proc,
+                                         _locality_prob };
+        
+        if (_convert_file || _stackdist_file || _record_file) {
+            fprintf(stderr, "L'esplorazione non puo' essere combinata con "
+                    "--convert, --stack-distance o --record.\n");
+            return EXIT_FAILURE;
+        }
+        if (sweep_parse(&sweep, _sweep_spec, value) == -1)
+            return EXIT_FAILURE;
+        if (!seed_given) {
+            random_seed = (uint64_t) time(0);
+            seed_given = 1;
+        }
+        switch (sweep_run(&sweep, jobs, _sweep_output, value)) {
+            case 0:
+                return EXIT_SUCCESS;
+            case -1:
+                return EXIT_FAILURE;
+        }
+        _ram_size = value[SWEEP_RAM];
+        _frame_size = value[SWEEP_FRAME];
+        max_proc = value[SWEEP_PROCS];
+        _locality_prob = value[SWEEP_LOCALITY];
+        if (sweep.given & (1 << SWEEP_PROCS))
+            procs_given = 1;
+        mmu_log = process_logs = 0;
+    }
+    
+    /*
+     *  Inizializzazione dimensione indirizzo di memoria e maschera per 
+     *  ottenere l'offset da un indirizzo virtuale generaato da un processo.
+     *  I bit del numero di pagina vengono ripartiti tra i livelli della
+     *  tabella delle pagine: se non specificato, il numero di livelli e'
+     *  scelto in base alla lunghezza dell'indirizzo.
+     */
+    mmu.offset_bits = log2(_frame_size);
+    mmu.page_bits = address_bits-mmu.offset_bits;
+    if (!error) {
+        if (_ram_size > exp2(address_bits)) {
+            fprintf(stderr, "La dimensione della RAM non puo' "
+                    " essere superiore a %.0f byte.\n", exp2(address_bits));
+            error = 2;
+        } else if (_ram_size / _frame_size >= (uint32_t) -1) {
+            fprintf(stderr, "Il numero di frame non puo' essere superiore a "
+                    "%u.\n", (uint32_t) -2);
+            error = 2;
+        }
+        if (!pt_levels)
+            pt_levels = pt_default_levels(mmu.page_bits);
+        if (pt_init(&pt, mmu.page_bits, pt_levels) == -1) {
+            fprintf(stderr, "Impossibile suddividere %d bit di pagina in %u "
+                    "livelli.\n", mmu.page_bits, pt_levels);
+            error = 2;
+        } else
+            pt_destroy(&pt);
+        /*
+         *  Le tracce da importare vengono convertite in una traccia compressa
+         *  temporanea, rimossa non appena mappata in memoria.
+         */
+        if (nimports && !error) {
+            const char *tmpdir = getenv("TMPDIR");
+            int fd;
+            
+            snprintf(import_path, FILENAME_MAX, "%s/vmbo-import-XXXXXX",
+                     tmpdir ? tmpdir : "/tmp");
+            if (_trace_file) {
+                fprintf(stderr, "Non e' possibile specificare sia una "
+                        "traccia che delle tracce da importare.\n");
+                error = 2;
+            } else if ((fd = mkstemp(import_path)) == -1) {
+                fprintf(stderr, "Impossibile creare %s: %s\n", import_path,
+                        strerror(errno));
+                error = 2;
+            } else {
+                close(fd);
+                if (import_traces(imports, nimports, import_path,
+                                  mmu.page_bits, mmu.offset_bits) == -1) {
+                    unlink(import_path);
+                    error = 2;
+                } else
+                    _trace_file = import_path;
+            }
+        }
+        if (_trace_file) {
+            if (_reference_string) {
+                fprintf(stderr, "Non e' possibile specificare sia una "
+                        "traccia che una reference string.\n");
+                error = 2;
+            } else if (trace_open(&trace, _trace_file) == -1)
+                error = 2;
+            else if (_trace_file == import_path && unlink(import_path))
+                error = 2;
+            else if (trace_set_window(&trace, window_first, window_count)) {
+                fprintf(stderr, "La traccia contiene %" PRIu64 " accessi: la "
+                        "finestra richiesta non e' valida.\n", trace.count);
+                error = 2;
+            }
+        } else if (_convert_file) {
+            fprintf(stderr, "La conversione richiede una traccia (--trace o "
+                    "--import).\n");
+            error = 2;
+        }
+        if (direct_replay && !_trace_file && !_reference_string) {
+            fprintf(stderr, "La riproduzione diretta richiede una traccia o "
+                    "una reference string.\n");
+            error = 2;
+        }
+        if (direct_replay && fault_io) {
+            fprintf(stderr, "La riproduzione diretta non simula il "
+                    "dispositivo di I/O: --fault-io non e' ammesso.\n");
+            error = 2;
+        }
+        if (_stackdist_file && !_trace_file && !_reference_string) {
+            fprintf(stderr, "L'analisi delle distanze di stack richiede una "
+                    "traccia o una reference string.\n");
+            error = 2;
+        }
+    }
+    
     if (error) {
         if (error == 1)
             usage();
         return EXIT_FAILURE;
     } 
     
-    /* 
-     *  Inizializzazione dimensione indirizzo di memoria e maschera per 
-     *  ottenere l'offset da un indirizzo virtuale generaato da un processo.
-     */
-    mmu.offset_bits = log2(_frame_size);
-    mmu.page_bits = ADDRESS_LENGTH-mmu.offset_bits;
     for (mmu.offset_mask=0, i=0; i<mmu.offset_bits; i++)
         mmu.offset_mask += (uint32_t) exp2(i);
-    fprintf(stdout, "--> Simulatore inizializzato con indirizzi a %d bit\n", 
-            mmu.offset_bits+mmu.page_bits);
+    fprintf(stdout, "--> Simulatore inizializzato con indirizzi a %d bit "
+            "(tabella delle pagine a %u livelli)\n",
+            mmu.offset_bits+mmu.page_bits, pt_levels);
     
     /*
-     *  Inizializzazione generatore numeri pseudo-casuali.
+     *  Inizializzazione generatori di numeri pseudo-casuali: ogni thread
+     *  deriva il proprio flusso dallo stesso seme, che viene stampato per
+     *  poter ripetere l'esecuzione con "--seed".
      */
-    time_seed = (int) time(0);
-    srandom(time_seed);
-    
-    /*
-     *  Inizializzazione strutture dati e lancio dei thread: dapprima verra' 
-     *  instanziato il thread che emula la MMU, successivamente il thread per
-     *  simulare il dispositivo di I/O ed in ultimo i thread "processo.
-     */
-    tid_mmu = mmu_init(_max_read, _ram_size, _frame_size);
+    if (!seed_given)
+        random_seed = (uint64_t) time(0);
+    fprintf(stdout, "--> Seme dei generatori casuali: %" PRIu64 "\n",
+            random_seed);
     
     /* 
      *  Gestione della reference string: se viene specificata da riga di
@@ -313,7 +708,7 @@ main(int argc, char **argv)
         for (reference_count=j=0; j<strlen(_reference_string); j++)
             if (_reference_string[j] == ':')
                 reference_count++;
-        mmu.total_access = ++reference_count;
+        _max_read = ++reference_count;
         anticipatory_paging = 0;   /* Disabilita la paginazione anticipata */
         _prob = 100;               /* Consenti solo accessi alla memoria   */
         max_proc = 1;              /* Crea un solo processo                */
@@ -326,75 +721,333 @@ main(int argc, char **argv)
         }
     }
 
-    tid_iodev = io_device_init(_Tmin, _Tmax);
-    proc_init(max_proc, _prob, _only_read, _max_memory, prob_list, _locality_prob);
+    /*
+     *  Gestione della traccia: come per la reference string i processi
+     *  effettuano soltanto gli accessi registrati, in lettura o scrittura
+     *  secondo la traccia. Se non specificato con "-p", il numero di processi
+     *  e' quello della traccia; altrimenti i processi della traccia vengono
+     *  ripartiti tra quelli simulati.
+     */
+    if (_convert_file) {
+        uint64_t bytes, records = trace.count;
+        
+        error = trace_compress(&trace, _convert_file, &bytes);
+        trace_close(&trace);
+        if (error)
+            return EXIT_FAILURE;
+        fprintf(stdout, "--> Traccia %s: %" PRIu64 " accessi, %" PRIu64
+                " byte (%.2f byte per accesso)\n", _convert_file, records,
+                bytes, (double) bytes / records);
+        return EXIT_SUCCESS;
+    }
+    if (_trace_file) {
+        _max_read = trace.count;
+        anticipatory_paging = 0;
+        _prob = 100;
+        _max_memory = 1;
+        if (!procs_given)
+            max_proc = trace.procs;
+        replay_trace = &trace;
+        if (direct_replay && max_proc > 1)
+            fprintf(stderr, "Attenzione: la riproduzione diretta esegue gli "
+                    "accessi dei %d processi nell'ordine globale della "
+                    "traccia, mentre con i thread ogni processo procede per "
+                    "lotti secondo lo scheduling: fault e pagine rimosse "
+                    "possono differire.\n", max_proc);
+    }
     
     /*
-     *  Attesa che tutti i thread abbiano terminato la propria esecuzione e
-     *  successiva deallocazione della memoria utilizzata: nell'ordine attendo
-     *  l'MMU, il dispositivo di I/O e tutti i processi.
+     *  Analisi delle distanze di stack: i fault della politica LRU per ogni
+     *  numero di frame, fino a quelli della RAM specificata, vengono
+     *  calcolati in un'unica passata senza avviare la simulazione.
      */
-    pthread_join(*tid_mmu, NULL);
-    tell_io_device_to_exit();
-    pthread_join(*tid_iodev, NULL);
-    for (i = 0; i < max_proc; i++) {
-        pthread_cond_signal(&proc_table[i]->io_cond);
-        pthread_join(proc_table[i]->tid, NULL);
-        fclose(LOG_FILE(i));
+    if (_stackdist_file) {
+        struct stackdist sd;
+        uint32_t frames = _ram_size / _frame_size;
+        
+        stackdist_init(&sd, frames);
+        if (replay_trace)
+            stackdist_trace(&sd, replay_trace, max_proc, mmu.page_bits,
+                            mmu.offset_bits);
+        else
+            for (i = 0; i < reference_count; i++)
+                stackdist_access(&sd, reference_string[i]);
+        error = stackdist_write(&sd, _stackdist_file);
+        if (!error)
+            fprintf(stdout, "--> Distanze di stack: %" PRIu64 " accessi, %u "
+                    "pagine distinte, %" PRIu64 " fault LRU con %u frame\n",
+                    sd.accesses, sd.distinct, stackdist_faults(&sd, frames),
+                    frames);
+        stackdist_destroy(&sd);
+        XFREE(reference_string);
+        XFREE(imports);
+        if (replay_trace)
+            trace_close(replay_trace);
+        return error ? EXIT_FAILURE : EXIT_SUCCESS;
     }
     
+    /*
+     *  Registrazione degli accessi: la traccia viene dimensionata sul numero
+     *  massimo di accessi, noto a questo punto.
+     */
+    if (_record_file) {
+        if (trace_create(&recorder, _record_file, _max_read) == -1)
+            return EXIT_FAILURE;
+        trace_recorder = &recorder;
+    }
+
+    /*
+     *  Inizializzazione strutture dati e lancio dei thread: dapprima verra' 
+     *  instanziato il thread che emula la MMU, successivamente il thread per
+     *  simulare il dispositivo di I/O ed in ultimo i thread "processo. La MMU
+     *  viene avviata dopo l'analisi della reference string, che modifica il
+     *  numero di processi tra i quali ripartire gli shard.
+     */
+    if (direct_replay) {
+        /*
+         *  Riproduzione diretta: MMU e processi vengono eseguiti dal thread
+         *  principale, senza dispositivo di I/O.
+         */
+        tid_mmu = tid_iodev = NULL;
+        mmu_direct_init(_max_read, _ram_size, _frame_size);
+        proc_init(max_proc, _prob, _only_read, _max_memory, prob_list,
+                  _locality_prob);
+        clock_gettime(CLOCK_MONOTONIC, &start_time);
+        proc_replay();
+        clock_gettime(CLOCK_MONOTONIC, &end_time);
+        mmu_direct_finish();
+    } else {
+        tid_mmu = mmu_init(_max_read, _ram_size, _frame_size);
+        clock_gettime(CLOCK_MONOTONIC, &start_time);
+        tid_iodev = io_device_init(_Tmin, _Tmax);
+        proc_init(max_proc, _prob, _only_read, _max_memory, prob_list,
+                  _locality_prob);
+    
+        /*
+         *  Attesa che tutti i thread abbiano terminato la propria esecuzione:
+         *  nell'ordine attendo l'MMU, il dispositivo di I/O e tutti i
+         *  processi. Il dispositivo termina solo dopo aver completato tutte
+         *  le richieste accettate, quindi nessun processo resta in attesa.
+         */
+        pthread_join(*tid_mmu, NULL);
+        clock_gettime(CLOCK_MONOTONIC, &end_time);
+        tell_io_device_to_exit();
+        for (channel = 0; channel < io_dev.nthreads; channel++)
+            pthread_join(tid_iodev[channel], NULL);
+        for (i = 0; i < max_proc; i++)
+            pthread_join(proc_table[i]->tid, NULL);
+    }
+    if (trace_recorder)
+        trace_commit(trace_recorder, max_proc, mmu.total_access);
+    for (i = 0; i < max_proc; i++)
+        fclose(LOG_FILE(i));
+    
     /*
      *  Stampa delle statistiche.
      */
-    fprintf(stdout, "\n+==================================================================+\n"
-           "|                       S T A T I S T I C H E                      |\n"
-           "+==================================================================+\n"
-           "| PID | NUM  | PROB | ACCESSI |  PAGE   | FAULT | ACCESSI |  TEMPO |\n"
-           "|     | PAG  |      | MEMORIA |  FAULT  |  (%%)  |   I/O   |  MEDIO |\n"
-           "+-----+------+------+---------+---------+-------+---------+--------+\n");
+    fprintf(stdout, "\n+=================================================================================================================+\n"
+           "|                                              S T A T I S T I C H E                                              |\n"
+           "+=================================================================================================================+\n"
+           "| PID |     NUM     | PROB |   ACCESSI   |    PAGE     | FAULT |     TLB     |     TLB     |   ACCESSI   |  TEMPO |\n"
+           "|     |     PAG     |      |   MEMORIA   |    FAULT    |  (%%)  |     HIT     |    MISS     |     I/O     |  MEDIO |\n"
+           "+-----+-------------+------+-------------+-------------+-------+-------------+-------------+-------------+--------+\n");
+    pt_nodes = pt_bytes = resident = reclaimable = 0;
     for (total_faults = allocated_pages = io_time_elapsed = i = 0; i < max_proc; i++) {
-        fprintf(stdout, "|% 4d |% 5d |% 4.0f%% | % 7d | % 7d | % 4.0f%% | % 7d | % 6.0f |\n",
+        fprintf(stdout, "|% 4d | %11" PRIu64 " |% 4.0f%% | %11" PRIu64 " | %11" PRIu64
+                " | % 4.0f%% | %11" PRIu64 " | %11" PRIu64 " | %11" PRIu64
+                " | % 6.0f |\n",
                 proc_table[i]->pid, proc_table[i]->page_count,
                 proc_table[i]->percentile,
                 proc_table[i]->stats.mem_accesses,
                 proc_table[i]->stats.page_faults,
                 proc_table[i]->stats.page_faults?
-                      ((float)proc_table[i]->stats.page_faults/
-                       (float)proc_table[i]->stats.mem_accesses)*100:0,
+                      ((double)proc_table[i]->stats.page_faults/
+                       (double)proc_table[i]->stats.mem_accesses)*100:0,
+                proc_table[i]->stats.tlb_hits,
+                proc_table[i]->stats.tlb_misses,
                 proc_table[i]->stats.io_requests,
                 proc_table[i]->stats.io_requests?
-                ((float)proc_table[i]->stats.time_elapsed/
-                 (float)proc_table[i]->stats.io_requests):0);
+                ((double)proc_table[i]->stats.time_elapsed/
+                 (double)proc_table[i]->stats.io_requests):0);
                 io_time_elapsed += proc_table[i]->stats.time_elapsed;
         allocated_pages += proc_table[i]->page_count;
+        pt_nodes += proc_table[i]->page_table.nodes;
+        pt_bytes += proc_table[i]->page_table.bytes;
+        resident += pt_count(&proc_table[i]->page_table, PAGE_PRESENT, 0);
+        reclaimable += pt_count(&proc_table[i]->page_table, PAGE_PRESENT,
+                                PAGE_REFERENCED | PAGE_DIRTY);
         total_faults += proc_table[i]->stats.page_faults;
+        tlb_hits += proc_table[i]->stats.tlb_hits;
+        tlb_misses += proc_table[i]->stats.tlb_misses;
     }
-    fprintf(stdout, "+-----+------+------+---------+---------"
-           "+-------+---------+--------+\n"
-           "                    | % 7d | % 7d | % 4.0f%% | % 7d | % 6.0f |\n"
-           "                    +---------+---------+-------"
-           "+---------+--------+\n\n", mmu.total_access, total_faults, 
-           ((float)mmu.page_faults/(float)mmu.total_access)*100,
+    fprintf(stdout, "+-----+-------------+------+-------------+-------------"
+           "+-------+-------------+-------------+-------------+--------+\n"
+           "                           | %11" PRIu64 " | %11" PRIu64 " | % 4.0f%% "
+           "| %11" PRIu64 " | %11" PRIu64 " | %11" PRIu64 " | % 6.0f |\n"
+           "                           +-------------+-------------+-------"
+           "+-------------+-------------+-------------+--------+\n\n",
+           mmu.total_access, total_faults, 
+           ((double)mmu.page_faults/(double)mmu.total_access)*100,
+           tlb_hits, tlb_misses,
            io_dev.req_count, io_dev.req_count?
-            ((float)io_time_elapsed/io_dev.req_count):0);
+            ((double)io_time_elapsed/io_dev.req_count):0);
+    
+    fprintf(stdout, "Pagine virtuali allocate  = %12" PRIu64 "\n"
+            "Memoria virtuale allocata = %12" PRIu64 " (~ %.1f Mb)\n\n",
+            allocated_pages, allocated_pages*mmu.page_size,
+            (double) allocated_pages*mmu.page_size/1048576);
+    
+    /*
+     *  Tabelle delle pagine: i nodi vengono allocati al primo accesso, quindi
+     *  la memoria occupata dipende dalle pagine effettivamente usate.
+     */
+    fprintf(stdout, "Livelli tabella pagine    = %12u\n"
+            "Profondita' media walk    = %12.2f\n"
+            "Nodi tabelle pagine       = %12u\n"
+            "Memoria tabelle pagine    = %12" PRIu64 " (~ %.1f Kb)\n"
+            "Pagine residenti          = %12" PRIu64 "\n"
+            "  non referenziate/pulite = %12" PRIu64 "\n\n",
+            pt_levels, mmu.pt_walks ?
+            (double) mmu.pt_walk_levels / mmu.pt_walks : 0,
+            pt_nodes, pt_bytes, (double) pt_bytes/1024, resident, reclaimable);
+    
+    fprintf(stdout, "Politica di rimpiazzo     = %12s\n"
+            "Pagine rimosse            = %12" PRIu64 "\n"
+            "Write-back su disco       = %12" PRIu64 "\n"
+            "Frame esaminati per fault = %12.2f\n\n",
+            replacement_policy ? replacement_policy : policy_sc.name,
+            mmu.evictions, mmu.write_backs,
+            mmu.evictions ? (double) mmu.scanned / mmu.evictions : 0);
+    
+    /*
+     *  Dispositivo di I/O: utilizzo di ogni canale (tempo di servizio sulla
+     *  durata del canale) e profondita' della coda comune.
+     */
+    if (io_dev.channels) {
+        uint64_t depth_sum = 0;
+        
+        for (channel = 0; channel < io_dev.nchannels; channel++)
+            depth_sum += io_dev.channels[channel].depth_sum;
+        fprintf(stdout, "Canali dispositivo I/O    = %12u\n"
+                "Profondita' media coda    = %12.2f\n"
+                "Profondita' massima coda  = %12" PRIu64 "\n",
+                io_dev.nchannels, io_dev.req_count ?
+                (double) depth_sum / io_dev.req_count : 0, io_dev.max_depth);
+        for (channel = 0; channel < io_dev.nchannels; channel++)
+            fprintf(stdout, "  canale %2u: %8" PRIu64 " richieste, utilizzo "
+                    "%5.1f%%, coda media %6.2f\n", channel,
+                    io_dev.channels[channel].requests,
+                    io_dev.channels[channel].elapsed > 0 ? 100.0 *
+                    io_dev.channels[channel].busy_time /
+                    io_dev.channels[channel].elapsed : 0, io_dev.channels[channel].requests ?
+                    (double) io_dev.channels[channel].depth_sum /
+                    io_dev.channels[channel].requests : 0);
+        
+        /*
+         *  Attese di I/O per processo, dall'accodamento al completamento
+         *  della richiesta: media e coda della distribuzione.
+         */
+        fprintf(stdout, "\nScheduling I/O            = %12s\n"
+                "  PID   RICHIESTE   MEDIA (ms)  P95 (ms)  P99 (ms)  MAX (ms)\n",
+                io_scheduler_name());
+        for (i = 0; i < max_proc; i++)
+            fprintf(stdout, "  %3d %11" PRIu64 " %12.2f %9.1f %9.1f %9.1f\n",
+                    proc_table[i]->pid,
+                    proc_table[i]->stats.io_requests,
+                    proc_table[i]->stats.io_requests ?
+                    proc_table[i]->stats.io_wait / 1e3 /
+                    proc_table[i]->stats.io_requests : 0,
+                    io_wait_percentile(proc_table[i], 95) / 1e3,
+                    io_wait_percentile(proc_table[i], 99) / 1e3,
+                    proc_table[i]->stats.io_wait_max / 1e3);
+        fprintf(stdout, "\n");
+        
+        /*
+         *  Servizio dei fault: il tempo effettivo d'accesso somma alla durata
+         *  di un accesso alla memoria l'attesa media per il caricamento delle
+         *  pagine, coda del dispositivo compresa.
+         */
+        if (fault_io) {
+            uint64_t fault_wait = 0;
+            
+            for (i = 0; i < max_proc; i++)
+                fault_wait += proc_table[i]->stats.fault_wait;
+            fprintf(stdout, "Caricamenti di pagine     = %12" PRIu64 "\n"
+                    "Caricamenti anticipati    = %12" PRIu64 "\n"
+                    "Copie su disco (I/O)      = %12" PRIu64 "\n"
+                    "Attesa media per fault    = %12.2f ms\n"
+                    "Tempo effettivo d'accesso = %12.2f us\n\n",
+                    io_dev.page_ins, io_dev.prefetches, io_dev.write_backs,
+                    io_dev.page_ins ? fault_wait / 1e3 / io_dev.page_ins : 0,
+                    MMU_ACCESS_TIME_NS / 1e3 + (mmu.total_access ?
+                    (double) fault_wait / mmu.total_access : 0));
+        }
+    }
+    
+    fprintf(stdout, "Thread MMU (shard)        = %12u\n"
+            "Frame sottratti tra shard = %12" PRIu64 "\n\n",
+            mmu.shards, mmu.steals);
+    
+    /*
+     *  Allocazioni dinamiche: gli oggetti del percorso critico provengono dai
+     *  pool, quindi le chiamate a xmalloc non dipendono dal numero di accessi.
+     */
+    fprintf(stdout, "Oggetti estratti dai pool = %12" PRIu64 "\n"
+            "Blocchi allocati dai pool = %12u\n"
+            "Chiamate a xmalloc        = %12u\n\n",
+            pool_stats.gets, pool_stats.allocs, xmalloc_count);
     
-    fprintf(stdout, "Pagine virtuali allocate  = % 12d\n"
-            "Memoria virtuale allocata = %12lu (~ %.1f Mb)\n\n",
-            allocated_pages, (unsigned long) allocated_pages*mmu.page_size,
-            (float) allocated_pages*mmu.page_size/1048576);
+    /*
+     *  Throughput della MMU: accessi serviti per secondo di tempo reale,
+     *  misurato dall'avvio dei processi al termine del thread MMU.
+     */
+    wall_time = (end_time.tv_sec - start_time.tv_sec) +
+                (end_time.tv_nsec - start_time.tv_nsec) / 1e9;
+    fprintf(stdout, "Tempo di esecuzione       = %12.3f s\n"
+            "Accessi al secondo        = %12.0f\n", wall_time,
+            wall_time > 0 ? mmu.total_access / wall_time : 0);
+    if (virtual_time && io_dev.channels)
+        fprintf(stdout, "Tempo simulato            = %12.3f s\n",
+                io_dev.vclock / 1e6);
+    fprintf(stdout, "\n");
+    
+    /*
+     *  Processo figlio di un'esplorazione: invio il risultato al padre.
+     */
+    if (_sweep_spec) {
+        struct sweep_result res;
+        
+        memset(&res, 0, sizeof(res));
+        res.accesses = mmu.total_access;
+        res.faults = mmu.page_faults;
+        res.evictions = mmu.evictions;
+        res.write_backs = mmu.write_backs;
+        res.tlb_hits = tlb_hits;
+        res.io_requests = io_dev.req_count;
+        res.io_time = io_time_elapsed;
+        res.wall_time = wall_time;
+        sweep_report(&res);
+    }
     
     /*
      *  Dealloco la struttura dati che rappresenta la proc table ed i relativi
      *  thread ID.
      */
     for (i = 0; i < max_proc; i++) {
-        XFREE(proc_table[i]->page_table);
+        ring_destroy(&proc_table[i]->ring);
+        tlb_destroy(&proc_table[i]->tlb);
+        pt_destroy(&proc_table[i]->page_table);
         XFREE(proc_table[i]);
     }
     XFREE(proc_table);
+    mmu_destroy();
+    io_device_destroy();
     XFREE(tid_iodev);
     XFREE(tid_mmu);
     XFREE(reference_string);
+    XFREE(imports);
+    if (replay_trace)
+        trace_close(replay_trace);
         
     return EXIT_SUCCESS;
 }
@@ -412,6 +1065,7 @@ void *
 xmalloc(size_t num)
 {
     void *p = (void *) malloc(num);
+    __atomic_add_fetch(&xmalloc_count, 1, __ATOMIC_RELAXED);
     if (!p) {
         printf("Memory exhausted");
         exit(EXIT_FAILURE);
@@ -36,4 +36,11 @@
  */
 #define ADDRESS_LENGTH  20  
 
+/*! \def MAX_ADDRESS_LENGTH
+ *  \brief Lunghezza massima in bit di un indirizzo virtuale
+ *  \details Il parametro "--address-bits" consente di estendere lo spazio
+ *  d'indirizzamento virtuale dei processi fino a questo valore.
+ */
+#define MAX_ADDRESS_LENGTH  48
+
 #endif   /* __VMBO_H__ */
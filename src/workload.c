@@ -0,0 +1,336 @@
+/*! \file workload.c
+ */
+
+#include "workload.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/*! \def WL_MAX_SPEC
+ *  \brief Lunghezza massima della descrizione di un modello
+ */
+#define WL_MAX_SPEC             64
+
+/*! \def UNIFORM(r)
+ *  \brief Numero casuale uniforme in [0, 1)
+ */
+#define UNIFORM(r)              ((rng_next(r) >> 11) * 0x1.0p-53)
+
+/*! \struct workload_desc
+ *  \brief Nome, parametri e descrizione di un modello
+ */
+static const struct workload_desc {
+    const char *name;
+    const char *params;
+    const char *description;
+} models[] = {
+    { "default", "",               "cicli ed accessi casuali (-L)" },
+    { "zipf",    "[:THETA[:PAG]]", "pagine con distribuzione di Zipf (0.99)" },
+    { "scan",    "[:PASSO]",       "scansione sequenziale (passo 64 byte)" },
+    { "stride",  "[:PASSO]",       "scansione a passo fisso (una pagina)" },
+    { "chase",   "[:PAG]",         "visita delle pagine in ordine casuale fisso" },
+    { "phase",   "[:PAG[:LEN]]",   "working set di 64 pagine spostato ogni 10000 accessi" },
+    { NULL, NULL, NULL }
+};
+
+
+/*! \fn double helper1(double x)
+ *  \brief log1p(x) / x, stabile per x prossimo a zero
+ */
+static double
+helper1(double x)
+{
+    return fabs(x) > 1e-8 ? log1p(x) / x : 1 - x * (0.5 - x * (1.0 / 3 - x / 4));
+}
+
+
+/*! \fn double helper2(double x)
+ *  \brief expm1(x) / x, stabile per x prossimo a zero
+ */
+static double
+helper2(double x)
+{
+    return fabs(x) > 1e-8 ? expm1(x) / x : 1 + x / 2 * (1 + x / 3 * (1 + x / 4));
+}
+
+
+/*! \fn double zipf_h(struct workload *w, double x)
+ *  \brief Funzione di densita' non normalizzata x^-theta
+ */
+static double
+zipf_h(struct workload *w, double x)
+{
+    return exp(-w->theta * log(x));
+}
+
+
+/*! \fn double zipf_hint(struct workload *w, double x)
+ *  \brief Primitiva di zipf_h
+ */
+static double
+zipf_hint(struct workload *w, double x)
+{
+    double lx = log(x);
+
+    return helper2((1 - w->theta) * lx) * lx;
+}
+
+
+/*! \fn double zipf_hint_inv(struct workload *w, double x)
+ *  \brief Inversa di zipf_hint
+ */
+static double
+zipf_hint_inv(struct workload *w, double x)
+{
+    double t = x * (1 - w->theta);
+
+    if (t < -1)
+        t = -1;
+    return exp(helper1(t) * x);
+}
+
+
+/*! \fn uint64_t zipf_next(struct workload *w, struct rng *r)
+ *  \brief Estrae un rango in [1, pages] con il metodo di rigetto-inversione
+ *  \details Hoermann e Derflinger, "Rejection-inversion to generate variates
+ *  from monotone discrete distributions": non richiede la costante di
+ *  normalizzazione (una somma su tutte le pagine) e scarta in media meno di
+ *  un'estrazione ogni cento.
+ */
+static uint64_t
+zipf_next(struct workload *w, struct rng *r)
+{
+    double u, x;
+    uint64_t k;
+
+    for (;;) {
+        u = w->h_n + UNIFORM(r) * (w->h_x1 - w->h_n);
+        x = zipf_hint_inv(w, u);
+        k = x < 1 ? 1 : (uint64_t) (x + 0.5);
+        if (k > w->pages)
+            k = w->pages;
+        if (k - x <= w->s || u >= zipf_hint(w, k + 0.5) - zipf_h(w, k))
+            return k;
+    }
+}
+
+
+/*! \addtogroup WORKLOAD
+ * @{
+ *  \fn int workload_parse(const char *list, int index, struct workload *w)
+ *  \brief Ricava il modello del processo "index" da una lista
+ *  \details La lista contiene, separati da virgole, i modelli dei processi
+ *  nell'ordine della proc table; i processi oltre la fine della lista usano
+ *  l'ultimo modello. Ogni modello ha la forma "nome[:param[:param]]".
+ *  \param list          Lista dei modelli, NULL per il modello di default
+ *  \param index         Posizione del processo
+ *  \param w             Modello da inizializzare
+ *  \return              0 in caso di successo, -1 se il modello non e' valido
+ */
+int workload_parse(const char *list, int index, struct workload *w)
+{
+    char spec[WL_MAX_SPEC], *name, *p1, *p2, *end;
+    const char *start = list, *next;
+    size_t len;
+
+    memset(w, 0, sizeof(*w));
+    if (!list)
+        return 0;
+    for (; index > 0 && (next = strchr(start, ',')); index--)
+        start = next + 1;
+    len = (next = strchr(start, ',')) ? (size_t) (next - start) : strlen(start);
+    if (len == 0 || len >= sizeof(spec))
+        return -1;
+    memcpy(spec, start, len);
+    spec[len] = '\0';
+
+    name = strtok_r(spec, ":", &end);
+    p1 = strtok_r(NULL, ":", &end);
+    p2 = strtok_r(NULL, ":", &end);
+    for (w->model = 0; models[w->model].name; w->model++)
+        if (!strcmp(name, models[w->model].name))
+            break;
+
+    switch (w->model) {
+        case WL_DEFAULT:
+            break;
+        case WL_ZIPF:
+            w->theta = p1 ? atof(p1) : 0.99;
+            w->pages = p2 ? strtoull(p2, NULL, 10) : 0;
+            if (w->theta <= 0)
+                return -1;
+            break;
+        case WL_SCAN:
+        case WL_STRIDE:
+            w->step = p1 ? strtoull(p1, NULL, 10) : w->model == WL_SCAN ? 64 : 0;
+            if (p1 && w->step == 0)
+                return -1;
+            break;
+        case WL_CHASE:
+            w->pages = p1 ? strtoull(p1, NULL, 10) : 0;
+            break;
+        case WL_PHASE:
+            w->step = p1 ? strtoull(p1, NULL, 10) : 64;
+            w->length = p2 ? strtoull(p2, NULL, 10) : 10000;
+            if (w->step == 0 || w->length == 0)
+                return -1;
+            break;
+        default:
+            return -1;
+    }
+    return 0;
+}
+
+
+/*! \fn int workload_check(const char *list)
+ *  \brief Verifica tutti i modelli di una lista
+ *  \return              0 se validi, -1 (dopo aver stampato il modello errato
+ *                       su stderr) altrimenti
+ */
+int workload_check(const char *list)
+{
+    struct workload w;
+    const char *p;
+    int i;
+
+    for (i = 0, p = list; p; i++, p = (p = strchr(p, ',')) ? p + 1 : NULL) {
+        if (workload_parse(list, i, &w) == -1) {
+            fprintf(stderr, "Modello di carico non valido: %.*s\n",
+                    (int) strcspn(p, ","), p);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
+/*! \fn void workload_init(struct workload *w, struct rng *r, uint64_t page_count, uint32_t page_size)
+ *  \brief Adatta il modello allo spazio d'indirizzamento del processo
+ *  \param w             Modello ottenuto da workload_parse
+ *  \param r             Generatore del processo
+ *  \param page_count    Pagine del processo
+ *  \param page_size     Dimensione della pagina
+ */
+void workload_init(struct workload *w, struct rng *r, uint64_t page_count,
+                   uint32_t page_size)
+{
+    if (!w->pages || w->pages > page_count)
+        w->pages = page_count;
+    w->page_size = page_size;
+    w->span = w->pages * page_size;
+    w->count = 0;
+
+    switch (w->model) {
+        case WL_ZIPF:
+            w->h_x1 = zipf_hint(w, 1.5) - 1;
+            w->h_n = zipf_hint(w, w->pages + 0.5);
+            w->s = 2 - zipf_hint_inv(w, zipf_hint(w, 2.5) - zipf_h(w, 2));
+            break;
+        case WL_STRIDE:
+            if (!w->step)
+                w->step = page_size;
+            /* continua */
+        case WL_SCAN:
+            w->cursor = rng_bounded(r, w->span);
+            break;
+        case WL_CHASE:
+            for (w->mask = 1; w->mask < w->pages; w->mask <<= 1)
+                ;
+            w->mask--;
+            w->cursor = rng_bounded(r, w->pages);
+            break;
+        case WL_PHASE:
+            if (w->step > w->pages)
+                w->step = w->pages;
+            w->cursor = rng_bounded(r, w->pages - w->step + 1);
+            break;
+    }
+}
+
+
+/*! \fn uint64_t workload_next(struct workload *w, struct rng *r)
+ *  \brief Genera il prossimo indirizzo virtuale del processo
+ *  \details Il modello WL_DEFAULT non genera indirizzi: e' gestito da
+ *  thread_proc con simulate_loop e random_access.
+ */
+uint64_t workload_next(struct workload *w, struct rng *r)
+{
+    uint64_t page;
+
+    switch (w->model) {
+        case WL_ZIPF:
+            page = zipf_next(w, r) - 1;
+            break;
+        case WL_SCAN:
+        case WL_STRIDE:
+            page = w->cursor;
+            w->cursor += w->step;
+            if (w->cursor >= w->span)
+                w->cursor -= w->span * (w->cursor / w->span);
+            return page;
+        case WL_CHASE:
+            /*
+             *  Generatore congruenziale a periodo pieno sulla potenza di due
+             *  successiva: i valori oltre "pages" vengono saltati (meno di
+             *  due passi in media), cosi' che ogni pagina venga visitata una
+             *  volta per ciclo.
+             */
+            do
+                w->cursor = (w->cursor * 6364136223846793005ULL +
+                             1442695040888963407ULL) & w->mask;
+            while (w->cursor >= w->pages);
+            page = w->cursor;
+            break;
+        case WL_PHASE:
+            if (w->count++ == w->length) {
+                w->count = 1;
+                w->cursor = rng_bounded(r, w->pages - w->step + 1);
+            }
+            page = w->cursor + rng_bounded(r, w->step);
+            break;
+        default:
+            page = rng_bounded(r, w->pages);
+            break;
+    }
+    return page * w->page_size + rng_bounded(r, w->page_size);
+}
+
+
+/*! \fn void workload_describe(struct workload *w, FILE *out)
+ *  \brief Stampa il modello ed i suoi parametri
+ */
+void workload_describe(struct workload *w, FILE *out)
+{
+    fprintf(out, "%s", models[w->model].name);
+    switch (w->model) {
+        case WL_ZIPF:
+            fprintf(out, " theta=%.2f pagine=%" PRIu64, w->theta, w->pages);
+            break;
+        case WL_SCAN:
+        case WL_STRIDE:
+            fprintf(out, " passo=%" PRIu64, w->step);
+            break;
+        case WL_CHASE:
+            fprintf(out, " pagine=%" PRIu64, w->pages);
+            break;
+        case WL_PHASE:
+            fprintf(out, " working-set=%" PRIu64 " fase=%" PRIu64, w->step,
+                    w->length);
+            break;
+    }
+}
+
+
+/*! \fn void workload_usage(FILE *out)
+ *  \brief Stampa l'elenco dei modelli disponibili
+ */
+void workload_usage(FILE *out)
+{
+    int i;
+
+    for (i = 0; models[i].name; i++)
+        fprintf(out, "                              %-7s%-15s %s\n",
+                models[i].name, models[i].params, models[i].description);
+}
+
+/*! @} */
@@ -0,0 +1,72 @@
+/*! \file workload.h
+ *  \defgroup WORKLOAD Modelli di carico dei processi
+ */
+
+#ifndef __WORKLOAD_H__
+#define __WORKLOAD_H__
+
+#include <stdio.h>
+#include "vm_types.h"
+#include "random.h"
+
+/*! \enum workload_model
+ *  \brief Modelli di generazione degli indirizzi
+ */
+enum workload_model {
+    /*! generatore originale: cicli (simulate_loop) ed accessi casuali */
+    WL_DEFAULT,
+    /*! pagine estratte con distribuzione di Zipf */
+    WL_ZIPF,
+    /*! scansione sequenziale a passi brevi */
+    WL_SCAN,
+    /*! scansione a passo fisso */
+    WL_STRIDE,
+    /*! visita delle pagine in un ordine pseudo-casuale fisso (liste) */
+    WL_CHASE,
+    /*! working set uniforme che si sposta ad ogni fase */
+    WL_PHASE
+};
+
+/*! \struct workload
+ *  \brief Parametri e stato del modello di carico di un processo
+ *  \details Ogni modello genera un indirizzo con un numero costante di
+ *  operazioni (in media, per Zipf e chase), indipendentemente dalla
+ *  dimensione dello spazio d'indirizzamento.
+ */
+struct workload {
+    /*! modello (workload_model) */
+    int model;
+    /*! pagine interessate dal modello, 0 = tutto lo spazio del processo */
+    uint64_t pages;
+    /*! esponente della distribuzione di Zipf */
+    double theta;
+    /*! passo in byte (scan, stride) o pagine del working set (phase) */
+    uint64_t step;
+    /*! accessi per fase (phase) */
+    uint64_t length;
+    /*! dimensione della pagina */
+    uint32_t page_size;
+    /*! posizione corrente: indirizzo (scan, stride), pagina (chase) o
+     primo indirizzo del working set (phase) */
+    uint64_t cursor;
+    /*! accessi effettuati nella fase corrente */
+    uint64_t count;
+    /*! spazio d'indirizzamento del processo, in byte */
+    uint64_t span;
+    /*! maschera del generatore congruenziale (chase) */
+    uint64_t mask;
+    /*! costanti del campionamento per rigetto-inversione (Zipf) */
+    double h_x1, h_n, s;
+};
+
+/*
+ *  Prototipi di funzioni pubbliche
+ */
+int workload_parse(const char *, int, struct workload *);
+int workload_check(const char *);
+void workload_init(struct workload *, struct rng *, uint64_t, uint32_t);
+uint64_t workload_next(struct workload *, struct rng *);
+void workload_describe(struct workload *, FILE *);
+void workload_usage(FILE *);
+
+#endif              /* __WORKLOAD_H__ */